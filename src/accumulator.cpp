@@ -0,0 +1,441 @@
+/**
+ * Copyright (C) 2021-present Codein Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify it under the terms of
+ * BSD-3-Clause License which can be found at the root directory of this repository.
+ */
+
+#include <any>
+#include <cmath>
+#include <memory>
+#include <string>
+#include <typeindex>
+#include <vector>
+
+#include "accumulator.h"
+#include "any_visitor.h"
+#include "hyper_log_log.h"
+#include "t_digest.h"
+#include "to_any_converter.h"
+
+namespace codein {
+
+namespace {
+
+constexpr std::size_t kAllRows = SIZE_MAX;
+
+// Returns the input value at col, or nullptr if it is null.
+template <typename T>
+const T* inputValue(const std::vector<std::any>& input, std::size_t col)
+{
+    const auto& value = input[col];
+    if (!value.has_value()) {
+        return nullptr;
+    }
+
+    if (const auto p = std::any_cast<T>(&value); p != nullptr) {
+        return p;
+    }
+
+    throw UnsupportedOperation();
+}
+
+template <typename T>
+struct SumOp {
+    void operator()(T& acc, const T& val) const
+    {
+        acc += val;
+    }
+};
+
+template <typename T>
+struct MinOp {
+    void operator()(T& acc, const T& val) const
+    {
+        if (val < acc) {
+            acc = val;
+        }
+    }
+};
+
+template <typename T>
+struct MaxOp {
+    void operator()(T& acc, const T& val) const
+    {
+        if (acc < val) {
+            acc = val;
+        }
+    }
+};
+
+/**
+ * @brief Accumulator folding values of type T into a state of type T with Op.
+ */
+template <typename T, template <typename> typename Op>
+class FoldAccumulator : public Accumulator {
+public:
+    explicit FoldAccumulator(std::size_t col)
+        : col_(col)
+    {}
+
+    std::type_index outputType() const override
+    {
+        return typeid(T);
+    }
+
+    void update(std::any* state, const std::vector<std::any>& input) const override
+    {
+        if (const auto val = inputValue<T>(input, col_); val != nullptr) {
+            fold(state, *val);
+        }
+    }
+
+    void merge(std::any* state, std::any* other) const override
+    {
+        if (const auto val = std::any_cast<T>(other); val != nullptr) {
+            fold(state, *val);
+        }
+    }
+
+    std::any finish(std::any* state) const override
+    {
+        return std::move(*state);
+    }
+
+private:
+    static void fold(std::any* state, const T& val)
+    {
+        if (const auto acc = std::any_cast<T>(state); acc != nullptr) {
+            Op<T>()(*acc, val);
+        }
+        else {
+            *state = val;
+        }
+    }
+
+    const std::size_t col_;
+};
+
+/**
+ * @brief Accumulator counting values not null, or every row if col is kAllRows.
+ */
+class CountAccumulator : public Accumulator {
+public:
+    explicit CountAccumulator(std::size_t col)
+        : col_(col)
+    {}
+
+    std::type_index outputType() const override
+    {
+        return tiUint;
+    }
+
+    void update(std::any* state, const std::vector<std::any>& input) const override
+    {
+        if (col_ == kAllRows || input[col_].has_value()) {
+            add(state, 1);
+        }
+    }
+
+    void merge(std::any* state, std::any* other) const override
+    {
+        if (const auto count = std::any_cast<unsigned int>(other); count != nullptr) {
+            add(state, *count);
+        }
+    }
+
+    std::any finish(std::any* state) const override
+    {
+        return state->has_value() ? std::move(*state) : std::any(0u);
+    }
+
+private:
+    static void add(std::any* state, unsigned int n)
+    {
+        if (const auto count = std::any_cast<unsigned int>(state); count != nullptr) {
+            *count += n;
+        }
+        else {
+            *state = n;
+        }
+    }
+
+    const std::size_t col_;
+};
+
+/**
+ * @brief Accumulator averaging values of type T. The state is the sum in double and the count.
+ */
+template <typename T>
+class AvgAccumulator : public Accumulator {
+public:
+    explicit AvgAccumulator(std::size_t col)
+        : col_(col)
+    {}
+
+    std::size_t numStates() const override
+    {
+        return 2;
+    }
+
+    std::type_index outputType() const override
+    {
+        return tiDouble;
+    }
+
+    void update(std::any* state, const std::vector<std::any>& input) const override
+    {
+        if (const auto val = inputValue<T>(input, col_); val != nullptr) {
+            add(state, static_cast<double>(*val), 1);
+        }
+    }
+
+    void merge(std::any* state, std::any* other) const override
+    {
+        const auto sum = std::any_cast<double>(&other[0]);
+        const auto count = std::any_cast<unsigned int>(&other[1]);
+        if (sum != nullptr && count != nullptr) {
+            add(state, *sum, *count);
+        }
+    }
+
+    std::any finish(std::any* state) const override
+    {
+        const auto sum = std::any_cast<double>(&state[0]);
+        const auto count = std::any_cast<unsigned int>(&state[1]);
+        if (sum == nullptr || count == nullptr) {
+            return std::any();
+        }
+
+        return *sum / *count;
+    }
+
+private:
+    static void add(std::any* state, double sum, unsigned int count)
+    {
+        if (const auto accSum = std::any_cast<double>(&state[0]); accSum != nullptr) {
+            *accSum += sum;
+            *std::any_cast<unsigned int>(&state[1]) += count;
+        }
+        else {
+            state[0] = sum;
+            state[1] = count;
+        }
+    }
+
+    const std::size_t col_;
+};
+
+/**
+ * @brief Accumulator estimating the number of distinct values. The state is a HyperLogLog sketch.
+ */
+class ApproxCountDistinctAccumulator : public Accumulator {
+public:
+    explicit ApproxCountDistinctAccumulator(std::size_t col)
+        : col_(col)
+    {}
+
+    std::type_index outputType() const override
+    {
+        return tiUint;
+    }
+
+    void update(std::any* state, const std::vector<std::any>& input) const override
+    {
+        const auto& value = input[col_];
+        if (!value.has_value()) {
+            return;
+        }
+
+        auto sketch = std::any_cast<HyperLogLog>(state);
+        if (sketch == nullptr) {
+            sketch = &state->emplace<HyperLogLog>();
+        }
+        sketch->add(value);
+    }
+
+    void merge(std::any* state, std::any* other) const override
+    {
+        const auto otherSketch = std::any_cast<HyperLogLog>(other);
+        if (otherSketch == nullptr) {
+            return;
+        }
+
+        if (const auto sketch = std::any_cast<HyperLogLog>(state); sketch != nullptr) {
+            sketch->merge(*otherSketch);
+        }
+        else {
+            *state = std::move(*other);
+        }
+    }
+
+    std::any finish(std::any* state) const override
+    {
+        const auto sketch = std::any_cast<HyperLogLog>(state);
+        if (sketch == nullptr) {
+            return 0u;
+        }
+
+        return static_cast<unsigned int>(std::llround(sketch->estimate()));
+    }
+
+    std::size_t stateMemoryUsage(const std::any* state) const override
+    {
+        const auto sketch = std::any_cast<HyperLogLog>(state);
+        return sketch != nullptr ? sketch->memoryUsage() : 0;
+    }
+
+private:
+    const std::size_t col_;
+};
+
+/**
+ * @brief Accumulator estimating a quantile of values of type T. The state is a TDigest.
+ */
+template <typename T>
+class ApproxQuantileAccumulator : public Accumulator {
+public:
+    ApproxQuantileAccumulator(std::size_t col, double quantile)
+        : col_(col)
+        , quantile_(quantile)
+    {}
+
+    std::type_index outputType() const override
+    {
+        return tiDouble;
+    }
+
+    void update(std::any* state, const std::vector<std::any>& input) const override
+    {
+        const auto val = inputValue<T>(input, col_);
+        if (val == nullptr) {
+            return;
+        }
+
+        auto digest = std::any_cast<TDigest>(state);
+        if (digest == nullptr) {
+            digest = &state->emplace<TDigest>();
+        }
+        digest->add(static_cast<double>(*val));
+    }
+
+    void merge(std::any* state, std::any* other) const override
+    {
+        const auto otherDigest = std::any_cast<TDigest>(other);
+        if (otherDigest == nullptr) {
+            return;
+        }
+
+        if (const auto digest = std::any_cast<TDigest>(state); digest != nullptr) {
+            digest->merge(*otherDigest);
+        }
+        else {
+            *state = std::move(*other);
+        }
+    }
+
+    std::any finish(std::any* state) const override
+    {
+        const auto digest = std::any_cast<TDigest>(state);
+        if (digest == nullptr) {
+            return std::any();
+        }
+
+        return digest->quantile(quantile_);
+    }
+
+    std::size_t stateMemoryUsage(const std::any* state) const override
+    {
+        const auto digest = std::any_cast<TDigest>(state);
+        return digest != nullptr ? digest->memoryUsage() : 0;
+    }
+
+private:
+    const std::size_t col_;
+    const double quantile_;
+};
+
+template <typename T>
+using SumAccumulator = FoldAccumulator<T, SumOp>;
+
+template <typename T>
+using MinAccumulator = FoldAccumulator<T, MinOp>;
+
+template <typename T>
+using MaxAccumulator = FoldAccumulator<T, MaxOp>;
+
+// Instantiates Acc for the numeric type ti with the constructor arguments args.
+template <template <typename> typename Acc, typename... Args>
+std::unique_ptr<Accumulator> makeNumeric(std::type_index ti, Args... args)
+{
+    if (ti == tiInt) {
+        return std::make_unique<Acc<int>>(args...);
+    }
+    else if (ti == tiUint) {
+        return std::make_unique<Acc<unsigned int>>(args...);
+    }
+    else if (ti == tiFloat) {
+        return std::make_unique<Acc<float>>(args...);
+    }
+    else if (ti == tiDouble) {
+        return std::make_unique<Acc<double>>(args...);
+    }
+
+    throw UnsupportedOperation();
+}
+
+// Instantiates Acc for the numeric type, bool or string ti.
+template <template <typename> typename Acc>
+std::unique_ptr<Accumulator> makeOrdered(std::type_index ti, std::size_t col)
+{
+    if (ti == tiBool) {
+        return std::make_unique<Acc<bool>>(col);
+    }
+    else if (ti == tiString) {
+        return std::make_unique<Acc<std::string>>(col);
+    }
+
+    return makeNumeric<Acc>(ti, col);
+}
+
+}
+
+std::unique_ptr<Accumulator> makeAccumulator(const AggregateSpec& spec, const Metadata& inputMetadata)
+{
+    if (spec.function == AggregateFunction::Count && spec.column.empty()) {
+        return std::make_unique<CountAccumulator>(kAllRows);
+    }
+
+    const std::size_t col = inputMetadata[spec.column];
+    const auto ti = inputMetadata[col].typeIndex;
+
+    switch (spec.function) {
+    case AggregateFunction::Count:
+        return std::make_unique<CountAccumulator>(col);
+
+    case AggregateFunction::Sum:
+        return makeNumeric<SumAccumulator>(ti, col);
+
+    case AggregateFunction::Min:
+        return makeOrdered<MinAccumulator>(ti, col);
+
+    case AggregateFunction::Max:
+        return makeOrdered<MaxAccumulator>(ti, col);
+
+    case AggregateFunction::Avg:
+        return makeNumeric<AvgAccumulator>(ti, col);
+
+    case AggregateFunction::ApproxCountDistinct:
+        return std::make_unique<ApproxCountDistinctAccumulator>(col);
+
+    case AggregateFunction::ApproxQuantile:
+        if (!(spec.quantile >= 0 && spec.quantile <= 1)) {
+            throw UnsupportedOperation();
+        }
+        return makeNumeric<ApproxQuantileAccumulator>(ti, col, spec.quantile);
+    }
+
+    throw UnsupportedOperation();
+}
+
+} // namespace codein
@@ -0,0 +1,104 @@
+/**
+ * Copyright (C) 2021-present Codein Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify it under the terms of
+ * BSD-3-Clause License which can be found at the root directory of this repository.
+ */
+
+#include <any>
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <typeindex>
+#include <vector>
+
+#include "metadata.h"
+
+#pragma once
+
+namespace codein {
+
+/**
+ * @brief Built-in aggregate functions.
+ */
+enum class AggregateFunction {
+    Count,
+    Sum,
+    Min,
+    Max,
+    Avg,
+    // Approximate number of distinct values estimated with HyperLogLog.
+    ApproxCountDistinct,
+    // Approximate quantile estimated with t-digest.
+    ApproxQuantile,
+};
+
+/**
+ * @brief Built-in aggregation of an input column.
+ *
+ * Nulls are ignored like SQL does. Sum, Min, Max and Avg are null if every input value is null.
+ * Count counts values not null, or every row if column is empty. ApproxCountDistinct keeps
+ * a HyperLogLog sketch of the default precision per group, and its error is below 1% in most cases.
+ * ApproxQuantile keeps a t-digest of at most a few hundred centroids per group, which is most
+ * accurate near the tails, e.g. for p99.
+ */
+struct AggregateSpec {
+    AggregateFunction function;
+    // Name of the input column.
+    std::string column;
+    // Name of the output column.
+    std::string name;
+    // Quantile in [0, 1] for ApproxQuantile. e.g. 0.95 for p95.
+    double quantile = 0.5;
+};
+
+/**
+ * @brief Native implementation of a built-in aggregate function.
+ *
+ * The state of a group is a fixed number of values updated in place with the input row,
+ * without evaluating expressions or building rows of the state and the input.
+ */
+class Accumulator {
+public:
+    virtual ~Accumulator() = default;
+
+    /// Number of values of the state.
+    virtual std::size_t numStates() const
+    {
+        return 1;
+    }
+
+    /// Type of the aggregated value.
+    virtual std::type_index outputType() const = 0;
+
+    /**
+     * @brief Accumulates an input row into state. state is empty for the first row of a group.
+     * Throws UnsupportedOperation if the input value has an unexpected type.
+     */
+    virtual void update(std::any* state, const std::vector<std::any>& input) const = 0;
+
+    /// Accumulates other state of the same group, moving values out of other.
+    virtual void merge(std::any* state, std::any* other) const = 0;
+
+    /// Returns the aggregated value, moving values out of state.
+    virtual std::any finish(std::any* state) const = 0;
+
+    /// Bytes allocated on the heap by state, which are not counted in the size of its values.
+    virtual std::size_t stateMemoryUsage(const std::any* /* state */) const
+    {
+        return 0;
+    }
+};
+
+/**
+ * @brief Makes the accumulator of spec for input rows described by inputMetadata.
+ *
+ * Throws UnknownName if the column does not exist, and UnsupportedOperation if the function
+ * does not apply to the type of the column. Sum and Avg apply to numeric types. Min and Max
+ * apply to numeric types, bool and string. Count and ApproxCountDistinct apply to any type.
+ * ApproxQuantile applies to numeric types, and throws UnsupportedOperation if the quantile is
+ * not in [0, 1].
+ */
+std::unique_ptr<Accumulator> makeAccumulator(const AggregateSpec& spec, const Metadata& inputMetadata);
+
+} // namespace codein
@@ -0,0 +1,406 @@
+/**
+ * Copyright (C) 2021-present Codein Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify it under the terms of
+ * BSD-3-Clause License which can be found at the root directory of this repository.
+ */
+
+#include <algorithm>
+#include <any>
+#include <cassert>
+#include <string>
+#include <type_traits>
+#include <typeindex>
+#include <utility>
+#include <variant>
+#include <vector>
+
+#include "any_visitor.h"
+#include "batch.h"
+#include "to_any_converter.h"
+#include "value.h"
+
+namespace codein {
+
+namespace {
+
+Column::Storage makeStorage(const std::type_index& ti)
+{
+    if (ti == tiVoid) {
+        return std::monostate();
+    }
+    else if (ti == tiBool) {
+        return std::vector<bool>();
+    }
+    else if (ti == tiInt) {
+        return std::vector<int>();
+    }
+    else if (ti == tiUint) {
+        return std::vector<unsigned>();
+    }
+    else if (ti == tiFloat) {
+        return std::vector<float>();
+    }
+    else if (ti == tiDouble) {
+        return std::vector<double>();
+    }
+    else if (ti == tiString) {
+        return std::vector<std::string>();
+    }
+
+    throw UnsupportedOperation();
+}
+
+template <typename V>
+constexpr bool isUntyped = std::is_same_v<std::decay_t<V>, std::monostate>;
+
+}
+
+Column::Column(const std::type_index& ti)
+    : storage_(makeStorage(ti))
+    , nulls_()
+    , size_(0)
+{}
+
+std::type_index Column::type() const
+{
+    return std::visit([](const auto& vec) {
+        if constexpr (isUntyped<decltype(vec)>) {
+            return tiVoid;
+        }
+        else {
+            return std::type_index(typeid(typename std::decay_t<decltype(vec)>::value_type));
+        }
+    }, storage_);
+}
+
+bool Column::hasNulls() const
+{
+    return std::find(nulls_.cbegin(), nulls_.cend(), true) != nulls_.cend();
+}
+
+void Column::reserve(std::size_t n)
+{
+    std::visit([n](auto& vec) {
+        if constexpr (!isUntyped<decltype(vec)>) {
+            vec.reserve(n);
+        }
+    }, storage_);
+}
+
+void Column::clear()
+{
+    std::visit([](auto& vec) {
+        if constexpr (!isUntyped<decltype(vec)>) {
+            vec.clear();
+        }
+    }, storage_);
+    nulls_.clear();
+    size_ = 0;
+}
+
+void Column::append(const std::any& val)
+{
+    appendValue(val);
+}
+
+void Column::append(std::any&& val)
+{
+    appendValue(std::move(val));
+}
+
+template <typename A>
+void Column::appendValue(A&& val)
+{
+    if (!val.has_value()) {
+        appendNull();
+        return;
+    }
+
+    if (std::holds_alternative<std::monostate>(storage_)) {
+        storage_ = makeStorage(std::type_index(val.type()));
+        // Null values appended so far get default values in the new storage.
+        std::visit([this](auto& vec) {
+            if constexpr (!isUntyped<decltype(vec)>) {
+                vec.resize(size_);
+            }
+        }, storage_);
+    }
+
+    std::visit([&val](auto& vec) {
+        if constexpr (!isUntyped<decltype(vec)>) {
+            using T = typename std::decay_t<decltype(vec)>::value_type;
+            auto p = std::any_cast<T>(&val);
+            if (p == nullptr) {
+                throw UnsupportedOperation();
+            }
+
+            if constexpr (std::is_rvalue_reference_v<A&&>) {
+                vec.emplace_back(std::move(*p));
+            }
+            else {
+                vec.emplace_back(*p);
+            }
+        }
+    }, storage_);
+
+    if (!nulls_.empty()) {
+        nulls_.push_back(false);
+    }
+    ++size_;
+}
+
+void Column::appendNull()
+{
+    if (nulls_.empty()) {
+        nulls_.resize(size_, false);
+    }
+    nulls_.push_back(true);
+
+    std::visit([](auto& vec) {
+        if constexpr (!isUntyped<decltype(vec)>) {
+            vec.emplace_back();
+        }
+    }, storage_);
+    ++size_;
+}
+
+std::any Column::at(std::size_t i) const
+{
+    assert(i < size_);
+
+    if (isNull(i)) {
+        return nullany;
+    }
+
+    return std::visit([i](const auto& vec) -> std::any {
+        if constexpr (isUntyped<decltype(vec)>) {
+            return nullany;
+        }
+        else {
+            // Casting is required to unwrap the proxy reference of std::vector<bool>.
+            using T = typename std::decay_t<decltype(vec)>::value_type;
+            return std::any(static_cast<T>(vec[i]));
+        }
+    }, storage_);
+}
+
+Value Column::value(std::size_t i) const
+{
+    assert(i < size_);
+
+    if (isNull(i)) {
+        return Value();
+    }
+
+    return std::visit([i](const auto& vec) -> Value {
+        if constexpr (isUntyped<decltype(vec)>) {
+            return Value();
+        }
+        else {
+            using T = typename std::decay_t<decltype(vec)>::value_type;
+            return Value(static_cast<T>(vec[i]));
+        }
+    }, storage_);
+}
+
+void Column::appendColumn(const Column& other)
+{
+    if (std::holds_alternative<std::monostate>(other.storage_)) {
+        for (std::size_t i = 0; i < other.size_; ++i) {
+            appendNull();
+        }
+        return;
+    }
+
+    if (std::holds_alternative<std::monostate>(storage_)) {
+        storage_ = makeStorage(other.type());
+        std::visit([this](auto& vec) {
+            if constexpr (!isUntyped<decltype(vec)>) {
+                vec.resize(size_);
+            }
+        }, storage_);
+    }
+    else if (storage_.index() != other.storage_.index()) {
+        throw UnsupportedOperation();
+    }
+
+    std::visit([&other](auto& vec) {
+        if constexpr (!isUntyped<decltype(vec)>) {
+            const auto& src = std::get<std::decay_t<decltype(vec)>>(other.storage_);
+            vec.insert(vec.end(), src.begin(), src.end());
+        }
+    }, storage_);
+
+    if (!nulls_.empty() || !other.nulls_.empty()) {
+        nulls_.resize(size_, false);
+        if (other.nulls_.empty()) {
+            nulls_.resize(size_ + other.size_, false);
+        }
+        else {
+            nulls_.insert(nulls_.end(), other.nulls_.begin(), other.nulls_.end());
+        }
+    }
+    size_ += other.size_;
+}
+
+Column Column::slice(std::size_t begin, std::size_t n) const
+{
+    assert(begin + n <= size_);
+
+    Column column;
+    column.storage_ = std::visit([begin, n](const auto& vec) -> Storage {
+        if constexpr (isUntyped<decltype(vec)>) {
+            return std::monostate();
+        }
+        else {
+            return std::decay_t<decltype(vec)>(vec.begin() + begin, vec.begin() + begin + n);
+        }
+    }, storage_);
+
+    if (!nulls_.empty()) {
+        column.nulls_.assign(nulls_.begin() + begin, nulls_.begin() + begin + n);
+    }
+    column.size_ = n;
+
+    return column;
+}
+
+void Column::select(const SelectionVector& sel)
+{
+    std::visit([&sel](auto& vec) {
+        if constexpr (!isUntyped<decltype(vec)>) {
+            for (std::size_t j = 0; j < sel.size(); ++j) {
+                assert(j <= sel[j]);
+                if (j != sel[j]) {
+                    vec[j] = std::move(vec[sel[j]]);
+                }
+            }
+            vec.resize(sel.size());
+        }
+    }, storage_);
+
+    if (!nulls_.empty()) {
+        for (std::size_t j = 0; j < sel.size(); ++j) {
+            nulls_[j] = nulls_[sel[j]];
+        }
+        nulls_.resize(sel.size());
+    }
+
+    size_ = sel.size();
+}
+
+void Column::truncate(std::size_t n)
+{
+    assert(n <= size_);
+
+    std::visit([n](auto& vec) {
+        if constexpr (!isUntyped<decltype(vec)>) {
+            vec.resize(n);
+        }
+    }, storage_);
+
+    if (!nulls_.empty()) {
+        nulls_.resize(n);
+    }
+
+    size_ = n;
+}
+
+Batch::Batch(std::size_t numColumns)
+    : columns_(numColumns)
+    , numRows_(0)
+{}
+
+Batch::Batch(const Metadata& metadata)
+    : columns_()
+    , numRows_(0)
+{
+    columns_.reserve(metadata.size());
+    for (std::size_t i = 0; i < metadata.size(); ++i) {
+        columns_.emplace_back(metadata[i].typeIndex);
+    }
+}
+
+Batch::Batch(std::vector<Column>&& columns, std::size_t numRows)
+    : columns_(std::move(columns))
+    , numRows_(numRows)
+{
+    for (const auto& column: columns_) {
+        assert(column.size() == numRows_);
+    }
+}
+
+void Batch::reserve(std::size_t numRows)
+{
+    for (auto& column: columns_) {
+        column.reserve(numRows);
+    }
+}
+
+void Batch::appendRow(const std::vector<std::any>& row)
+{
+    assert(row.size() == columns_.size());
+
+    for (std::size_t i = 0; i < columns_.size(); ++i) {
+        columns_[i].append(row[i]);
+    }
+    ++numRows_;
+}
+
+void Batch::appendRow(std::vector<std::any>&& row)
+{
+    assert(row.size() == columns_.size());
+
+    for (std::size_t i = 0; i < columns_.size(); ++i) {
+        columns_[i].append(std::move(row[i]));
+    }
+    ++numRows_;
+}
+
+std::vector<std::any> Batch::row(std::size_t i) const
+{
+    std::vector<std::any> r;
+    readRow(i, r);
+
+    return r;
+}
+
+void Batch::readRow(std::size_t i, std::vector<std::any>& out) const
+{
+    out.clear();
+    out.reserve(columns_.size());
+    for (const auto& column: columns_) {
+        out.emplace_back(column.at(i));
+    }
+}
+
+void Batch::select(const SelectionVector& sel)
+{
+    for (auto& column: columns_) {
+        column.select(sel);
+    }
+    numRows_ = sel.size();
+}
+
+void Batch::truncate(std::size_t numRows)
+{
+    if (numRows >= numRows_) {
+        return;
+    }
+
+    for (auto& column: columns_) {
+        column.truncate(numRows);
+    }
+    numRows_ = numRows;
+}
+
+void Batch::clear()
+{
+    for (auto& column: columns_) {
+        column.clear();
+    }
+    numRows_ = 0;
+}
+
+} // namespace codein
@@ -0,0 +1,235 @@
+/**
+ * Copyright (C) 2021-present Codein Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify it under the terms of
+ * BSD-3-Clause License which can be found at the root directory of this repository.
+ */
+
+#include <any>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <typeindex>
+#include <utility>
+#include <variant>
+#include <vector>
+
+#include "metadata.h"
+#include "value.h"
+
+#pragma once
+
+namespace codein {
+
+/// Default maximum number of rows in a batch.
+constexpr std::size_t kDefaultBatchSize = 1024;
+
+/// Indexes of selected rows in a batch in ascending order.
+using SelectionVector = std::vector<std::uint32_t>;
+
+/**
+ * @brief A column of a batch.
+ *
+ * Values are stored in a vector of their native type instead of one std::any per value.
+ * A column created without a type adopts the type of the first non-null value appended to it.
+ */
+class Column {
+public:
+    using Storage = std::variant<
+        std::monostate,
+        std::vector<bool>,
+        std::vector<int>,
+        std::vector<unsigned>,
+        std::vector<float>,
+        std::vector<double>,
+        std::vector<std::string>
+    >;
+
+    Column() = default;
+
+    /**
+     * @brief Constructs an empty column of the given type.
+     *
+     * @param ti Type of values. tiVoid makes an untyped column.
+     */
+    explicit Column(const std::type_index& ti);
+
+    /// Type of values in this column. tiVoid if the column has not been typed yet.
+    std::type_index type() const;
+
+    std::size_t size() const
+    {
+        return size_;
+    }
+
+    bool empty() const
+    {
+        return size_ == 0;
+    }
+
+    bool isNull(std::size_t i) const
+    {
+        return !nulls_.empty() && nulls_[i];
+    }
+
+    /// Whether any value in this column is null.
+    bool hasNulls() const;
+
+    template <typename T>
+    bool holds() const
+    {
+        return std::holds_alternative<std::vector<T>>(storage_);
+    }
+
+    /// Native values of the column. Values at null positions are default-constructed.
+    template <typename T>
+    const std::vector<T>& values() const
+    {
+        return std::get<std::vector<T>>(storage_);
+    }
+
+    template <typename T>
+    std::vector<T>& values()
+    {
+        return std::get<std::vector<T>>(storage_);
+    }
+
+    void reserve(std::size_t n);
+
+    /// Replaces the column with non-null values of type T.
+    template <typename T>
+    void assign(std::vector<T>&& values)
+    {
+        size_ = values.size();
+        storage_ = std::move(values);
+        nulls_.clear();
+    }
+
+    /// Replaces the column with values of type T, null where nulls is true. nulls is either
+    /// empty for no nulls or as long as values.
+    template <typename T>
+    void assign(std::vector<T>&& values, std::vector<bool>&& nulls)
+    {
+        size_ = values.size();
+        storage_ = std::move(values);
+        nulls_ = std::move(nulls);
+    }
+
+    /// Removes all values but keeps the type and the capacity.
+    void clear();
+
+    /**
+     * @brief Appends a value. An empty std::any is appended as null.
+     *
+     * Throws UnsupportedOperation if the type of the value is different from the column type.
+     */
+    void append(const std::any& val);
+    void append(std::any&& val);
+
+    /// Value at i wrapped in std::any. nullany for null.
+    std::any at(std::size_t i) const;
+
+    /// Value at i. Null value for null.
+    Value value(std::size_t i) const;
+
+    /**
+     * @brief Appends all values of other, which must be untyped or of the type of this column.
+     * Throws UnsupportedOperation otherwise.
+     */
+    void appendColumn(const Column& other);
+
+    /// Copy of n values from begin.
+    Column slice(std::size_t begin, std::size_t n) const;
+
+    /// Keeps only the rows in sel, in the order of sel.
+    void select(const SelectionVector& sel);
+
+    /// Keeps only the first n values.
+    void truncate(std::size_t n);
+
+private:
+    template <typename A>
+    void appendValue(A&& val);
+
+    void appendNull();
+
+    Storage storage_;
+    // Null flags. Empty until the first null is appended.
+    std::vector<bool> nulls_;
+    std::size_t size_ = 0;
+};
+
+/**
+ * @brief A set of rows stored column by column.
+ *
+ * Iterators exchange batches through Iterator::processNextBatch() to amortize the per-row costs
+ * of processNext() over many rows.
+ */
+class Batch {
+public:
+    Batch() = default;
+
+    /// Constructs a batch of untyped columns.
+    explicit Batch(std::size_t numColumns);
+
+    /// Constructs a batch whose columns are typed according to metadata.
+    explicit Batch(const Metadata& metadata);
+
+    /// Constructs a batch of the given columns, each of which must have numRows values.
+    Batch(std::vector<Column>&& columns, std::size_t numRows);
+
+    std::size_t numColumns() const
+    {
+        return columns_.size();
+    }
+
+    std::size_t numRows() const
+    {
+        return numRows_;
+    }
+
+    bool empty() const
+    {
+        return numRows_ == 0;
+    }
+
+    const Column& column(std::size_t i) const
+    {
+        return columns_[i];
+    }
+
+    Column& column(std::size_t i)
+    {
+        return columns_[i];
+    }
+
+    void reserve(std::size_t numRows);
+
+    /**
+     * @brief Appends a row. The rvalue overload moves the values out of row but leaves the
+     * vector itself to the caller so that it can be reused.
+     */
+    void appendRow(const std::vector<std::any>& row);
+    void appendRow(std::vector<std::any>&& row);
+
+    /// Row i as a vector of values.
+    std::vector<std::any> row(std::size_t i) const;
+
+    /// Reads row i into out, reusing the storage of out.
+    void readRow(std::size_t i, std::vector<std::any>& out) const;
+
+    /// Keeps only the rows in sel.
+    void select(const SelectionVector& sel);
+
+    /// Keeps only the first numRows rows.
+    void truncate(std::size_t numRows);
+
+    /// Removes all rows but keeps column types and capacity.
+    void clear();
+
+private:
+    std::vector<Column> columns_;
+    std::size_t numRows_ = 0;
+};
+
+} // namespace codein
@@ -0,0 +1,49 @@
+/**
+ * Copyright (C) 2021-present Codein Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify it under the terms of
+ * BSD-3-Clause License which can be found at the root directory of this repository.
+ */
+
+#include <any>
+#include <optional>
+#include <vector>
+
+#include "batch_row_adapter.h"
+
+namespace codein {
+
+std::optional<std::vector<std::any>> BatchRowAdapter::processNext()
+{
+    if (!hasBufferedRows()) {
+        if (!child_->hasNext()) {
+            return std::nullopt;
+        }
+
+        batch_ = child_->processNextBatch(batchSize_);
+        pos_ = 0;
+        if (!batch_.has_value()) {
+            return std::nullopt;
+        }
+    }
+
+    return batch_->row(pos_++);
+}
+
+std::optional<Batch> BatchRowAdapter::processNextBatch(std::size_t maxRows)
+{
+    if (!hasBufferedRows()) {
+        batch_.reset();
+        return child_->hasNext() ? child_->processNextBatch(maxRows) : std::nullopt;
+    }
+
+    // Hand out the rest of the buffered batch first.
+    Batch rest(batch_->numColumns());
+    while (rest.numRows() < maxRows && pos_ < batch_->numRows()) {
+        rest.appendRow(batch_->row(pos_++));
+    }
+
+    return rest;
+}
+
+} // namespace codein
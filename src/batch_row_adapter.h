@@ -0,0 +1,92 @@
+/**
+ * Copyright (C) 2021-present Codein Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify it under the terms of
+ * BSD-3-Clause License which can be found at the root directory of this repository.
+ */
+
+#include <any>
+#include <memory>
+#include <optional>
+#include <vector>
+
+#include "batch.h"
+#include "iterator.h"
+
+#pragma once
+
+namespace codein {
+
+/**
+ * @brief Row adapter iterator. Pulls batches from its child and hands them out row by row
+ * so that callers of processNext() get the throughput of the child's batch path.
+ */
+class BatchRowAdapter : public Iterator {
+public:
+    template <typename T, typename... ArgTs>
+    friend std::unique_ptr<Iterator> makeIterator(ArgTs&&...);
+
+    void open() override
+    {
+        child_->open();
+        batch_.reset();
+        pos_ = 0;
+    }
+
+    void reopen() override
+    {
+        child_->reopen();
+        batch_.reset();
+        pos_ = 0;
+    }
+
+    bool hasNext() const override
+    {
+        return hasBufferedRows() || child_->hasNext();
+    }
+
+    std::optional<std::vector<std::any>> processNext() override;
+
+    std::optional<Batch> processNextBatch(std::size_t maxRows = kDefaultBatchSize) override;
+
+    void close() override
+    {
+        child_->close();
+    }
+
+    const Metadata& getMetadata() const override
+    {
+        return child_->getMetadata();
+    }
+
+    ~BatchRowAdapter() override
+    {}
+
+private:
+    /**
+     * @brief Constructs a new BatchRowAdapter object.
+     * 
+     * @param child: child iterator.
+     * @param batchSize: number of rows to request from the child at once.
+     */
+    BatchRowAdapter(std::unique_ptr<Iterator>&& child, std::size_t batchSize = kDefaultBatchSize)
+        : child_(std::move(child))
+        , batchSize_(batchSize)
+        , batch_()
+        , pos_(0)
+    {}
+
+    bool hasBufferedRows() const
+    {
+        return batch_.has_value() && pos_ < batch_->numRows();
+    }
+
+    std::unique_ptr<Iterator> child_;
+    const std::size_t batchSize_;
+    // batch being handed out row by row.
+    std::optional<Batch> batch_;
+    // index of the next row to hand out in batch_.
+    std::size_t pos_;
+};
+
+} // namespace codein
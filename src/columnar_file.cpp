@@ -0,0 +1,563 @@
+/**
+ * Copyright (C) 2021-present Codein Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify it under the terms of
+ * BSD-3-Clause License which can be found at the root directory of this repository.
+ */
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "any_visitor.h"
+#include "columnar_file.h"
+#include "to_any_converter.h"
+
+namespace codein {
+
+namespace {
+
+constexpr std::string_view kMagic("FALCOL01", 8);
+
+// Tag of a null value in the footer.
+constexpr std::uint8_t kNullTag = 0xff;
+
+enum class TypeTag : std::uint8_t {
+    Bool,
+    Int,
+    Uint,
+    Float,
+    Double,
+    String,
+};
+
+TypeTag typeTagOf(const std::type_index& ti)
+{
+    if (ti == tiBool) {
+        return TypeTag::Bool;
+    }
+    else if (ti == tiInt) {
+        return TypeTag::Int;
+    }
+    else if (ti == tiUint) {
+        return TypeTag::Uint;
+    }
+    else if (ti == tiFloat) {
+        return TypeTag::Float;
+    }
+    else if (ti == tiDouble) {
+        return TypeTag::Double;
+    }
+    else if (ti == tiString) {
+        return TypeTag::String;
+    }
+
+    throw UnsupportedOperation();
+}
+
+std::type_index typeIndexOf(TypeTag tag)
+{
+    switch (tag) {
+    case TypeTag::Bool:
+        return tiBool;
+    case TypeTag::Int:
+        return tiInt;
+    case TypeTag::Uint:
+        return tiUint;
+    case TypeTag::Float:
+        return tiFloat;
+    case TypeTag::Double:
+        return tiDouble;
+    case TypeTag::String:
+        return tiString;
+    }
+
+    throw InvalidColumnarFile();
+}
+
+// Calls f with a default value of the C++ type of ti.
+template <typename F>
+decltype(auto) visitType(const std::type_index& ti, F&& f)
+{
+    switch (typeTagOf(ti)) {
+    case TypeTag::Bool:
+        return f(bool());
+    case TypeTag::Int:
+        return f(int());
+    case TypeTag::Uint:
+        return f(unsigned());
+    case TypeTag::Float:
+        return f(float());
+    case TypeTag::Double:
+        return f(double());
+    case TypeTag::String:
+        return f(std::string());
+    }
+
+    throw UnsupportedOperation();
+}
+
+class ByteWriter {
+public:
+    template <typename T>
+    void put(const T& v)
+    {
+        if constexpr (std::is_same_v<T, std::string>) {
+            put(static_cast<std::uint32_t>(v.size()));
+            bytes_.append(v);
+        }
+        else if constexpr (std::is_same_v<T, bool>) {
+            bytes_.push_back(static_cast<char>(v));
+        }
+        else {
+            bytes_.append(reinterpret_cast<const char*>(&v), sizeof(v));
+        }
+    }
+
+    void putValue(const Value& v)
+    {
+        if (v.isNull()) {
+            put(kNullTag);
+            return;
+        }
+
+        std::visit([this, &v](const auto& x) {
+            using T = std::decay_t<decltype(x)>;
+            if constexpr (!std::is_same_v<T, std::monostate>) {
+                put(static_cast<std::uint8_t>(typeTagOf(v.type())));
+                put(x);
+            }
+        }, v.variant());
+    }
+
+    std::string& bytes()
+    {
+        return bytes_;
+    }
+
+private:
+    std::string bytes_;
+};
+
+class ByteReader {
+public:
+    explicit ByteReader(std::string_view data)
+        : data_(data)
+        , pos_(0)
+    {}
+
+    template <typename T>
+    T get()
+    {
+        if constexpr (std::is_same_v<T, std::string>) {
+            const auto size = get<std::uint32_t>();
+            return std::string(take(size));
+        }
+        else if constexpr (std::is_same_v<T, bool>) {
+            return take(1)[0] != 0;
+        }
+        else {
+            T v;
+            std::memcpy(&v, take(sizeof(T)).data(), sizeof(T));
+            return v;
+        }
+    }
+
+    Value getValue()
+    {
+        const auto tag = get<std::uint8_t>();
+        if (tag == kNullTag) {
+            return Value();
+        }
+
+        return visitType(typeIndexOf(static_cast<TypeTag>(tag)), [this](auto x) {
+            return Value(get<decltype(x)>());
+        });
+    }
+
+    std::string_view take(std::size_t size)
+    {
+        if (size > data_.size() - pos_) {
+            throw InvalidColumnarFile();
+        }
+
+        auto bytes = data_.substr(pos_, size);
+        pos_ += size;
+
+        return bytes;
+    }
+
+private:
+    std::string_view data_;
+    std::size_t pos_;
+};
+
+// Bytes of values[i] written by ByteWriter.
+template <typename T>
+std::size_t encodedSize(const std::vector<T>& values, std::size_t i)
+{
+    if constexpr (std::is_same_v<T, std::string>) {
+        return sizeof(std::uint32_t) + values[i].size();
+    }
+    else if constexpr (std::is_same_v<T, bool>) {
+        return 1;
+    }
+    else {
+        return sizeof(T);
+    }
+}
+
+// Whether two values are stored as the same run. Floating point values are compared bitwise,
+// so that -0.0 is not merged into 0.0 and runs of NaN are kept as they are.
+template <typename T>
+bool sameRunValue(const T& lhs, const T& rhs)
+{
+    if constexpr (std::is_same_v<T, float>) {
+        return std::bit_cast<std::uint32_t>(lhs) == std::bit_cast<std::uint32_t>(rhs);
+    }
+    else if constexpr (std::is_same_v<T, double>) {
+        return std::bit_cast<std::uint64_t>(lhs) == std::bit_cast<std::uint64_t>(rhs);
+    }
+    else {
+        return lhs == rhs;
+    }
+}
+
+// Appends a column chunk of column to out, and returns its encoding and statistics.
+template <typename T>
+ColumnChunkInfo encodeColumnChunk(const Column& column, bool compress, ByteWriter& out)
+{
+    const auto& values = column.values<T>();
+    const std::size_t n = column.size();
+
+    ColumnChunkInfo info{0, 0, ColumnEncoding::Plain, 0, Value(), Value()};
+
+    // Statistics, and sizes of both encodings. NaN is left out of the minimum and maximum.
+    constexpr std::size_t kNone = SIZE_MAX;
+    std::size_t plainSize = 0;
+    std::size_t runLengthSize = sizeof(std::uint32_t);
+    std::size_t minIdx = kNone;
+    std::size_t maxIdx = kNone;
+    for (std::size_t i = 0; i < n; ++i) {
+        const auto& v = values[i];
+        plainSize += encodedSize(values, i);
+        if (i == 0 || !sameRunValue<T>(v, values[i - 1])) {
+            runLengthSize += sizeof(std::uint32_t) + encodedSize(values, i);
+        }
+
+        if (column.isNull(i)) {
+            ++info.nullCount;
+            continue;
+        }
+        if constexpr (std::is_floating_point_v<T>) {
+            if (std::isnan(v)) {
+                continue;
+            }
+        }
+        if (minIdx == kNone) {
+            minIdx = i;
+            maxIdx = i;
+        }
+        else if (v < values[minIdx]) {
+            minIdx = i;
+        }
+        else if (values[maxIdx] < v) {
+            maxIdx = i;
+        }
+    }
+    if (minIdx != kNone) {
+        info.min = Value(T(values[minIdx]));
+        info.max = Value(T(values[maxIdx]));
+    }
+
+    info.encoding = compress && runLengthSize < plainSize ? ColumnEncoding::RunLength : ColumnEncoding::Plain;
+    out.put(static_cast<std::uint8_t>(info.encoding));
+
+    // Null flags as a bitmap, if any.
+    out.put(info.nullCount != 0);
+    if (info.nullCount != 0) {
+        for (std::size_t i = 0; i < n; i += 8) {
+            std::uint8_t bits = 0;
+            for (std::size_t j = i; j < std::min(i + 8, n); ++j) {
+                bits |= static_cast<std::uint8_t>(column.isNull(j)) << (j - i);
+            }
+            out.put(bits);
+        }
+    }
+
+    if (info.encoding == ColumnEncoding::Plain) {
+        for (std::size_t i = 0; i < n; ++i) {
+            out.put<T>(values[i]);
+        }
+        return info;
+    }
+
+    // Runs are counted first, and written as their lengths followed by their values.
+    std::uint32_t numRuns = 0;
+    for (std::size_t i = 0; i < n; ++i) {
+        numRuns += i == 0 || !sameRunValue<T>(values[i], values[i - 1]);
+    }
+    out.put(numRuns);
+    for (std::size_t i = 0; i < n;) {
+        std::size_t j = i + 1;
+        while (j < n && sameRunValue<T>(values[j], values[i])) {
+            ++j;
+        }
+        out.put(static_cast<std::uint32_t>(j - i));
+        out.put<T>(values[i]);
+        i = j;
+    }
+
+    return info;
+}
+
+template <typename T>
+Column decodeValues(ByteReader& in, ColumnEncoding encoding, std::vector<bool>&& nulls, std::size_t numRows)
+{
+    std::vector<T> values;
+    values.reserve(numRows);
+
+    if (encoding == ColumnEncoding::Plain) {
+        for (std::size_t i = 0; i < numRows; ++i) {
+            values.push_back(in.get<T>());
+        }
+    }
+    else if (encoding == ColumnEncoding::RunLength) {
+        const auto numRuns = in.get<std::uint32_t>();
+        for (std::uint32_t r = 0; r < numRuns; ++r) {
+            const auto length = in.get<std::uint32_t>();
+            if (length > numRows - values.size()) {
+                throw InvalidColumnarFile();
+            }
+            values.insert(values.end(), length, in.get<T>());
+        }
+    }
+    else {
+        throw InvalidColumnarFile();
+    }
+
+    if (values.size() != numRows) {
+        throw InvalidColumnarFile();
+    }
+
+    Column column;
+    column.assign(std::move(values), std::move(nulls));
+
+    return column;
+}
+
+}
+
+ColumnarFileWriter::ColumnarFileWriter(const std::string& fileName, const Metadata& metadata, const ColumnarWriteOptions& options)
+    : file_(fileName, std::ios::binary | std::ios::out | std::ios::trunc)
+    , metadata_(metadata)
+    , options_(options)
+    , buffer_()
+    , numBufferedRows_(0)
+    , footer_{metadata, {}}
+    , offset_(0)
+    , closed_(false)
+{
+    for (std::size_t i = 0; i < metadata_.size(); ++i) {
+        typeTagOf(metadata_[i].typeIndex);
+        buffer_.emplace_back(metadata_[i].typeIndex);
+    }
+
+    if (!file_.is_open()) {
+        throw ColumnarWriteFailure();
+    }
+    writeBytes(kMagic);
+}
+
+ColumnarFileWriter::~ColumnarFileWriter()
+{
+    if (!closed_) {
+        try {
+            close();
+        }
+        catch (...) {
+        }
+    }
+}
+
+void ColumnarFileWriter::writeBytes(std::string_view bytes)
+{
+    if (!file_.write(bytes.data(), bytes.size())) {
+        throw ColumnarWriteFailure();
+    }
+    offset_ += bytes.size();
+}
+
+void ColumnarFileWriter::write(const Batch& batch)
+{
+    if (batch.numColumns() != buffer_.size()) {
+        throw UnsupportedOperation();
+    }
+
+    for (std::size_t i = 0; i < buffer_.size(); ++i) {
+        buffer_[i].appendColumn(batch.column(i));
+    }
+    numBufferedRows_ += batch.numRows();
+
+    if (numBufferedRows_ >= options_.rowGroupSize) {
+        flushRowGroup();
+    }
+}
+
+void ColumnarFileWriter::flushRowGroup()
+{
+    RowGroupInfo rowGroup{numBufferedRows_, {}};
+
+    ByteWriter out;
+    for (std::size_t i = 0; i < buffer_.size(); ++i) {
+        out.bytes().clear();
+        auto info = visitType(metadata_[i].typeIndex, [&](auto x) {
+            return encodeColumnChunk<decltype(x)>(buffer_[i], options_.compress, out);
+        });
+        info.offset = offset_;
+        info.size = out.bytes().size();
+        writeBytes(out.bytes());
+
+        rowGroup.columns.push_back(std::move(info));
+        buffer_[i].clear();
+    }
+
+    footer_.rowGroups.push_back(std::move(rowGroup));
+    numBufferedRows_ = 0;
+}
+
+void ColumnarFileWriter::close()
+{
+    if (closed_) {
+        return;
+    }
+    closed_ = true;
+
+    if (numBufferedRows_ != 0) {
+        flushRowGroup();
+    }
+
+    ByteWriter out;
+    out.put(static_cast<std::uint32_t>(metadata_.size()));
+    for (std::size_t i = 0; i < metadata_.size(); ++i) {
+        out.put(metadata_[i].fieldName);
+        out.put(static_cast<std::uint8_t>(typeTagOf(metadata_[i].typeIndex)));
+    }
+
+    out.put(static_cast<std::uint64_t>(footer_.rowGroups.size()));
+    for (const auto& rowGroup: footer_.rowGroups) {
+        out.put(rowGroup.numRows);
+        for (const auto& chunk: rowGroup.columns) {
+            out.put(chunk.offset);
+            out.put(chunk.size);
+            out.put(static_cast<std::uint8_t>(chunk.encoding));
+            out.put(chunk.nullCount);
+            out.putValue(chunk.min);
+            out.putValue(chunk.max);
+        }
+    }
+
+    out.put(offset_);
+    writeBytes(out.bytes());
+    writeBytes(kMagic);
+
+    file_.close();
+    if (file_.fail()) {
+        throw ColumnarWriteFailure();
+    }
+}
+
+std::size_t writeColumnarFile(Iterator& iterator, const std::string& fileName, const ColumnarWriteOptions& options)
+{
+    ColumnarFileWriter writer(fileName, iterator.getMetadata(), options);
+
+    std::size_t numRows = 0;
+    iterator.open();
+    while (iterator.hasNext()) {
+        auto batch = iterator.processNextBatch();
+        if (!batch) {
+            break;
+        }
+
+        writer.write(*batch);
+        numRows += batch->numRows();
+    }
+    writer.close();
+
+    return numRows;
+}
+
+ColumnarFileFooter readColumnarFooter(std::string_view data)
+{
+    const std::size_t trailerSize = sizeof(std::uint64_t) + kMagic.size();
+    if (data.size() < kMagic.size() + trailerSize || data.substr(0, kMagic.size()) != kMagic
+        || data.substr(data.size() - kMagic.size()) != kMagic) {
+        throw InvalidColumnarFile();
+    }
+
+    std::uint64_t footerOffset;
+    std::memcpy(&footerOffset, data.data() + data.size() - trailerSize, sizeof(footerOffset));
+    if (footerOffset < kMagic.size() || footerOffset > data.size() - trailerSize) {
+        throw InvalidColumnarFile();
+    }
+
+    ByteReader in(data.substr(footerOffset, data.size() - trailerSize - footerOffset));
+
+    ColumnarFileFooter footer;
+    const auto numColumns = in.get<std::uint32_t>();
+    for (std::uint32_t i = 0; i < numColumns; ++i) {
+        auto name = in.get<std::string>();
+        const auto ti = typeIndexOf(static_cast<TypeTag>(in.get<std::uint8_t>()));
+        footer.metadata.emplace_back(name, ti);
+    }
+
+    const auto numRowGroups = in.get<std::uint64_t>();
+    for (std::uint64_t g = 0; g < numRowGroups; ++g) {
+        RowGroupInfo rowGroup{in.get<std::uint64_t>(), {}};
+        for (std::uint32_t i = 0; i < numColumns; ++i) {
+            ColumnChunkInfo chunk{0, 0, ColumnEncoding::Plain, 0, Value(), Value()};
+            chunk.offset = in.get<std::uint64_t>();
+            chunk.size = in.get<std::uint64_t>();
+            chunk.encoding = static_cast<ColumnEncoding>(in.get<std::uint8_t>());
+            chunk.nullCount = in.get<std::uint64_t>();
+            chunk.min = in.getValue();
+            chunk.max = in.getValue();
+            if (chunk.offset > footerOffset || chunk.size > footerOffset - chunk.offset) {
+                throw InvalidColumnarFile();
+            }
+            rowGroup.columns.push_back(std::move(chunk));
+        }
+        footer.rowGroups.push_back(std::move(rowGroup));
+    }
+
+    return footer;
+}
+
+Column decodeColumnChunk(std::string_view chunk, const std::type_index& ti, std::size_t numRows)
+{
+    ByteReader in(chunk);
+    const auto encoding = static_cast<ColumnEncoding>(in.get<std::uint8_t>());
+
+    std::vector<bool> nulls;
+    if (in.get<bool>()) {
+        const auto bitmap = in.take((numRows + 7) / 8);
+        nulls.resize(numRows);
+        for (std::size_t i = 0; i < numRows; ++i) {
+            nulls[i] = (static_cast<std::uint8_t>(bitmap[i / 8]) >> (i % 8)) & 1;
+        }
+    }
+
+    return visitType(ti, [&](auto x) {
+        return decodeValues<decltype(x)>(in, encoding, std::move(nulls), numRows);
+    });
+}
+
+} // namespace codein
@@ -0,0 +1,158 @@
+/**
+ * Copyright (C) 2021-present Codein Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify it under the terms of
+ * BSD-3-Clause License which can be found at the root directory of this repository.
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "batch.h"
+#include "iterator.h"
+#include "metadata.h"
+#include "value.h"
+
+#pragma once
+
+namespace codein {
+
+/**
+ * @brief Exception thrown when a columnar file is not in the expected format.
+ */
+class InvalidColumnarFile {};
+
+/**
+ * @brief Exception thrown when a columnar file cannot be written.
+ */
+class ColumnarWriteFailure {};
+
+/**
+ * @brief Encodings of column chunks.
+ */
+enum class ColumnEncoding : std::uint8_t {
+    // Values one after another.
+    Plain,
+    // Runs of equal values, each as its length and the value.
+    RunLength,
+};
+
+/**
+ * @brief Location and statistics of a column chunk, which holds values of a column in a row group.
+ */
+struct ColumnChunkInfo {
+    std::uint64_t offset;
+    std::uint64_t size;
+    ColumnEncoding encoding;
+    std::uint64_t nullCount;
+    // Minimum and maximum of values not null. Null if every value is null.
+    Value min;
+    Value max;
+};
+
+struct RowGroupInfo {
+    std::uint64_t numRows;
+    // One per column of the file.
+    std::vector<ColumnChunkInfo> columns;
+};
+
+/**
+ * @brief Footer of a columnar file describing its columns and row groups.
+ */
+struct ColumnarFileFooter {
+    Metadata metadata;
+    std::vector<RowGroupInfo> rowGroups;
+};
+
+/**
+ * @brief Options for ColumnarFileWriter.
+ */
+struct ColumnarWriteOptions {
+    // Number of rows of a row group. Row groups are cut at batch boundaries once they reach it.
+    std::size_t rowGroupSize = 64 * kDefaultBatchSize;
+    // Run-length encodes a column chunk if it gets smaller.
+    bool compress = true;
+};
+
+/**
+ * @brief Writer of columnar files.
+ *
+ * A columnar file stores rows in row groups, and each row group stores values column by
+ * column in typed column chunks with their null flags. The footer at the end of the file
+ * holds the metadata, and the location, the encoding, the null count and the minimum and
+ * maximum value of every column chunk, so that a scanner reads only the column chunks it
+ * needs. Numbers are stored in the byte order of the machine.
+ *
+ * File layout:
+ *   magic, column chunks of row group 0, column chunks of row group 1, ..., footer,
+ *   offset of the footer, magic
+ */
+class ColumnarFileWriter {
+public:
+    /**
+     * @brief Creates a columnar file. Throws ColumnarWriteFailure if it cannot be created,
+     * and UnsupportedOperation if a column has a type other than bool, int, uint, float,
+     * double and string.
+     *
+     * @param fileName: name of the file to create.
+     * @param metadata: metadata of rows to be written.
+     * @param options: options of writing.
+     */
+    ColumnarFileWriter(const std::string& fileName, const Metadata& metadata, const ColumnarWriteOptions& options = {});
+
+    ColumnarFileWriter(const ColumnarFileWriter&) = delete;
+    ColumnarFileWriter& operator=(const ColumnarFileWriter&) = delete;
+
+    /// Closes the file if it is not closed yet, ignoring failures.
+    ~ColumnarFileWriter();
+
+    /**
+     * @brief Writes the rows of batch. Throws UnsupportedOperation if a column of batch is
+     * typed differently from the metadata.
+     */
+    void write(const Batch& batch);
+
+    /// Writes the buffered rows and the footer, and closes the file.
+    void close();
+
+private:
+    // Writes buffered rows as a row group.
+    void flushRowGroup();
+
+    void writeBytes(std::string_view bytes);
+
+    std::ofstream file_;
+    const Metadata metadata_;
+    const ColumnarWriteOptions options_;
+    // Columns of rows not written yet, typed according to metadata_.
+    std::vector<Column> buffer_;
+    std::size_t numBufferedRows_;
+    ColumnarFileFooter footer_;
+    std::uint64_t offset_;
+    bool closed_;
+};
+
+/**
+ * @brief Writes all rows of iterator into a columnar file.
+ *
+ * @return the number of rows written.
+ */
+std::size_t writeColumnarFile(Iterator& iterator, const std::string& fileName, const ColumnarWriteOptions& options = {});
+
+/**
+ * @brief Reads the footer of a columnar file in data. Throws InvalidColumnarFile if data is
+ * not a columnar file.
+ */
+ColumnarFileFooter readColumnarFooter(std::string_view data);
+
+/**
+ * @brief Decodes a column chunk of numRows values of type ti. Throws InvalidColumnarFile if
+ * the chunk is broken.
+ */
+Column decodeColumnChunk(std::string_view chunk, const std::type_index& ti, std::size_t numRows);
+
+} // namespace codein
@@ -0,0 +1,210 @@
+/**
+ * Copyright (C) 2021-present Codein Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify it under the terms of
+ * BSD-3-Clause License which can be found at the root directory of this repository.
+ */
+
+#include <algorithm>
+#include <any>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <variant>
+#include <vector>
+
+#include "columnar_file_scanner.h"
+#include "csv_file_scanner.h"
+
+namespace codein {
+
+namespace {
+
+// Whether expr is the constant true.
+bool isAlwaysTrue(const Expression& expr)
+{
+    if (expr.opCode != OpCode::Const || !std::holds_alternative<std::any>(expr.leafOrChildren)) {
+        return false;
+    }
+
+    const auto b = std::any_cast<bool>(&expr.leaf());
+    return b != nullptr && *b;
+}
+
+}
+
+ColumnarFileScanner::ColumnarFileScanner(
+    const std::string& fileName, const std::vector<std::string>& columns, const Expression& filterExpr)
+    : file_()
+    , footer_()
+    , metadata_()
+    , columns_()
+    , scanColumns_()
+    , scanMetadata_()
+    , filtered_(false)
+    , filterExpr_(filterExpr)
+    , compiledFilter_()
+    , kernel_()
+    , zoneMap_(kAlwaysTrue, Metadata())
+    , nextRowGroup_(0)
+    , current_()
+    , pos_(0)
+{
+    if (!file_.open(fileName)) {
+        throw NonExistentFile();
+    }
+    footer_ = readColumnarFooter(file_.data());
+
+    if (columns.empty()) {
+        for (std::size_t i = 0; i < footer_.metadata.size(); ++i) {
+            columns_.push_back(i);
+        }
+    }
+    else {
+        for (const auto& name: columns) {
+            columns_.push_back(footer_.metadata[name]);
+        }
+    }
+
+    for (auto col: columns_) {
+        metadata_.emplace_back(footer_.metadata[col]);
+    }
+
+    setUpFilter();
+
+    // Nothing is output before open().
+    nextRowGroup_ = footer_.rowGroups.size();
+}
+
+void ColumnarFileScanner::setUpFilter()
+{
+    filtered_ = !isAlwaysTrue(filterExpr_);
+
+    scanColumns_ = columns_;
+    if (filtered_) {
+        appendReferencedColumns(filterExpr_, footer_.metadata, scanColumns_);
+    }
+    scanMetadata_ = Metadata();
+    for (auto col: scanColumns_) {
+        scanMetadata_.emplace_back(footer_.metadata[col]);
+    }
+
+    if (filtered_) {
+        compiledFilter_ = filterExpr_.compile(scanMetadata_);
+        kernel_ = makePredicateKernel(filterExpr_, scanMetadata_);
+        zoneMap_ = ZoneMap(filterExpr_, footer_.metadata);
+    }
+}
+
+void ColumnarFileScanner::addFilter(const Expression& expr)
+{
+    filterExpr_ = conjunction(filterExpr_, expr);
+    setUpFilter();
+}
+
+void ColumnarFileScanner::open()
+{
+    nextRowGroup_ = 0;
+    current_ = Batch();
+    pos_ = 0;
+    skipPrunedRowGroups();
+}
+
+void ColumnarFileScanner::skipPrunedRowGroups()
+{
+    while (nextRowGroup_ < footer_.rowGroups.size() && !zoneMap_.mayMatch(footer_.rowGroups[nextRowGroup_].columns)) {
+        ++nextRowGroup_;
+    }
+}
+
+void ColumnarFileScanner::loadRowGroup()
+{
+    const auto& rowGroup = footer_.rowGroups[nextRowGroup_++];
+    const auto numRows = static_cast<std::size_t>(rowGroup.numRows);
+
+    std::vector<Column> columns;
+    columns.reserve(scanColumns_.size());
+    for (auto col: scanColumns_) {
+        const auto& chunk = rowGroup.columns[col];
+        columns.push_back(decodeColumnChunk(
+            file_.data().substr(chunk.offset, chunk.size), footer_.metadata[col].typeIndex, numRows));
+    }
+
+    current_ = Batch(std::move(columns), numRows);
+    pos_ = 0;
+    skipPrunedRowGroups();
+
+    if (!filtered_) {
+        return;
+    }
+
+    // Rows are materialized only if the kernel doesn't apply to the row group.
+    std::vector<std::uint8_t> mask;
+    SelectionVector sel;
+    if (kernel_ && kernel_->eval(current_, mask)) {
+        toSelectionVector(mask, sel);
+    }
+    else {
+        std::vector<std::any> row;
+        for (std::size_t i = 0; i < current_.numRows(); ++i) {
+            current_.readRow(i, row);
+            if (asBool(compiledFilter_.evalValue(row))) {
+                sel.push_back(i);
+            }
+        }
+    }
+    if (sel.size() != current_.numRows()) {
+        current_.select(sel);
+    }
+
+    // Columns decoded only for the filter are dropped.
+    if (scanColumns_.size() != columns_.size()) {
+        std::vector<Column> outputColumns;
+        outputColumns.reserve(columns_.size());
+        for (std::size_t i = 0; i < columns_.size(); ++i) {
+            outputColumns.push_back(std::move(current_.column(i)));
+        }
+        current_ = Batch(std::move(outputColumns), sel.size());
+    }
+}
+
+std::optional<std::vector<std::any>> ColumnarFileScanner::processNext()
+{
+    while (pos_ == current_.numRows()) {
+        if (nextRowGroup_ == footer_.rowGroups.size()) {
+            return std::nullopt;
+        }
+        loadRowGroup();
+    }
+
+    return current_.row(pos_++);
+}
+
+std::optional<Batch> ColumnarFileScanner::processNextBatch(std::size_t maxRows)
+{
+    while (pos_ == current_.numRows()) {
+        if (nextRowGroup_ == footer_.rowGroups.size()) {
+            return std::nullopt;
+        }
+        loadRowGroup();
+    }
+
+    // The whole row group is handed over if it fits in a batch.
+    if (pos_ == 0 && current_.numRows() <= maxRows) {
+        auto batch = std::move(current_);
+        current_ = Batch();
+        return batch;
+    }
+
+    const auto n = std::min(maxRows, current_.numRows() - pos_);
+    std::vector<Column> columns;
+    columns.reserve(current_.numColumns());
+    for (std::size_t i = 0; i < current_.numColumns(); ++i) {
+        columns.push_back(current_.column(i).slice(pos_, n));
+    }
+    pos_ += n;
+
+    return Batch(std::move(columns), n);
+}
+
+} // namespace codein
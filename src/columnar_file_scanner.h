@@ -0,0 +1,122 @@
+/**
+ * Copyright (C) 2021-present Codein Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify it under the terms of
+ * BSD-3-Clause License which can be found at the root directory of this repository.
+ */
+
+#include <any>
+#include <cstddef>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "batch.h"
+#include "columnar_file.h"
+#include "expression.h"
+#include "iterator.h"
+#include "mapped_file.h"
+#include "metadata.h"
+#include "typed_kernel.h"
+#include "zone_map.h"
+
+#pragma once
+
+namespace codein {
+
+/**
+ * @brief Scanner iterator of a columnar file written by ColumnarFileWriter.
+ *
+ * The file is memory-mapped, and only the column chunks of the requested columns are decoded,
+ * one row group at a time. Values are decoded straight into typed batch columns without
+ * parsing text. Row groups where the zone map of the filter rules out every row are skipped
+ * without being decoded.
+ */
+class ColumnarFileScanner : public Iterator {
+public:
+    template <typename T, typename... ArgTs>
+    friend std::unique_ptr<Iterator> makeIterator(ArgTs&&...);
+    friend class PredicatePushdown;
+
+    void open() override;
+
+    void reopen() override
+    {
+        open();
+    }
+
+    bool hasNext() const override
+    {
+        return pos_ < current_.numRows() || nextRowGroup_ < footer_.rowGroups.size();
+    }
+
+    std::optional<std::vector<std::any>> processNext() override;
+
+    std::optional<Batch> processNextBatch(std::size_t maxRows = kDefaultBatchSize) override;
+
+    void close() override
+    {}
+
+    const Metadata& getMetadata() const override
+    {
+        return metadata_;
+    }
+
+    ~ColumnarFileScanner() override
+    {}
+
+private:
+    /**
+     * @brief Constructs a new ColumnarFileScanner object.
+     *
+     * Throws NonExistentFile if the file cannot be opened, InvalidColumnarFile if it is not
+     * a columnar file, and UnknownName if a requested column does not exist.
+     *
+     * @param fileName: name of the columnar file.
+     * @param columns: columns to read in the order of output. Every column if empty.
+     * @param filterExpr: Expression to filter rows. It may refer to columns not to be output.
+     */
+    ColumnarFileScanner(const std::string& fileName, const std::vector<std::string>& columns = {},
+        const Expression& filterExpr = kAlwaysTrue);
+
+    // Sets up the columns to decode, the compiled filter and the zone map for filterExpr_.
+    void setUpFilter();
+
+    // Filters rows also by expr, which refers to columns of the file like filterExpr_.
+    void addFilter(const Expression& expr);
+
+    // Decodes the requested columns of the next row group into current_, and filters it.
+    void loadRowGroup();
+
+    // Advances nextRowGroup_ past row groups where no row can pass the filter.
+    void skipPrunedRowGroups();
+
+    MappedFile file_;
+    ColumnarFileFooter footer_;
+    // Output metadata, and the columns of the file output.
+    Metadata metadata_;
+    std::vector<std::size_t> columns_;
+    // Columns of the file decoded, which are columns_ followed by the other columns the filter
+    // refers to, and their metadata.
+    std::vector<std::size_t> scanColumns_;
+    Metadata scanMetadata_;
+
+    // Whether filterExpr_ may filter out rows. It is not evaluated otherwise.
+    bool filtered_;
+    Expression filterExpr_;
+    // filterExpr_ compiled against scanMetadata_, and its kernel. kernel_ is nullptr if
+    // filterExpr_ has no kernel.
+    CompiledExpression compiledFilter_;
+    std::unique_ptr<PredicateKernel> kernel_;
+    // filterExpr_ analyzed against the metadata of the file.
+    ZoneMap zoneMap_;
+
+    // Index of the row group to load next.
+    std::size_t nextRowGroup_;
+    // Rows of the loaded row group, and the position of the next row to output.
+    Batch current_;
+    std::size_t pos_;
+};
+
+} // namespace codein
@@ -5,45 +5,36 @@
  * BSD-3-Clause License which can be found at the root directory of this repository.
  */
 
+#include <algorithm>
 #include <cassert>
 #include <fstream>
 #include <iostream>
 #include <optional>
 #include <string>
+#include <string_view>
 #include <vector>
 
 #include "any_visitor.h"
 #include "csv_file_scanner.h"
 #include "iterator.h"
 #include "metadata.h"
+#include "structural_scanner.h"
 #include "to_any_converter.h"
+#include "value.h"
 
 namespace codein {
 
 std::vector<std::string> parseLine(const std::string& line)
 {
-    int left = 0;
-    int right = 0;
-    int len = line.length();
-    int i = 0;
-    std::vector<std::string> strs;
-
-    while (i <= len) {
-        if (i == len || line.at(i) == ','){
-            strs.emplace_back(line.substr(left, right - left));
-            left = 0;
-            right = 0;
-        }
-        else if (line.at(i) != ' ' && line.at(i) != '\t') {
-            if (right == 0) {
-                left = i;
-            }
-            right = i+1;
-        }
-        
-        i++;
-    }
-    return strs;
+    std::vector<std::string_view> fields;
+    parseLine(line, fields);
+
+    return std::vector<std::string>(fields.cbegin(), fields.cend());
+}
+
+void parseLine(std::string_view line, std::vector<std::string_view>& fields)
+{
+    splitFields(line, fields, false);
 }
 
 Metadata parseLineMetadata(const std::string& line)
@@ -83,7 +74,7 @@ Metadata parseLineMetadata(const std::string& line)
     return reVec;
 }
 
-void CsvFileScanner::constructorHelper(const std::string& metadataFileName, const std::string& dataFileName) 
+Metadata readMetadataFile(const std::string& metadataFileName)
 {
     std::fstream mfs(metadataFileName);
     if (!mfs.is_open()) {
@@ -91,7 +82,62 @@ void CsvFileScanner::constructorHelper(const std::string& metadataFileName, cons
     }
     std::string reading;
     std::getline(mfs, reading);
-    metadata_ = parseLineMetadata(reading);
+
+    return parseLineMetadata(reading);
+}
+
+bool convertFields(const Metadata& metadata, const std::vector<std::string_view>& fields,
+    const std::vector<std::size_t>& cols, std::vector<std::any>& r)
+{
+    for (auto i: cols) {
+        if (metadata[i].typeIndex == tiString) {
+            if (const auto s = std::any_cast<std::string>(&r[i]); s != nullptr) {
+                s->assign(fields[i]);
+            }
+            else {
+                r[i] = std::string(fields[i]);
+            }
+            continue;
+        }
+
+        auto field = convertToValue(metadata[i].typeIndex, fields[i]);
+        if (field.isNull()) {
+            return false;
+        }
+        r[i] = toAny(std::move(field));
+    }
+
+    return true;
+}
+
+void findConvertedColumns(const Expression& filterExpr, const std::vector<Expression>& projections,
+    const Metadata& metadata, std::vector<std::size_t>& filterColumns, std::vector<std::size_t>& projectedColumns)
+{
+    filterColumns.clear();
+    appendReferencedColumns(filterExpr, metadata, filterColumns);
+
+    // Columns in filterColumns are not appended again.
+    auto columns = filterColumns;
+    for (const auto& projection: projections) {
+        appendReferencedColumns(projection, metadata, columns);
+    }
+    projectedColumns.assign(columns.begin() + filterColumns.size(), columns.end());
+
+    std::sort(filterColumns.begin(), filterColumns.end());
+    std::sort(projectedColumns.begin(), projectedColumns.end());
+}
+
+void CsvFileScanner::constructorHelper(const std::string& metadataFileName, const std::string& dataFileName) 
+{
+    metadata_ = readMetadataFile(metadataFileName);
+    compiledFilter_ = filterExpr_.compile(metadata_);
+
+    if (options_.memoryMapped) {
+        if (!mappedFile_.open(dataFileName)) {
+            throw NonExistentFile();
+        }
+        return;
+    }
 
     dfs_.open(dataFileName);
     if (!dfs_.is_open()) {
@@ -102,33 +148,71 @@ void CsvFileScanner::constructorHelper(const std::string& metadataFileName, cons
 CsvFileScanner::CsvFileScanner(
     const std::string& metadataFileName,
     const std::string& dataFileName,
-    const Expression& filterExpr)
+    const Expression& filterExpr,
+    const CsvScanOptions& options)
     : metadata_()
     , dfs_()
     , filterExpr_(filterExpr)
     , readLines_(0)
     , errorLines_(0)
+    , options_(options)
+    , mappedFile_()
+    , pos_(0)
 {
     constructorHelper(metadataFileName, dataFileName);
 
     for (size_t i = 0; i < metadata_.size(); ++i) {
         projections_.emplace_back(OpCode::Ref, metadata_[i].fieldName);
     }
+    compileProjections();
 }
 
 CsvFileScanner::CsvFileScanner(
     const std::string& metadataFileName,
     const std::string& dataFileName,
     const Expression& filterExpr,
-    const std::vector<Expression>& projections)
+    const std::vector<Expression>& projections,
+    const CsvScanOptions& options)
     : metadata_()
     , dfs_()
     , filterExpr_(filterExpr)
     , readLines_(0)
     , errorLines_(0)
     , projections_(projections)
+    , options_(options)
+    , mappedFile_()
+    , pos_(0)
 {
     constructorHelper(metadataFileName, dataFileName);
+    compileProjections();
+}
+
+void CsvFileScanner::compileProjections()
+{
+    compiledProjections_ = compile(projections_, metadata_);
+
+    findConvertedColumns(filterExpr_, projections_, metadata_, filterColumns_, projectedColumns_);
+}
+
+void CsvFileScanner::addFilter(const Expression& expr)
+{
+    filterExpr_ = conjunction(filterExpr_, expr);
+    compiledFilter_ = filterExpr_.compile(metadata_);
+    compileProjections();
+}
+
+void CsvFileScanner::reopen()
+{
+    open();
+    readLines_ = 0;
+    errorLines_= 0;
+
+    // Rewind to the first line.
+    pos_ = 0;
+    if (dfs_.is_open()) {
+        dfs_.clear();
+        dfs_.seekg(0);
+    }
 }
 
 void CsvFileScanner::checkError() 
@@ -150,29 +234,43 @@ void CsvFileScanner::checkError()
     }
 }
 
-std::optional<std::vector<std::any>> CsvFileScanner::processNext()
+bool CsvFileScanner::readNextFields()
 {
-    if (!hasNext()) {
-        return std::nullopt;
+    if (options_.memoryMapped) {
+        const auto data = mappedFile_.data();
+        if (pos_ >= data.size()) {
+            return false;
+        }
+
+        // Splits fields and finds the end of the line in the same pass over the data.
+        pos_ += splitFields(data.substr(pos_), fields_, true) + 1;
+
+        return true;
     }
 
-    std::vector<std::any> r;
-    std::string line;
-    while (r.empty()) {
-        std::getline(dfs_, line);
-        auto fields = parseLine(line);
-        
-        if (dfs_.fail()) {
+    std::getline(dfs_, line_);
+    if (dfs_.fail()) {
+        return false;
+    }
+    parseLine(line_, fields_);
+
+    return true;
+}
+
+bool CsvFileScanner::readNextRow(std::vector<std::any>& r)
+{
+    while (true) {
+        if (!readNextFields()) {
             if (errorLines_ != 0) {
                 std::cerr << "There were some discrepencies between metadata and actual data lines: \n"
                           << "read lines: " << readLines_ << "\nerror lines " << errorLines_ << std::endl;
             }
 
-            return std::nullopt;
+            return false;
         }
         ++readLines_;
 
-        if (fields.size() != metadata_.size()) {
+        if (fields_.size() != metadata_.size()) {
             ++errorLines_;
 
             checkError();
@@ -180,34 +278,81 @@ std::optional<std::vector<std::any>> CsvFileScanner::processNext()
             continue;
         }
 
-        for (size_t i = 0; i < metadata_.size(); ++i) {
-            const auto field = convertTo(metadata_[i].typeIndex, fields[i]);
-            if (!field.has_value()) {
-                ++errorLines_;
+        // Only the fields referred to by the filter or projections are converted, so fields
+        // of the other columns are not checked against metadata_. Fields only projections
+        // refer to are converted after the line passes the filter.
+        if (r.size() != metadata_.size()) {
+            r.assign(metadata_.size(), std::any());
+        }
+        if (!convertFields(metadata_, fields_, filterColumns_, r)) {
+            ++errorLines_;
 
-                checkError();
+            checkError();
 
-                r.clear();
-                break;
-            }
+            continue;
+        }
 
-            r.emplace_back(field);
+        if (notValue(compiledFilter_.evalValue(r))) {
+            continue;
         }
 
-        auto hasFilterPassed = filterExpr_.eval(metadata_, r);
-        if (notAny(hasFilterPassed)) {
-            r.clear();
+        if (!convertFields(metadata_, fields_, projectedColumns_, r)) {
+            ++errorLines_;
+
+            checkError();
+
+            continue;
         }
+
+        return true;
+    }
+}
+
+std::optional<std::vector<std::any>> CsvFileScanner::processNext()
+{
+    if (!hasNext()) {
+        return std::nullopt;
+    }
+
+    if (!readNextRow(row_)) {
+        return std::nullopt;
     }
 
     size_t size = projections_.size();
     std::vector<std::any> output;
     output.reserve(size);
     for (size_t i = 0; i < size; ++i) {
-        output.emplace_back(std::move(projections_[i].eval(metadata_, r)));
+        output.emplace_back(std::move(compiledProjections_[i].eval(row_)));
     }
 
     return std::move(output);
 }
 
+std::optional<Batch> CsvFileScanner::processNextBatch(std::size_t maxRows)
+{
+    if (!hasNext()) {
+        return std::nullopt;
+    }
+
+    size_t size = projections_.size();
+    Batch batch(size);
+    std::vector<std::any> output;
+    output.reserve(size);
+
+    while (batch.numRows() < maxRows && readNextRow(row_)) {
+        for (size_t i = 0; i < size; ++i) {
+            output.emplace_back(compiledProjections_[i].eval(row_));
+        }
+
+        batch.appendRow(std::move(output));
+        output.clear();
+    }
+
+    if (batch.empty()) {
+        return std::nullopt;
+    }
+
+    return batch;
+}
+
 } // namespace codein
@@ -10,10 +10,12 @@
 #include <memory>
 #include <optional>
 #include <string>
+#include <string_view>
 #include <vector>
 
 #include "expression.h"
 #include "iterator.h"
+#include "mapped_file.h"
 #include "metadata.h"
 
 #pragma once
@@ -28,6 +30,14 @@ namespace codein {
  */
 std::vector<std::string> parseLine(const std::string& line);
 
+/**
+ * @brief Splits fields in a line without copying them, trimming extra spaces on both sides of each field.
+ * 
+ * @param line: Input line in which each field is supposed to be separated by comma.
+ * @param fields: receives views of each field into line. Its storage is reused.
+ */
+void parseLine(std::string_view line, std::vector<std::string_view>& fields);
+
 /**
  * @brief Converts string typeName into corresponding type_index. 
  * 
@@ -46,6 +56,47 @@ std::type_index convertToTypeid(const std::string& typeName);
  */
 Metadata parseLineMetadata(const std::string& line);
 
+/**
+ * @brief Reads metadata from the first line of a metadata file.
+ * 
+ * @param metadataFileName: name of the metadata file.
+ * @return Metadata in the file. Throws NonExistentFile if the file cannot be opened.
+ */
+Metadata readMetadataFile(const std::string& metadataFileName);
+
+/**
+ * @brief Converts the fields of columns cols into their slots in r, which has one per column
+ * of metadata. A string already in a slot is overwritten in place so that its storage is
+ * reused instead of allocating a new string for every line.
+ *
+ * @param metadata: metadata of the fields.
+ * @param fields: fields of a line.
+ * @param cols: columns to convert.
+ * @param r: row receiving converted values.
+ * @return false if a field cannot be converted into the type of its column.
+ */
+bool convertFields(const Metadata& metadata, const std::vector<std::string_view>& fields,
+    const std::vector<std::size_t>& cols, std::vector<std::any>& r);
+
+/**
+ * @brief Finds the columns of metadata a scan converts. Fields of filterColumns are converted
+ * before the filter is evaluated, and fields of projectedColumns only for lines passing it.
+ *
+ * @param filterColumns: receives the columns filterExpr refers to in ascending order.
+ * @param projectedColumns: receives the other columns projections refer to in ascending order.
+ */
+void findConvertedColumns(const Expression& filterExpr, const std::vector<Expression>& projections,
+    const Metadata& metadata, std::vector<std::size_t>& filterColumns, std::vector<std::size_t>& projectedColumns);
+
+/**
+ * @brief Options for CsvFileScanner.
+ */
+struct CsvScanOptions {
+    // Maps the data file into memory and parses fields in place instead of reading lines
+    // through a file stream.
+    bool memoryMapped = false;
+};
+
 /**
  * @brief CSV file scanner iterator. Scan the given CSV-formatted file.
  */
@@ -53,19 +104,15 @@ class CsvFileScanner : public Iterator {
 public:
     template <typename T, typename... ArgTs>
     friend std::unique_ptr<Iterator> makeIterator(ArgTs&&...);
+    friend class PredicatePushdown;
 
     void open() override {}
 
-    void reopen() override
-    {
-        open();
-        readLines_ = 0;
-        errorLines_= 0;
-    }
+    void reopen() override;
 
     bool hasNext() const override
     {
-        return !dfs_.eof();
+        return options_.memoryMapped ? pos_ < mappedFile_.size() : !dfs_.eof();
     }
 
     /** 
@@ -74,9 +121,16 @@ public:
      */
     std::optional<std::vector<std::any>> processNext() override;
 
+    /**
+     * @brief Processes up to maxRows next valid lines that pass the filter test.
+     * @returns projected data of the lines as a batch. nullopt if there's no more valid line.
+     */
+    std::optional<Batch> processNextBatch(std::size_t maxRows = kDefaultBatchSize) override;
+
     void close() override
     {
         dfs_.close();
+        mappedFile_.close();
     }
 
     const Metadata& getMetadata() const override
@@ -100,9 +154,11 @@ private:
      * @param metadataFileName: name of the file that contains metadata about CSV file. 
      * @param dataFileName: name of the CSV file that this CsvFileScanner will read. 
      * @param filterExpr: Expression to filter desired lines. if not specified, passes every line.
+     * @param options: options of scanning.
      */
     CsvFileScanner(const std::string& metadataFileName,
-        const std::string& dataFileName, const Expression& filterExpr = kAlwaysTrue);
+        const std::string& dataFileName, const Expression& filterExpr = kAlwaysTrue,
+        const CsvScanOptions& options = {});
 
     /**
      * @brief Constructor where arguments must specify values of filterExpr and projections.
@@ -111,10 +167,11 @@ private:
      * @param dataFileName: name of the CSV file.
      * @param filterExpr: Expression to filter desired lines.
      * @param projections: projections to select desired columns or output in a line.
+     * @param options: options of scanning.
      */
     CsvFileScanner(const std::string& metadataFileName,
         const std::string& dataFileName, const Expression& filterExpr, 
-        const std::vector<Expression>& projections);
+        const std::vector<Expression>& projections, const CsvScanOptions& options = {});
 
     /**
      * @brief Helper function for constructors. it opens file stream to csv file and its metadata file.
@@ -124,9 +181,31 @@ private:
      */
     void constructorHelper(const std::string& metadataFileName, const std::string& dataFileName);
 
+    // Compiles projections_ and finds the columns that filterExpr_ and projections_ refer to.
+    void compileProjections();
+
+    // Filters lines also by expr, which refers to columns of metadata_ like filterExpr_.
+    void addFilter(const Expression& expr);
+
     // helper function for processNext to check if there are too many error lines.
     void checkError();
 
+    /**
+     * @brief Reads the next line and splits it into fields_.
+     * 
+     * @return true if a line is read. false if there's no more line to read.
+     */
+    bool readNextFields();
+
+    /**
+     * @brief Reads lines until a valid line that passes the filter test is found.
+     * 
+     * @param r: receives converted fields of the line. Its storage, including that of string
+     *        values, is reused.
+     * @return true if a line is found. false if there's no more line to read.
+     */
+    bool readNextRow(std::vector<std::any>& r);
+
     // threshold to decide if there are too many error lines.
     const unsigned int kThreshold = 30;
 
@@ -135,13 +214,32 @@ private:
     // file stream to open and read CSV file and metadata file.
     mutable std::fstream dfs_;
     // expression based on which this object will filter lines.
-    const Expression filterExpr_;
+    Expression filterExpr_;
     // number of lines read by this object at a moment.
     unsigned int readLines_;
     // number of error lines that were discrepant with metadata_.
     unsigned int errorLines_;
     // projections to get desired columns
     std::vector<Expression> projections_;
+    // filterExpr_ and projections_ compiled against metadata_.
+    CompiledExpression compiledFilter_;
+    std::vector<CompiledExpression> compiledProjections_;
+    // columns that filterExpr_ refers to, and the other columns that projections_ refer to.
+    // the latter are converted only for lines passing the filter, and fields of the other
+    // columns are never converted and left null in rows.
+    std::vector<std::size_t> filterColumns_;
+    std::vector<std::size_t> projectedColumns_;
+    // row of the current line. Its string values are overwritten line after line.
+    std::vector<std::any> row_;
+    const CsvScanOptions options_;
+    // mapping of CSV file when options_.memoryMapped is set.
+    MappedFile mappedFile_;
+    // offset of the next line in mappedFile_.
+    std::size_t pos_;
+    // buffer of the current line when the file is read through dfs_.
+    std::string line_;
+    // fields of the current line. They are views into line_ or mappedFile_.
+    std::vector<std::string_view> fields_;
 };
 
 /**
@@ -7,13 +7,17 @@
 
 #include <algorithm>
 #include <any>
-#include <functional>
+#include <cassert>
+#include <exception>
+#include <string>
 #include <variant>
 #include <vector>
 
 #include "any_visitor.h"
 #include "expression.h"
 #include "metadata.h"
+#include "to_any_converter.h"
+#include "value.h"
 
 namespace codein {
 
@@ -21,16 +25,17 @@ const Expression kAlwaysTrue{.opCode = OpCode::Const, .leafOrChildren = std::any
 
 const Expression kAlwaysFalse{.opCode = OpCode::Const, .leafOrChildren = std::any(false)};
 
-using Evaluator = std::function<std::any (const Expression&, const Metadata&, const std::vector<std::any>&)>;
+// Evaluators are plain function pointers so that no std::function is involved in dispatching.
+using Evaluator = Value (*)(const Expression&, const Metadata&, const std::vector<std::any>&);
 
 const Evaluator evalNoop = [](const Expression&, const Metadata&, const std::vector<std::any>&) {
     assert(!"Nothing to evaluate for Noop");
-    return std::any();
+    return Value();
 };
 
 const Evaluator evalNotSupported = [](const Expression&, const Metadata&, const std::vector<std::any>&) {
     assert(!"Not supported");
-    return std::any();
+    return Value();
 };
 
 const std::vector<Evaluator> evaluators{
@@ -39,135 +44,471 @@ const std::vector<Evaluator> evaluators{
 
     // OpCode::Ref
     [](const Expression& n, const Metadata& metadata, const std::vector<std::any>& data) {
-        try {
-            const auto& name = std::any_cast<std::string>(n.leaf());
-            return data[metadata[name]];
-        }
-        catch (const std::bad_any_cast&) {
+        const auto name = std::any_cast<std::string>(&n.leaf());
+        if (name == nullptr) {
             throw NameExpected();
         }
+
+        return toValue(data[metadata[*name]]);
     },
 
     // OpCode::Const
     [](const Expression& n, const Metadata& metadata, const std::vector<std::any>& data) {
-        return n.leaf();
+        return toValue(n.leaf());
     },
 
     // OpCode::Eq
     [](const Expression& n, const Metadata& metadata, const std::vector<std::any>& data) {
-        const auto& [lhs, rhs] = n.firstAndSecond();
-        return std::any{lhs.eval(metadata, data) == rhs.eval(metadata, data)};
+        return Value(n.first().evalValue(metadata, data) == n.second().evalValue(metadata, data));
     },
 
     // OpCode::Neq
     [](const Expression& n, const Metadata& metadata, const std::vector<std::any>& data) {
-        const auto& [lhs, rhs] = n.firstAndSecond();
-        return std::any{lhs.eval(metadata, data) != rhs.eval(metadata, data)};
+        return Value(n.first().evalValue(metadata, data) != n.second().evalValue(metadata, data));
     },
 
     // OpCode::Lt
     [](const Expression& n, const Metadata& metadata, const std::vector<std::any>& data) {
-        const auto& [lhs, rhs] = n.firstAndSecond();
-        return std::any{lhs.eval(metadata, data) < rhs.eval(metadata, data)};
+        return Value(n.first().evalValue(metadata, data) < n.second().evalValue(metadata, data));
     },
 
     // OpCode::Lte
     [](const Expression& n, const Metadata& metadata, const std::vector<std::any>& data) {
-        const auto& [lhs, rhs] = n.firstAndSecond();
-        return std::any{lhs.eval(metadata, data) <= rhs.eval(metadata, data)};
+        return Value(n.first().evalValue(metadata, data) <= n.second().evalValue(metadata, data));
     },
 
     // OpCode::Gt
     [](const Expression& n, const Metadata& metadata, const std::vector<std::any>& data) {
-        const auto& [lhs, rhs] = n.firstAndSecond();
-        return std::any{lhs.eval(metadata, data) > rhs.eval(metadata, data)};
+        return Value(n.first().evalValue(metadata, data) > n.second().evalValue(metadata, data));
     },
 
     // OpCode::Gte
     [](const Expression& n, const Metadata& metadata, const std::vector<std::any>& data) {
-        const auto& [lhs, rhs] = n.firstAndSecond();
-        return std::any{lhs.eval(metadata, data) >= rhs.eval(metadata, data)};
+        return Value(n.first().evalValue(metadata, data) >= n.second().evalValue(metadata, data));
     },
 
     // OpCode::Add
     [](const Expression& n, const Metadata& metadata, const std::vector<std::any>& data) {
-        const auto& [lhs, rhs] = n.firstAndSecond();
-        return std::any{lhs.eval(metadata, data) + rhs.eval(metadata, data)};
+        return n.first().evalValue(metadata, data) + n.second().evalValue(metadata, data);
     },
 
     // OpCode::Sub
     [](const Expression& n, const Metadata& metadata, const std::vector<std::any>& data) {
-        const auto& [lhs, rhs] = n.firstAndSecond();
-        return std::any{lhs.eval(metadata, data) - rhs.eval(metadata, data)};
+        return n.first().evalValue(metadata, data) - n.second().evalValue(metadata, data);
     },
 
     // OpCode::Mult
     [](const Expression& n, const Metadata& metadata, const std::vector<std::any>& data) {
-        const auto& [lhs, rhs] = n.firstAndSecond();
-        return std::any{lhs.eval(metadata, data) * rhs.eval(metadata, data)};
+        return n.first().evalValue(metadata, data) * n.second().evalValue(metadata, data);
     },
 
     // OpCode::Div
     [](const Expression& n, const Metadata& metadata, const std::vector<std::any>& data) {
-        const auto& [lhs, rhs] = n.firstAndSecond();
-        return std::any{lhs.eval(metadata, data) / rhs.eval(metadata, data)};
+        return n.first().evalValue(metadata, data) / n.second().evalValue(metadata, data);
     },
 
     // OpCode::Mod
     [](const Expression& n, const Metadata& metadata, const std::vector<std::any>& data) {
-        const auto& [lhs, rhs] = n.firstAndSecond();
-        return std::any{lhs.eval(metadata, data) % rhs.eval(metadata, data)};
+        return n.first().evalValue(metadata, data) % n.second().evalValue(metadata, data);
     },
 
     // OpCode::Not
     [](const Expression& n, const Metadata& metadata, const std::vector<std::any>& data) {
-        auto lhs = n.first();
-        return std::any{notAny(lhs.eval(metadata, data))};
+        return Value(notValue(n.first().evalValue(metadata, data)));
     },
 
     // OpCode::And
     [](const Expression& n, const Metadata& metadata, const std::vector<std::any>& data) {
-        auto [lhs, rhs] = n.firstAndSecond();
         // Implements short-circuit.
-        if (auto r = lhs.eval(metadata, data); std::any_cast<bool>(r)) {
-            return rhs.eval(metadata, data);
+        if (asBool(n.first().evalValue(metadata, data))) {
+            return n.second().evalValue(metadata, data);
         }
         else {
-            return std::any(false);
+            return Value(false);
         }
     },
 
     // OpCode::Or
     [](const Expression& n, const Metadata& metadata, const std::vector<std::any>& data) {
-        auto [lhs, rhs] = n.firstAndSecond();
         // Implements short-circuit.
-        if (auto r = lhs.eval(metadata, data); std::any_cast<bool>(r)) {
-            return std::any(true);
+        if (asBool(n.first().evalValue(metadata, data))) {
+            return Value(true);
         }
         else {
-            return rhs.eval(metadata, data);
+            return n.second().evalValue(metadata, data);
         }
     },
 
     // OpCode::Cond
     [](const Expression& n, const Metadata& metadata, const std::vector<std::any>& data) {
-        if (auto cond = n.first(); std::any_cast<bool>(cond(metadata, data))) {
-            return n.children()[1](metadata, data);
+        if (asBool(n.first().evalValue(metadata, data))) {
+            return n.children()[1].evalValue(metadata, data);
         }
         else {
-            return n.children()[2](metadata, data);
+            return n.children()[2].evalValue(metadata, data);
         }
     },
 
     // OpCode::Conv
     [](const Expression& n, const Metadata& metadata, const std::vector<std::any>& data) {
-        auto typeName = std::any_cast<std::string>(n.children()[1](metadata, data));
-        return convertAny(n.children()[0](metadata, data), typeName);
+        auto typeName = n.children()[1].evalValue(metadata, data);
+        if (!typeName.holds<std::string>()) {
+            throw UnsupportedOperation();
+        }
+
+        return convertValue(n.children()[0].evalValue(metadata, data), convertToTypeid(typeName.get<std::string>()));
     }
 };
 
 std::any Expression::eval(const Metadata& metadata, const std::vector<std::any>& data) const {
+    return toAny(evalValue(metadata, data));
+}
+
+Value Expression::evalValue(const Metadata& metadata, const std::vector<std::any>& data) const {
     return evaluators[static_cast<size_t>(opCode)](*this, metadata, data);
 }
 
+/**
+ * @brief Compiles an expression tree into the postfix program of a CompiledExpression.
+ */
+class ExpressionCompiler {
+public:
+    using Instr = CompiledExpression::Instr;
+
+    static_assert(static_cast<int>(Instr::Mod) - static_cast<int>(Instr::Eq)
+        == static_cast<int>(OpCode::Mod) - static_cast<int>(OpCode::Eq));
+
+    explicit ExpressionCompiler(const Metadata& metadata)
+        : metadata_(metadata)
+        , compiled_()
+        , depth_(0)
+        , maxDepth_(0)
+    {}
+
+    CompiledExpression run(const Expression& expr) &&
+    {
+        compile(expr);
+        compiled_.stack_.resize(maxDepth_);
+
+        return std::move(compiled_);
+    }
+
+private:
+    void compile(const Expression& n)
+    {
+        switch (n.opCode) {
+        case OpCode::Noop:
+            emit(Instr::Noop, 0, 1);
+            break;
+
+        case OpCode::Ref:
+        case OpCode::Const:
+            compileLeaf(n);
+            break;
+
+        case OpCode::Eq:
+        case OpCode::Neq:
+        case OpCode::Lt:
+        case OpCode::Lte:
+        case OpCode::Gt:
+        case OpCode::Gte:
+        case OpCode::Add:
+        case OpCode::Sub:
+        case OpCode::Mult:
+        case OpCode::Div:
+        case OpCode::Mod:
+            compile(n.first());
+            compile(n.second());
+            // Binary instructions are in the same order as their opcodes.
+            emit(static_cast<Instr>(
+                static_cast<int>(Instr::Eq) + static_cast<int>(n.opCode) - static_cast<int>(OpCode::Eq)), 0, -1);
+            break;
+
+        case OpCode::Not:
+            compile(n.first());
+            emit(Instr::Not, 0, 0);
+            break;
+
+        case OpCode::And:
+        case OpCode::Or: {
+            compile(n.first());
+            auto jump = emit(n.opCode == OpCode::And ? Instr::AndJump : Instr::OrJump, 0, -1);
+            compile(n.second());
+            patch(jump);
+            break;
+        }
+
+        case OpCode::Cond: {
+            compile(n.first());
+            auto jumpToElse = emit(Instr::JumpIfFalse, 0, -1);
+            compile(n.children()[1]);
+            auto jumpToEnd = emit(Instr::Jump, 0, -1);
+            patch(jumpToElse);
+            compile(n.children()[2]);
+            patch(jumpToEnd);
+            break;
+        }
+
+        case OpCode::Conv: {
+            const auto& typeExpr = n.children()[1];
+            const std::string* typeName = nullptr;
+            if (typeExpr.opCode == OpCode::Const && std::holds_alternative<std::any>(typeExpr.leafOrChildren)) {
+                typeName = std::any_cast<std::string>(&typeExpr.leaf());
+            }
+
+            if (typeName != nullptr) {
+                // Resolves the type name at compile time if it is a constant.
+                compile(n.children()[0]);
+                compiled_.types_.emplace_back(convertToTypeid(*typeName));
+                emit(Instr::ConvTo, compiled_.types_.size() - 1, 0);
+            }
+            else {
+                compile(typeExpr);
+                compile(n.children()[0]);
+                emit(Instr::Conv, 0, -1);
+            }
+            break;
+        }
+
+        default:
+            assert(!"Not supported");
+            emit(Instr::Noop, 0, 1);
+            break;
+        }
+    }
+
+    void compileLeaf(const Expression& n)
+    {
+        try {
+            if (n.opCode == OpCode::Ref) {
+                const auto name = std::any_cast<std::string>(&n.leaf());
+                if (name == nullptr) {
+                    throw NameExpected();
+                }
+                emit(Instr::Ref, metadata_[*name], 1);
+            }
+            else {
+                compiled_.constants_.emplace_back(toValue(n.leaf()));
+                emit(Instr::Const, compiled_.constants_.size() - 1, 1);
+            }
+        }
+        catch (...) {
+            compiled_.errors_.emplace_back(std::current_exception());
+            emit(Instr::Fail, compiled_.errors_.size() - 1, 1);
+        }
+    }
+
+    // Appends an instruction that changes the stack depth by delta and returns its position.
+    std::size_t emit(Instr instr, std::size_t arg, int delta)
+    {
+        compiled_.program_.push_back({instr, static_cast<std::uint32_t>(arg)});
+        depth_ += delta;
+        maxDepth_ = std::max(maxDepth_, depth_);
+
+        return compiled_.program_.size() - 1;
+    }
+
+    // Makes the jump at pos jump to the next instruction.
+    void patch(std::size_t pos)
+    {
+        compiled_.program_[pos].arg = static_cast<std::uint32_t>(compiled_.program_.size());
+    }
+
+    const Metadata& metadata_;
+    CompiledExpression compiled_;
+    int depth_;
+    int maxDepth_;
+};
+
+CompiledExpression Expression::compile(const Metadata& metadata) const
+{
+    return ExpressionCompiler(metadata).run(*this);
+}
+
+std::vector<CompiledExpression> compile(const std::vector<Expression>& exprs, const Metadata& metadata)
+{
+    std::vector<CompiledExpression> compiled;
+    compiled.reserve(exprs.size());
+    for (const auto& expr: exprs) {
+        compiled.emplace_back(expr.compile(metadata));
+    }
+
+    return compiled;
+}
+
+void appendReferencedColumns(const Expression& expr, const Metadata& metadata, std::vector<std::size_t>& cols)
+{
+    if (std::holds_alternative<std::vector<Expression>>(expr.leafOrChildren)) {
+        for (const auto& child: expr.children()) {
+            appendReferencedColumns(child, metadata, cols);
+        }
+        return;
+    }
+
+    const auto name = std::any_cast<std::string>(&expr.leaf());
+    if (expr.opCode != OpCode::Ref || name == nullptr) {
+        return;
+    }
+
+    const auto [found, col] = metadata.find(*name);
+    if (found && std::find(cols.begin(), cols.end(), col) == cols.end()) {
+        cols.push_back(col);
+    }
+}
+
+Expression conjunction(const Expression& lhs, const Expression& rhs)
+{
+    if (lhs.opCode == OpCode::Const && std::holds_alternative<std::any>(lhs.leafOrChildren)) {
+        if (const auto b = std::any_cast<bool>(&lhs.leaf()); b != nullptr && *b) {
+            return rhs;
+        }
+    }
+
+    return Expression{.opCode = OpCode::And, .leafOrChildren = std::vector<Expression>{lhs, rhs}};
+}
+
+Value CompiledExpression::evalValue(const std::vector<std::any>& data) const
+{
+    if (program_.empty()) {
+        return Value();
+    }
+
+    Value* const stack = stack_.data();
+    std::size_t sp = 0;
+
+    const std::size_t size = program_.size();
+    for (std::size_t pc = 0; pc < size;) {
+        const auto [instr, arg] = program_[pc++];
+        switch (instr) {
+        case Instr::Noop:
+            assert(!"Nothing to evaluate for Noop");
+            stack[sp++] = Value();
+            break;
+
+        case Instr::Fail:
+            std::rethrow_exception(errors_[arg]);
+
+        case Instr::Ref:
+            // A string is copied into the string left on the stack to reuse its storage.
+            if (const auto str = std::any_cast<std::string>(&data[arg]);
+                str != nullptr && stack[sp].holds<std::string>()) {
+                stack[sp++].get<std::string>() = *str;
+            }
+            else {
+                stack[sp++] = toValue(data[arg]);
+            }
+            break;
+
+        case Instr::Const:
+            stack[sp++] = constants_[arg];
+            break;
+
+        case Instr::Eq:
+            --sp;
+            stack[sp - 1] = Value(stack[sp - 1] == stack[sp]);
+            break;
+
+        case Instr::Neq:
+            --sp;
+            stack[sp - 1] = Value(stack[sp - 1] != stack[sp]);
+            break;
+
+        case Instr::Lt:
+            --sp;
+            stack[sp - 1] = Value(stack[sp - 1] < stack[sp]);
+            break;
+
+        case Instr::Lte:
+            --sp;
+            stack[sp - 1] = Value(stack[sp - 1] <= stack[sp]);
+            break;
+
+        case Instr::Gt:
+            --sp;
+            stack[sp - 1] = Value(stack[sp - 1] > stack[sp]);
+            break;
+
+        case Instr::Gte:
+            --sp;
+            stack[sp - 1] = Value(stack[sp - 1] >= stack[sp]);
+            break;
+
+        case Instr::Add:
+            --sp;
+            stack[sp - 1] = stack[sp - 1] + stack[sp];
+            break;
+
+        case Instr::Sub:
+            --sp;
+            stack[sp - 1] = stack[sp - 1] - stack[sp];
+            break;
+
+        case Instr::Mult:
+            --sp;
+            stack[sp - 1] = stack[sp - 1] * stack[sp];
+            break;
+
+        case Instr::Div:
+            --sp;
+            stack[sp - 1] = stack[sp - 1] / stack[sp];
+            break;
+
+        case Instr::Mod:
+            --sp;
+            stack[sp - 1] = stack[sp - 1] % stack[sp];
+            break;
+
+        case Instr::Not:
+            stack[sp - 1] = Value(notValue(stack[sp - 1]));
+            break;
+
+        case Instr::AndJump:
+            if (!asBool(stack[sp - 1])) {
+                stack[sp - 1] = Value(false);
+                pc = arg;
+            }
+            else {
+                --sp;
+            }
+            break;
+
+        case Instr::OrJump:
+            if (asBool(stack[sp - 1])) {
+                stack[sp - 1] = Value(true);
+                pc = arg;
+            }
+            else {
+                --sp;
+            }
+            break;
+
+        case Instr::JumpIfFalse:
+            if (!asBool(stack[--sp])) {
+                pc = arg;
+            }
+            break;
+
+        case Instr::Jump:
+            pc = arg;
+            break;
+
+        case Instr::ConvTo:
+            stack[sp - 1] = convertValue(stack[sp - 1], types_[arg]);
+            break;
+
+        case Instr::Conv:
+            --sp;
+            if (!stack[sp - 1].holds<std::string>()) {
+                throw UnsupportedOperation();
+            }
+            stack[sp - 1] = convertValue(stack[sp], convertToTypeid(stack[sp - 1].get<std::string>()));
+            break;
+        }
+    }
+
+    assert(sp == 1);
+
+    return std::move(stack[0]);
+}
+
 }
@@ -6,12 +6,17 @@
  */
 
 #include <any>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
 #include <string>
 #include <tuple>
+#include <typeindex>
 #include <variant>
 #include <vector>
 
 #include "metadata.h"
+#include "value.h"
 
 #pragma once
 
@@ -45,6 +50,8 @@ enum class OpCode {
     Conv,
 };
 
+class CompiledExpression;
+
 struct Expression {
     const std::any& leaf() const {
         const auto& leaf = std::get<0>(leafOrChildren);
@@ -101,15 +108,115 @@ struct Expression {
     }
 
     std::any eval(const Metadata& metadata, const std::vector<std::any>& data) const;
+
+    /**
+     * @brief Evaluates the expression into a Value. Intermediate results of the evaluation are
+     * kept in Value rather than std::any.
+     */
+    Value evalValue(const Metadata& metadata, const std::vector<std::any>& data) const;
+
     std::any operator()(const Metadata& metadata, const std::vector<std::any>& data) const
     {
         return eval(metadata, data);
     }
 
+    /**
+     * @brief Compiles the expression for rows described by metadata.
+     * 
+     * Compiling never throws. Errors such as unknown names are thrown when the erroneous part
+     * of the compiled expression is evaluated, just like eval() does.
+     */
+    CompiledExpression compile(const Metadata& metadata) const;
+
     OpCode opCode;
     std::variant<std::any, std::vector<Expression>> leafOrChildren;
 };
 
+/**
+ * @brief Expression compiled into a flat program for rows of fixed metadata.
+ * 
+ * Names are resolved into column indexes and constants are converted into Values at compile
+ * time. The program is run over a stack of Values preallocated at compile time, so evaluation
+ * neither recurses nor allocates memory other than for string values.
+ * Since the stack is reused across evaluations, a CompiledExpression must not be evaluated on
+ * multiple threads at once. Each thread should evaluate its own copy.
+ */
+class CompiledExpression {
+public:
+    CompiledExpression() = default;
+
+    Value evalValue(const std::vector<std::any>& data) const;
+
+    std::any eval(const std::vector<std::any>& data) const
+    {
+        return toAny(evalValue(data));
+    }
+
+    std::any operator()(const std::vector<std::any>& data) const
+    {
+        return eval(data);
+    }
+
+private:
+    friend class ExpressionCompiler;
+
+    enum class Instr : std::uint8_t {
+        Noop,
+        // Rethrows errors_[arg].
+        Fail,
+        // Pushes data[arg].
+        Ref,
+        // Pushes constants_[arg].
+        Const,
+        Eq,
+        Neq,
+        Lt,
+        Lte,
+        Gt,
+        Gte,
+        Add,
+        Sub,
+        Mult,
+        Div,
+        Mod,
+        Not,
+        // Replaces the top with false and jumps to arg if the top is false. Otherwise, pops it.
+        AndJump,
+        // Replaces the top with true and jumps to arg if the top is true. Otherwise, pops it.
+        OrJump,
+        // Pops the top and jumps to arg if it is false.
+        JumpIfFalse,
+        Jump,
+        // Converts the top into types_[arg].
+        ConvTo,
+        // Converts the top into the type named by the second from the top.
+        Conv,
+    };
+
+    struct Instruction {
+        Instr instr;
+        std::uint32_t arg;
+    };
+
+    std::vector<Instruction> program_;
+    std::vector<Value> constants_;
+    std::vector<std::type_index> types_;
+    std::vector<std::exception_ptr> errors_;
+    mutable std::vector<Value> stack_;
+};
+
+/// Compiles each of exprs for rows described by metadata.
+std::vector<CompiledExpression> compile(const std::vector<Expression>& exprs, const Metadata& metadata);
+
+/**
+ * @brief Appends the indexes of the columns of metadata that expr refers to, unless cols
+ * already has them. Names not in metadata are ignored.
+ */
+void appendReferencedColumns(const Expression& expr, const Metadata& metadata, std::vector<std::size_t>& cols);
+
+/// Returns lhs And rhs, or rhs if lhs is the constant true.
+Expression conjunction(const Expression& lhs, const Expression& rhs);
+
 extern const Expression kAlwaysTrue;
 
 extern const Expression kAlwaysFalse;
@@ -6,10 +6,12 @@
  */
 
 #include <any>
+#include <cstdint>
 #include <memory>
 #include <optional>
 
 #include "filter.h"
+#include "value.h"
 
 namespace codein {
 
@@ -23,7 +25,7 @@ std::optional<std::vector<std::any>> Filter::processNext()
             break;
         }
 
-        if (auto r = expr_.eval(metadata_, data.value()); std::any_cast<bool>(r)) {
+        if (asBool(compiledExpr_.evalValue(data.value()))) {
             return data;
         }
     }
@@ -31,4 +33,44 @@ std::optional<std::vector<std::any>> Filter::processNext()
     return std::nullopt;
 }
 
+std::optional<Batch> Filter::processNextBatch(std::size_t maxRows)
+{
+    std::vector<std::any> row;
+    std::vector<std::uint8_t> mask;
+    SelectionVector sel;
+
+    while (child_->hasNext()) {
+        auto batch = child_->processNextBatch(maxRows);
+        if (!batch.has_value()) {
+            break;
+        }
+
+        // Rows are materialized only if the kernel doesn't apply to the batch.
+        if (kernel_ && kernel_->eval(*batch, mask)) {
+            toSelectionVector(mask, sel);
+        }
+        else {
+            sel.clear();
+            for (std::size_t i = 0; i < batch->numRows(); ++i) {
+                batch->readRow(i, row);
+                if (asBool(compiledExpr_.evalValue(row))) {
+                    sel.push_back(i);
+                }
+            }
+        }
+
+        if (sel.empty()) {
+            continue;
+        }
+
+        if (sel.size() != batch->numRows()) {
+            batch->select(sel);
+        }
+
+        return batch;
+    }
+
+    return std::nullopt;
+}
+
 }
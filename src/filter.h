@@ -12,6 +12,7 @@
 
 #include "expression.h"
 #include "iterator.h"
+#include "typed_kernel.h"
 
 #pragma once
 
@@ -23,6 +24,7 @@ class Filter : public Iterator {
 public:
     template <typename T, typename... ArgTs>
     friend std::unique_ptr<Iterator> makeIterator(ArgTs&&...);
+    friend class PredicatePushdown;
 
     void open() override
     {
@@ -41,6 +43,8 @@ public:
 
     std::optional<std::vector<std::any>> processNext() override;
 
+    std::optional<Batch> processNextBatch(std::size_t maxRows = kDefaultBatchSize) override;
+
     void close() override
     {
         child_->close();
@@ -59,6 +63,8 @@ private:
         : child_()
         , expr_(expr)
         , metadata_()
+        , compiledExpr_()
+        , kernel_()
     {
         if (expr_.opCode == OpCode::Noop) {
             throw InvalidFilter();
@@ -66,11 +72,16 @@ private:
 
         metadata_ = child->getMetadata();
         child_ = std::move(child);
+        compiledExpr_ = expr_.compile(metadata_);
+        kernel_ = makePredicateKernel(expr_, metadata_);
     }
 
     std::unique_ptr<Iterator> child_;
     const Expression expr_;
     Metadata metadata_;
+    CompiledExpression compiledExpr_;
+    // Kernel evaluating expr_ over whole batches. nullptr if expr_ has no kernel.
+    std::unique_ptr<PredicateKernel> kernel_;
 };
 
 }
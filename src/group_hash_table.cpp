@@ -0,0 +1,380 @@
+/**
+ * Copyright (C) 2021-present Codein Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify it under the terms of
+ * BSD-3-Clause License which can be found at the root directory of this repository.
+ */
+
+#include <algorithm>
+#include <any>
+#include <bit>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <limits>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "any_visitor.h"
+#include "group_hash_table.h"
+#include "to_any_converter.h"
+
+namespace codein {
+
+namespace {
+
+constexpr std::size_t kInitialSlots = 1024;
+
+constexpr std::uint64_t kMultiplier = 0x9e3779b97f4a7c15ull;
+
+// Combines w into h. Unlike XOR, the result depends on the order of the combined words.
+inline std::uint64_t hashCombine(std::uint64_t h, std::uint64_t w)
+{
+    h = (h + w) * kMultiplier;
+    return h ^ (h >> 32);
+}
+
+// Final mix of murmur3, spreading entropy into both the lower bits used as a slot index and
+// the upper bits used as a tag.
+inline std::uint64_t finalizeHash(std::uint64_t h)
+{
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdull;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ull;
+    h ^= h >> 33;
+
+    return h;
+}
+
+std::size_t numMaskWords(std::size_t numKeys)
+{
+    return (numKeys + 63) / 64;
+}
+
+// Bits of a floating point key. -0.0 and 0.0 are the same group, and so are all NaNs.
+std::uint32_t keyBits(float v)
+{
+    return std::bit_cast<std::uint32_t>(v == 0.0f ? 0.0f : v != v ? std::numeric_limits<float>::quiet_NaN() : v);
+}
+
+std::uint64_t keyBits(double v)
+{
+    return std::bit_cast<std::uint64_t>(v == 0.0 ? 0.0 : v != v ? std::numeric_limits<double>::quiet_NaN() : v);
+}
+
+}
+
+GroupHashTable::GroupHashTable(const Metadata& keyMetadata, std::size_t numValues)
+    : kinds_()
+    , numValues_(numValues)
+    , keyWidth_(keyMetadata.size() + numMaskWords(keyMetadata.size()))
+    , numStrings_(0)
+    , slots_(kInitialSlots, Slot{0, kEmptySlot})
+    , keys_()
+    , strings_()
+    , stringBytes_(0)
+    , hashes_()
+    , values_()
+    , key_(keyWidth_)
+    , keyStrings_()
+{
+    for (std::size_t i = 0; i < keyMetadata.size(); ++i) {
+        const auto& ti = keyMetadata[i].typeIndex;
+        if (ti == tiBool) {
+            kinds_.push_back(KeyKind::Bool);
+        }
+        else if (ti == tiInt) {
+            kinds_.push_back(KeyKind::Int);
+        }
+        else if (ti == tiUint) {
+            kinds_.push_back(KeyKind::Uint);
+        }
+        else if (ti == tiFloat) {
+            kinds_.push_back(KeyKind::Float);
+        }
+        else if (ti == tiDouble) {
+            kinds_.push_back(KeyKind::Double);
+        }
+        else if (ti == tiString) {
+            kinds_.push_back(KeyKind::String);
+            ++numStrings_;
+        }
+        else {
+            kinds_.push_back(KeyKind::Unsupported);
+        }
+    }
+}
+
+std::uint64_t GroupHashTable::packKey(const std::vector<std::any>& keyVals)
+{
+    const std::size_t numKeys = kinds_.size();
+    std::fill(key_.begin() + numKeys, key_.end(), 0);
+    keyStrings_.clear();
+
+    for (std::size_t i = 0; i < numKeys; ++i) {
+        const auto& keyVal = keyVals[i];
+        std::uint64_t& word = key_[i];
+        if (!keyVal.has_value()) {
+            word = 0;
+            key_[numKeys + i / 64] |= std::uint64_t(1) << (i % 64);
+            if (kinds_[i] == KeyKind::String) {
+                keyStrings_.emplace_back();
+            }
+            continue;
+        }
+
+        switch (kinds_[i]) {
+        case KeyKind::Bool:
+            if (const auto p = std::any_cast<bool>(&keyVal); p != nullptr) {
+                word = *p;
+                continue;
+            }
+            break;
+
+        case KeyKind::Int:
+            if (const auto p = std::any_cast<int>(&keyVal); p != nullptr) {
+                word = static_cast<std::uint64_t>(static_cast<std::int64_t>(*p));
+                continue;
+            }
+            break;
+
+        case KeyKind::Uint:
+            if (const auto p = std::any_cast<unsigned int>(&keyVal); p != nullptr) {
+                word = *p;
+                continue;
+            }
+            break;
+
+        case KeyKind::Float:
+            if (const auto p = std::any_cast<float>(&keyVal); p != nullptr) {
+                word = keyBits(*p);
+                continue;
+            }
+            break;
+
+        case KeyKind::Double:
+            if (const auto p = std::any_cast<double>(&keyVal); p != nullptr) {
+                word = keyBits(*p);
+                continue;
+            }
+            break;
+
+        case KeyKind::String:
+            if (const auto p = std::any_cast<std::string>(&keyVal); p != nullptr) {
+                word = std::hash<std::string_view>()(*p);
+                keyStrings_.emplace_back(*p);
+                continue;
+            }
+            break;
+
+        case KeyKind::Unsupported:
+            break;
+        }
+
+        throw UnsupportedOperation();
+    }
+
+    std::uint64_t h = 0;
+    for (auto word: key_) {
+        h = hashCombine(h, word);
+    }
+
+    return finalizeHash(h);
+}
+
+bool GroupHashTable::sameKey(const std::vector<std::any>& lhs, const std::vector<std::any>& rhs)
+{
+    for (std::size_t i = 0; i < lhs.size(); ++i) {
+        if (lhs[i].has_value() != rhs[i].has_value()) {
+            return false;
+        }
+        if (!lhs[i].has_value()) {
+            continue;
+        }
+
+        const auto lf = std::any_cast<float>(&lhs[i]);
+        const auto rf = std::any_cast<float>(&rhs[i]);
+        if (lf != nullptr && rf != nullptr) {
+            if (keyBits(*lf) != keyBits(*rf)) {
+                return false;
+            }
+            continue;
+        }
+
+        const auto ld = std::any_cast<double>(&lhs[i]);
+        const auto rd = std::any_cast<double>(&rhs[i]);
+        if (ld != nullptr && rd != nullptr) {
+            if (keyBits(*ld) != keyBits(*rd)) {
+                return false;
+            }
+            continue;
+        }
+
+        if (lhs[i] != rhs[i]) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool GroupHashTable::keyEquals(std::size_t group) const
+{
+    if (std::memcmp(keys_.data() + group * keyWidth_, key_.data(), keyWidth_ * sizeof(std::uint64_t)) != 0) {
+        return false;
+    }
+
+    for (std::size_t i = 0; i < numStrings_; ++i) {
+        if (strings_[group * numStrings_ + i] != keyStrings_[i]) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+std::size_t GroupHashTable::probe(std::uint64_t hash) const
+{
+    const std::uint32_t tag = hash >> 32;
+    const std::size_t mask = slots_.size() - 1;
+
+    for (std::size_t idx = hash & mask;; idx = (idx + 1) & mask) {
+        const auto& slot = slots_[idx];
+        if (slot.group == kEmptySlot || (slot.tag == tag && keyEquals(slot.group))) {
+            return idx;
+        }
+    }
+}
+
+std::pair<std::size_t, bool> GroupHashTable::findOrInsert(const std::vector<std::any>& keyVals)
+{
+    const std::uint64_t h = packKey(keyVals);
+
+    std::size_t idx = probe(h);
+    if (slots_[idx].group != kEmptySlot) {
+        return {slots_[idx].group, false};
+    }
+
+    // Keeps the load factor at most 1/2 so that probe sequences stay short.
+    const std::size_t group = hashes_.size();
+    if ((group + 1) * 2 > slots_.size()) {
+        grow();
+        const std::size_t mask = slots_.size() - 1;
+        for (idx = h & mask; slots_[idx].group != kEmptySlot; idx = (idx + 1) & mask) {}
+    }
+
+    slots_[idx] = Slot{static_cast<std::uint32_t>(h >> 32), static_cast<std::uint32_t>(group)};
+    keys_.insert(keys_.end(), key_.begin(), key_.end());
+    for (auto keyString: keyStrings_) {
+        strings_.emplace_back(keyString);
+        stringBytes_ += keyString.size();
+    }
+    hashes_.push_back(h);
+    values_.resize(values_.size() + numValues_);
+
+    return {group, true};
+}
+
+std::optional<std::size_t> GroupHashTable::find(const std::vector<std::any>& keyVals, std::uint64_t* hash)
+{
+    const std::uint64_t h = packKey(keyVals);
+    if (hash != nullptr) {
+        *hash = h;
+    }
+
+    const auto group = slots_[probe(h)].group;
+    if (group == kEmptySlot) {
+        return std::nullopt;
+    }
+
+    return group;
+}
+
+void GroupHashTable::grow()
+{
+    std::vector<Slot> slots(slots_.size() * 2, Slot{0, kEmptySlot});
+    const std::size_t mask = slots.size() - 1;
+
+    for (std::size_t group = 0; group < hashes_.size(); ++group) {
+        const std::uint64_t h = hashes_[group];
+        std::size_t idx = h & mask;
+        while (slots[idx].group != kEmptySlot) {
+            idx = (idx + 1) & mask;
+        }
+        slots[idx] = Slot{static_cast<std::uint32_t>(h >> 32), static_cast<std::uint32_t>(group)};
+    }
+
+    slots_ = std::move(slots);
+}
+
+void GroupHashTable::appendKey(std::size_t group, std::vector<std::any>& out) const
+{
+    const std::size_t numKeys = kinds_.size();
+    const std::uint64_t* key = keys_.data() + group * keyWidth_;
+    const std::string* strings = strings_.data() + group * numStrings_;
+
+    for (std::size_t i = 0; i < numKeys; ++i) {
+        const bool isNull = (key[numKeys + i / 64] >> (i % 64)) & 1;
+        if (isNull) {
+            out.emplace_back();
+            strings += kinds_[i] == KeyKind::String;
+            continue;
+        }
+
+        const std::uint64_t word = key[i];
+        switch (kinds_[i]) {
+        case KeyKind::Bool:
+            out.emplace_back(word != 0);
+            break;
+
+        case KeyKind::Int:
+            out.emplace_back(static_cast<int>(static_cast<std::int64_t>(word)));
+            break;
+
+        case KeyKind::Uint:
+            out.emplace_back(static_cast<unsigned int>(word));
+            break;
+
+        case KeyKind::Float:
+            out.emplace_back(std::bit_cast<float>(static_cast<std::uint32_t>(word)));
+            break;
+
+        case KeyKind::Double:
+            out.emplace_back(std::bit_cast<double>(word));
+            break;
+
+        case KeyKind::String:
+            out.emplace_back(*strings++);
+            break;
+
+        case KeyKind::Unsupported:
+            // Only null keys are accepted for unsupported types.
+            out.emplace_back();
+            break;
+        }
+    }
+}
+
+void GroupHashTable::clear()
+{
+    std::vector<Slot>(kInitialSlots, Slot{0, kEmptySlot}).swap(slots_);
+    std::vector<std::uint64_t>().swap(keys_);
+    std::vector<std::string>().swap(strings_);
+    stringBytes_ = 0;
+    std::vector<std::uint64_t>().swap(hashes_);
+    std::vector<std::any>().swap(values_);
+}
+
+std::size_t GroupHashTable::memoryUsage() const
+{
+    return slots_.capacity() * sizeof(Slot)
+        + keys_.capacity() * sizeof(std::uint64_t)
+        + strings_.capacity() * sizeof(std::string) + stringBytes_
+        + hashes_.capacity() * sizeof(std::uint64_t)
+        + values_.capacity() * sizeof(std::any);
+}
+
+} // namespace codein
@@ -0,0 +1,153 @@
+/**
+ * Copyright (C) 2021-present Codein Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify it under the terms of
+ * BSD-3-Clause License which can be found at the root directory of this repository.
+ */
+
+#include <any>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "metadata.h"
+
+#pragma once
+
+namespace codein {
+
+/**
+ * @brief Open-addressing hash table mapping group keys to aggregation values.
+ *
+ * Each group key is packed into fixed-width 64-bit words, one per key column plus words for
+ * a null mask, and stored contiguously with the keys of the other groups. Strings are kept
+ * aside and represented in the packed key by their hash. Slots hold 32 bits of the hash and
+ * the index of the group, so probing is linear over a flat array and compares packed keys
+ * only when the hash bits match.
+ *
+ * Groups are numbered densely in the order of insertion. Values of a group are stored
+ * contiguously and are empty when the group is inserted.
+ *
+ * Lookups use buffers of the table, so a table must not be looked up on multiple threads at once.
+ */
+class GroupHashTable {
+public:
+    /**
+     * @brief Constructs a new GroupHashTable object.
+     *
+     * @param keyMetadata: metadata of group key columns. Their types decide how keys are packed.
+     * @param numValues: number of aggregation values per group.
+     */
+    GroupHashTable(const Metadata& keyMetadata, std::size_t numValues);
+
+    /**
+     * @brief Finds the group of keyVals, inserting a new group if it does not exist.
+     *
+     * Throws UnsupportedOperation if a key value is neither empty nor of the type of its column.
+     *
+     * @param keyVals: values of group key columns.
+     * @return the index of the group and whether it was inserted.
+     */
+    std::pair<std::size_t, bool> findOrInsert(const std::vector<std::any>& keyVals);
+
+    /**
+     * @brief Finds the group of keyVals without inserting it.
+     *
+     * @param keyVals: values of group key columns.
+     * @param hash: if not null, receives the hash of keyVals.
+     * @return the index of the group, or nullopt if it does not exist.
+     */
+    std::optional<std::size_t> find(const std::vector<std::any>& keyVals, std::uint64_t* hash = nullptr);
+
+    std::size_t size() const
+    {
+        return hashes_.size();
+    }
+
+    /// Returns the first of the numValues values of group.
+    std::any* values(std::size_t group)
+    {
+        return values_.data() + group * numValues_;
+    }
+
+    /// Returns the hash of the key of group.
+    std::uint64_t hash(std::size_t group) const
+    {
+        return hashes_[group];
+    }
+
+    /// Appends the key values of group to out.
+    void appendKey(std::size_t group, std::vector<std::any>& out) const;
+
+    /// Removes all groups and releases memory.
+    void clear();
+
+    /**
+     * @brief Checks if key values of the same key columns belong to the same group. Nulls are
+     * equal to each other, and so are NaNs, while -0.0 equals 0.0.
+     */
+    static bool sameKey(const std::vector<std::any>& lhs, const std::vector<std::any>& rhs);
+
+    /**
+     * @brief Estimates the bytes used by the table. Memory held by values of a type allocating
+     * on the heap, like strings, is not counted.
+     */
+    std::size_t memoryUsage() const;
+
+private:
+    enum class KeyKind : std::uint8_t {
+        Bool,
+        Int,
+        Uint,
+        Float,
+        Double,
+        String,
+        Unsupported,
+    };
+
+    struct Slot {
+        // Upper 32 bits of the hash of the group key.
+        std::uint32_t tag;
+        // Index of the group, or kEmptySlot.
+        std::uint32_t group;
+    };
+
+    static constexpr std::uint32_t kEmptySlot = UINT32_MAX;
+
+    // Packs keyVals into key_ and keyStrings_, and returns its hash.
+    std::uint64_t packKey(const std::vector<std::any>& keyVals);
+
+    // Returns true if the key of group equals the packed key in key_ and keyStrings_.
+    bool keyEquals(std::size_t group) const;
+
+    // Returns the index of the slot of the packed key in key_, or of the empty slot ending its probe.
+    std::size_t probe(std::uint64_t hash) const;
+
+    // Doubles the number of slots and reinserts every group.
+    void grow();
+
+    std::vector<KeyKind> kinds_;
+    std::size_t numValues_;
+    // Number of words of a packed key.
+    std::size_t keyWidth_;
+    // Number of string key columns.
+    std::size_t numStrings_;
+
+    std::vector<Slot> slots_;
+    std::vector<std::uint64_t> keys_;
+    std::vector<std::string> strings_;
+    // Bytes of characters in strings_.
+    std::size_t stringBytes_;
+    std::vector<std::uint64_t> hashes_;
+    std::vector<std::any> values_;
+
+    // Key being looked up.
+    std::vector<std::uint64_t> key_;
+    std::vector<std::string_view> keyStrings_;
+};
+
+} // namespace codein
@@ -5,43 +5,49 @@
  * BSD-3-Clause License which can be found at the root directory of this repository.
  */
 
+#include <algorithm>
 #include <any>
 #include <cassert>
+#include <cstdint>
+#include <exception>
 #include <memory>
-#include <unordered_map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <tuple>
 #include <utility>
 #include <vector>
 
 #include "expression.h"
 #include "hash_aggregator.h"
 #include "iterator.h"
+#include "spill_file.h"
 
 namespace codein {
 
-std::size_t HashAggregator::Hasher::operator()(const std::vector<std::any>& groupKeyVals) const
-{
-    std::size_t h = 0;
-    for (const auto& keyVal: groupKeyVals) {
-        h ^= hashAny(keyVal);
-    }
+namespace {
+
+// Seed of partitions merged on multiple threads. Different from any spill level.
+constexpr std::size_t kMergeSeed = SIZE_MAX - 1;
 
-    return h;
+std::size_t resolveNumThreads(std::size_t numThreads)
+{
+    return numThreads != 0 ? numThreads : std::max<std::size_t>(std::thread::hardware_concurrency(), 1);
 }
 
-bool HashAggregator::KeyEqual::operator()(const std::vector<std::any>& lhs, const std::vector<std::any>& rhs) const
+// Updates the aggregation values of a group with exprs. Values are appended to input, which
+// the expressions are evaluated on.
+void updateGroup(std::any* aggVals, std::vector<std::any>& input, const std::vector<CompiledExpression>& exprs)
 {
-    std::size_t n = lhs.size();
-    if (n != rhs.size()) {
-        return false;
+    for (size_t i = 0; i < exprs.size(); ++i) {
+        input.emplace_back(std::move(aggVals[i]));
     }
 
-    for (std::size_t i = 0; i < n; ++i) {
-        if (lhs[i] != rhs[i]) {
-            return false;
-        }
+    for (size_t i = 0; i < exprs.size(); ++i) {
+        aggVals[i] = exprs[i].eval(input);
     }
+}
 
-    return true;
 }
 
 std::vector<Expression> HashAggregator::createGroupKeyProjExprs(
@@ -59,11 +65,23 @@ std::vector<Expression> HashAggregator::createGroupKeyProjExprs(
     return groupKeyProjs;
 }
 
+Metadata HashAggregator::createGroupKeyMetadata(
+    const Metadata& inputMetadata, const std::vector<std::string>& groupKeyCols)
+{
+    Metadata groupKeyMetadata;
+    for (const auto& col: groupKeyCols) {
+        groupKeyMetadata.emplace_back(inputMetadata[inputMetadata[col]]);
+    }
+
+    return groupKeyMetadata;
+}
+
 HashAggregator::HashAggregator(
     std::unique_ptr<Iterator>&& child,
     const std::vector<std::string>& groupKeyCols,
     const Metadata& groupValMetadata,
-    const std::vector<AggregationExpression>& aggExprs)
+    const std::vector<AggregationExpression>& aggExprs,
+    const HashAggregatorOptions& options)
     : child_(std::move(child))
     , inputMetadata_(child_->getMetadata())
     , groupMetadata_()
@@ -71,7 +89,24 @@ HashAggregator::HashAggregator(
     , groupKeyProjs_(createGroupKeyProjExprs(inputMetadata_, groupKeyCols))
     , aggExprs_(aggExprs)
     , outputProjs_()
-    , hashStorage_(1023)
+    , accumulators_()
+    , stateOffsets_()
+    , numGroupVals_(aggExprs.size())
+    , hashTable_(createGroupKeyMetadata(inputMetadata_, groupKeyCols), aggExprs.size())
+    , nextGroup_(0)
+    , groupKeyVals_()
+    , options_(options)
+    , stateMemoryUsage_(0)
+    , overBudget_(false)
+    , spillLevel_(0)
+    , spillPartitions_()
+    , pendingPartitions_()
+    , mergedPartitions_()
+    , inputBatch_()
+    , inputPos_(0)
+    , hasStreamedGroup_(false)
+    , streamedKey_()
+    , streamedVals_()
 {
     // The intermediate aggregation values are part of input values to aggregation expressions.
     for (size_t i = 0; i < groupValMetadata.size(); ++i) {
@@ -88,6 +123,8 @@ HashAggregator::HashAggregator(
 
     // If outputMetadata is not given, it is metadata for group key columns + group vals
     outputMetadata_ = groupMetadata_;
+
+    compileExpressions();
 }
 
 HashAggregator::HashAggregator(
@@ -96,7 +133,8 @@ HashAggregator::HashAggregator(
     const Metadata& groupValMetadata,
     const Metadata& outputMetadata,
     const std::vector<AggregationExpression>& aggExprs,
-    const std::vector<Expression>& outputProjs)
+    const std::vector<Expression>& outputProjs,
+    const HashAggregatorOptions& options)
     : child_(std::move(child))
     , inputMetadata_(child_->getMetadata())
     , groupMetadata_()
@@ -104,7 +142,24 @@ HashAggregator::HashAggregator(
     , groupKeyProjs_(createGroupKeyProjExprs(inputMetadata_, groupKeyCols))
     , aggExprs_(aggExprs)
     , outputProjs_(outputProjs)
-    , hashStorage_(1023)
+    , accumulators_()
+    , stateOffsets_()
+    , numGroupVals_(aggExprs.size())
+    , hashTable_(createGroupKeyMetadata(inputMetadata_, groupKeyCols), aggExprs.size())
+    , nextGroup_(0)
+    , groupKeyVals_()
+    , options_(options)
+    , stateMemoryUsage_(0)
+    , overBudget_(false)
+    , spillLevel_(0)
+    , spillPartitions_()
+    , pendingPartitions_()
+    , mergedPartitions_()
+    , inputBatch_()
+    , inputPos_(0)
+    , hasStreamedGroup_(false)
+    , streamedKey_()
+    , streamedVals_()
 {
     // The intermediate aggregation values are part of input values to aggregation expressions.
     for (size_t i = 0; i < groupValMetadata.size(); ++i) {
@@ -118,74 +173,494 @@ HashAggregator::HashAggregator(
     for (size_t i = 0; i < groupValMetadata.size(); ++i) {
         groupMetadata_.emplace_back(groupValMetadata[i]);
     }
+
+    compileExpressions();
+}
+
+HashAggregator::HashAggregator(
+    std::unique_ptr<Iterator>&& child,
+    const std::vector<std::string>& groupKeyCols,
+    const std::vector<AggregateSpec>& aggregates,
+    const HashAggregatorOptions& options)
+    : child_(std::move(child))
+    , inputMetadata_(child_->getMetadata())
+    , groupMetadata_(createGroupKeyMetadata(inputMetadata_, groupKeyCols))
+    , outputMetadata_()
+    , groupKeyProjs_(createGroupKeyProjExprs(inputMetadata_, groupKeyCols))
+    , aggExprs_()
+    , outputProjs_()
+    , accumulators_()
+    , stateOffsets_()
+    , numGroupVals_(0)
+    , hashTable_(groupMetadata_, 0)
+    , nextGroup_(0)
+    , groupKeyVals_()
+    , options_(options)
+    , stateMemoryUsage_(0)
+    , overBudget_(false)
+    , spillLevel_(0)
+    , spillPartitions_()
+    , pendingPartitions_()
+    , mergedPartitions_()
+    , inputBatch_()
+    , inputPos_(0)
+    , hasStreamedGroup_(false)
+    , streamedKey_()
+    , streamedVals_()
+{
+    for (const auto& spec: aggregates) {
+        auto accumulator = makeAccumulator(spec, inputMetadata_);
+        groupMetadata_.emplace_back(spec.name, accumulator->outputType());
+        stateOffsets_.push_back(numGroupVals_);
+        numGroupVals_ += accumulator->numStates();
+        accumulators_.emplace_back(std::move(accumulator));
+    }
+
+    hashTable_ = GroupHashTable(createGroupKeyMetadata(inputMetadata_, groupKeyCols), numGroupVals_);
+    outputMetadata_ = groupMetadata_;
+
+    compileExpressions();
 }
 
-std::vector<std::any> mergeValues(std::vector<std::any>&& inputVals, std::vector<std::any>& aggVals)
+void HashAggregator::compileExpressions()
 {
-    auto r = std::move(inputVals);
-    for (auto& aggVal: aggVals) {
-        r.emplace_back(std::move(aggVal));
+    compiledGroupKeyProjs_ = compile(groupKeyProjs_, inputMetadata_);
+
+    for (const auto& aggExpr: aggExprs_) {
+        compiledInitExprs_.emplace_back(aggExpr.initExpr.compile(inputMetadata_));
+        compiledContExprs_.emplace_back(aggExpr.contExpr.compile(inputMetadata_));
     }
 
-    return r;
+    compiledOutputProjs_ = compile(outputProjs_, groupMetadata_);
+
+    if (!options_.clusteredInput && resolveNumThreads(options_.numThreads) > 1) {
+        mergeMetadata_ = groupMetadata_;
+        for (size_t i = groupKeyProjs_.size(); i < groupMetadata_.size(); ++i) {
+            mergeMetadata_.emplace_back(std::string(kPartialPrefix) + groupMetadata_[i].fieldName,
+                groupMetadata_[i].typeIndex);
+        }
+
+        for (const auto& aggExpr: aggExprs_) {
+            if (aggExpr.mergeExpr.opCode == OpCode::Noop) {
+                throw MissingMergeExpression();
+            }
+            compiledMergeExprs_.emplace_back(aggExpr.mergeExpr.compile(mergeMetadata_));
+        }
+    }
 }
 
-void HashAggregator::open()
+void HashAggregator::aggregate(std::vector<std::any>&& input)
 {
-    child_->open();
+    groupKeyVals_.clear();
+    for (const auto& proj : compiledGroupKeyProjs_) {
+        groupKeyVals_.emplace_back(proj.eval(input));
+    }
 
-    while (child_->hasNext()) {
-        auto optInput = child_->processNext();
-        if (!optInput) {
+    // A single probe finds or creates the group.
+    std::size_t group;
+    bool inserted = false;
+    if (!overBudget_) {
+        std::tie(group, inserted) = hashTable_.findOrInsert(groupKeyVals_);
+    }
+    else {
+        std::uint64_t hash;
+        auto found = hashTable_.find(groupKeyVals_, &hash);
+        if (!found) {
+            spill(input, hash);
             return;
         }
+        group = *found;
+    }
 
-        std::vector<std::any> groupKeyVals;
-        groupKeyVals.reserve(groupKeyProjs_.size());
+    const auto groupVals = hashTable_.values(group);
+    const auto& exprs = inserted ? compiledInitExprs_ : compiledContExprs_;
+    if (options_.memoryBudget == 0 || overBudget_) {
+        accumulate(groupVals, input, exprs);
+        return;
+    }
+
+    // States such as sketches allocate memory on the heap as they accumulate rows.
+    const auto prevStateUsage = stateMemoryUsage(groupVals);
+    accumulate(groupVals, input, exprs);
+    const auto stateUsage = stateMemoryUsage(groupVals);
+    if (inserted || stateUsage != prevStateUsage) {
+        stateMemoryUsage_ += stateUsage - prevStateUsage;
+        overBudget_ = hashTable_.memoryUsage() + stateMemoryUsage_ > options_.memoryBudget;
+    }
+}
+
+void HashAggregator::accumulate(
+    std::any* groupVals, std::vector<std::any>& input, const std::vector<CompiledExpression>& exprs) const
+{
+    if (accumulators_.empty()) {
+        // The intermediate aggregation values follow the input values.
+        updateGroup(groupVals, input, exprs);
+        return;
+    }
+
+    for (size_t i = 0; i < accumulators_.size(); ++i) {
+        accumulators_[i]->update(groupVals + stateOffsets_[i], input);
+    }
+}
+
+std::size_t HashAggregator::stateMemoryUsage(const std::any* groupVals) const
+{
+    std::size_t usage = 0;
+    for (size_t i = 0; i < accumulators_.size(); ++i) {
+        usage += accumulators_[i]->stateMemoryUsage(groupVals + stateOffsets_[i]);
+    }
+
+    return usage;
+}
+
+void HashAggregator::mergeGroup(std::any* groupVals, std::any* partialVals, std::vector<std::any>& keyVals,
+    const std::vector<CompiledExpression>& mergeExprs) const
+{
+    if (accumulators_.empty()) {
+        // Group key values are followed by group values and then by the values of the partial aggregation.
+        for (size_t i = 0; i < mergeExprs.size(); ++i) {
+            keyVals.emplace_back(std::move(groupVals[i]));
+        }
+        for (size_t i = 0; i < mergeExprs.size(); ++i) {
+            keyVals.emplace_back(std::move(partialVals[i]));
+        }
+        for (size_t i = 0; i < mergeExprs.size(); ++i) {
+            groupVals[i] = mergeExprs[i].eval(keyVals);
+        }
+        return;
+    }
+
+    for (size_t i = 0; i < accumulators_.size(); ++i) {
+        accumulators_[i]->merge(groupVals + stateOffsets_[i], partialVals + stateOffsets_[i]);
+    }
+}
 
-        for (const auto& proj : groupKeyProjs_) {
-            groupKeyVals.emplace_back(proj.eval(inputMetadata_, optInput.value()));
+void HashAggregator::appendGroupValues(std::any* groupVals, std::vector<std::any>& out) const
+{
+    if (accumulators_.empty()) {
+        for (size_t i = 0; i < aggExprs_.size(); ++i) {
+            out.emplace_back(std::move(groupVals[i]));
         }
+        return;
+    }
 
-        if (!hashStorage_.contains(groupKeyVals)) {
-            hashStorage_.emplace(groupKeyVals, std::vector<std::any>(aggExprs_.size()));
+    for (size_t i = 0; i < accumulators_.size(); ++i) {
+        out.emplace_back(accumulators_[i]->finish(groupVals + stateOffsets_[i]));
+    }
+}
 
-            auto inputVals = mergeValues(std::move(optInput.value()), hashStorage_[groupKeyVals]);
-            for (size_t i = 0; i < aggExprs_.size(); ++i) {
-                hashStorage_[groupKeyVals][i] = aggExprs_[i].initExpr.eval(inputMetadata_, inputVals);
+void HashAggregator::spill(const std::vector<std::any>& input, std::uint64_t hash)
+{
+    const std::size_t numPartitions = std::max<std::size_t>(options_.numSpillPartitions, 1);
+    if (spillPartitions_.empty()) {
+        spillPartitions_.resize(numPartitions);
+    }
+
+    auto& partition = spillPartitions_[partitionOf(hash, spillLevel_, numPartitions)];
+    if (!partition) {
+        partition = std::make_unique<SpillFile>(options_.spillDirectory);
+    }
+    partition->write(input);
+}
+
+void HashAggregator::finishSpilling()
+{
+    // Rewinding frees the buffers of partitions while they wait.
+    for (auto& partition: spillPartitions_) {
+        if (partition) {
+            partition->rewind();
+            pendingPartitions_.emplace_back(std::move(partition), spillLevel_ + 1);
+        }
+    }
+
+    spillPartitions_.clear();
+    overBudget_ = false;
+}
+
+void HashAggregator::aggregateInParallel()
+{
+    const std::size_t numThreads = resolveNumThreads(options_.numThreads);
+    std::vector<GroupHashTable> localTables(numThreads, hashTable_);
+    std::vector<GroupHashTable> mergedTables(numThreads, hashTable_);
+
+    std::mutex mutex;
+    std::exception_ptr error;
+    auto runThreads = [&](const auto& work) {
+        std::vector<std::thread> threads;
+        for (std::size_t t = 0; t < numThreads; ++t) {
+            threads.emplace_back([&, t]() {
+                try {
+                    work(t);
+                }
+                catch (...) {
+                    std::lock_guard lock(mutex);
+                    if (!error) {
+                        error = std::current_exception();
+                    }
+                }
+            });
+        }
+        for (auto& thread: threads) {
+            thread.join();
+        }
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    };
+
+    // Each thread pre-aggregates batches pulled from the child into its own table.
+    runThreads([&](std::size_t t) {
+        const auto groupKeyProjs = compiledGroupKeyProjs_;
+        const auto initExprs = compiledInitExprs_;
+        const auto contExprs = compiledContExprs_;
+        auto& table = localTables[t];
+        std::vector<std::any> groupKeyVals;
+
+        while (true) {
+            std::optional<Batch> batch;
+            {
+                std::lock_guard lock(mutex);
+                if (error || !child_->hasNext()) {
+                    break;
+                }
+                batch = child_->processNextBatch();
+            }
+            if (!batch) {
+                break;
+            }
+
+            for (size_t i = 0; i < batch->numRows(); ++i) {
+                auto input = batch->row(i);
+                groupKeyVals.clear();
+                for (const auto& proj: groupKeyProjs) {
+                    groupKeyVals.emplace_back(proj.eval(input));
+                }
+
+                auto [group, inserted] = table.findOrInsert(groupKeyVals);
+                accumulate(table.values(group), input, inserted ? initExprs : contExprs);
             }
         }
-        else {
-            auto inputVals = mergeValues(std::move(optInput.value()), hashStorage_[groupKeyVals]);
-            for (size_t i = 0; i < aggExprs_.size(); ++i) {
-                hashStorage_[groupKeyVals][i] = aggExprs_[i].contExpr.eval(inputMetadata_, inputVals);
+    });
+
+    // Thread t merges the groups of partition t of every thread-local table.
+    runThreads([&](std::size_t t) {
+        const auto mergeExprs = compiledMergeExprs_;
+        auto& merged = mergedTables[t];
+        std::vector<std::any> row;
+
+        for (auto& local: localTables) {
+            for (std::size_t group = 0; group < local.size(); ++group) {
+                if (partitionOf(local.hash(group), kMergeSeed, numThreads) != t) {
+                    continue;
+                }
+
+                row.clear();
+                local.appendKey(group, row);
+                auto [mergedGroup, inserted] = merged.findOrInsert(row);
+                auto mergedVals = merged.values(mergedGroup);
+                auto localVals = local.values(group);
+                if (inserted) {
+                    std::move(localVals, localVals + numGroupVals_, mergedVals);
+                    continue;
+                }
+
+                mergeGroup(mergedVals, localVals, row, mergeExprs);
             }
         }
+    });
+
+    mergedPartitions_ = std::move(mergedTables);
+}
+
+void HashAggregator::loadNextGroups()
+{
+    std::vector<std::any> row;
+    while (hashTable_.size() == 0) {
+        if (!mergedPartitions_.empty()) {
+            hashTable_ = std::move(mergedPartitions_.back());
+            mergedPartitions_.pop_back();
+            continue;
+        }
+
+        if (pendingPartitions_.empty()) {
+            break;
+        }
+
+        // The last queued partition is aggregated first to keep the number of files small.
+        auto [partition, level] = std::move(pendingPartitions_.back());
+        pendingPartitions_.pop_back();
+
+        spillLevel_ = level;
+        while (partition->read(row)) {
+            aggregate(std::move(row));
+        }
+        finishSpilling();
     }
+}
+
+void HashAggregator::open()
+{
+    hashTable_.clear();
+    nextGroup_ = 0;
+    stateMemoryUsage_ = 0;
+    overBudget_ = false;
+    spillLevel_ = 0;
+    spillPartitions_.clear();
+    pendingPartitions_.clear();
+    mergedPartitions_.clear();
+
+    child_->open();
 
-    it_ = hashStorage_.cbegin();
+    if (options_.clusteredInput) {
+        inputBatch_.reset();
+        inputPos_ = 0;
+        startStreamedGroup();
+        return;
+    }
+
+    if (resolveNumThreads(options_.numThreads) > 1) {
+        aggregateInParallel();
+        loadNextGroups();
+        return;
+    }
+
+    // Input is consumed batch by batch to save a virtual call per input row.
+    while (child_->hasNext()) {
+        auto batch = child_->processNextBatch();
+        if (!batch) {
+            break;
+        }
+
+        for (size_t i = 0; i < batch->numRows(); ++i) {
+            aggregate(batch->row(i));
+        }
+    }
+
+    finishSpilling();
+    loadNextGroups();
 }
 
 std::optional<std::vector<std::any>> HashAggregator::processNext()
 {
-    if (it_ == hashStorage_.cend()) {
+    if (!hasNext()) {
         return std::nullopt;
     }
 
-    auto cit = it_++;
-    auto nh = hashStorage_.extract(cit);
-    
-    auto rcandidate = mergeValues(std::move(nh.key()), nh.mapped());
+    return options_.clusteredInput ? extractStreamedGroup() : extractNextGroup();
+}
+
+std::optional<Batch> HashAggregator::processNextBatch(std::size_t maxRows)
+{
+    if (!hasNext()) {
+        return std::nullopt;
+    }
+
+    Batch batch(outputMetadata_.size());
+    while (batch.numRows() < maxRows && hasNext()) {
+        batch.appendRow(options_.clusteredInput ? extractStreamedGroup() : extractNextGroup());
+    }
+
+    return batch;
+}
+
+std::vector<std::any> HashAggregator::extractNextGroup()
+{
+    const auto group = nextGroup_++;
+
+    std::vector<std::any> rcandidate;
+    rcandidate.reserve(groupMetadata_.size());
+    hashTable_.appendKey(group, rcandidate);
+
+    appendGroupValues(hashTable_.values(group), rcandidate);
+
+    if (nextGroup_ == hashTable_.size()) {
+        hashTable_.clear();
+        nextGroup_ = 0;
+        stateMemoryUsage_ = 0;
+        loadNextGroups();
+    }
+
+    return projectOutput(std::move(rcandidate));
+}
+
+std::optional<std::vector<std::any>> HashAggregator::nextInputRow()
+{
+    while (!inputBatch_ || inputPos_ == inputBatch_->numRows()) {
+        inputBatch_.reset();
+        inputPos_ = 0;
+        if (!child_->hasNext()) {
+            return std::nullopt;
+        }
+
+        inputBatch_ = child_->processNextBatch();
+        if (!inputBatch_) {
+            return std::nullopt;
+        }
+    }
+
+    return inputBatch_->row(inputPos_++);
+}
+
+void HashAggregator::startStreamedGroup()
+{
+    auto input = nextInputRow();
+    hasStreamedGroup_ = input.has_value();
+    if (!hasStreamedGroup_) {
+        return;
+    }
+
+    streamedKey_.clear();
+    for (const auto& proj : compiledGroupKeyProjs_) {
+        streamedKey_.emplace_back(proj.eval(*input));
+    }
+
+    streamedVals_.assign(numGroupVals_, std::any());
+    accumulate(streamedVals_.data(), *input, compiledInitExprs_);
+}
+
+std::vector<std::any> HashAggregator::extractStreamedGroup()
+{
+    while (auto input = nextInputRow()) {
+        groupKeyVals_.clear();
+        for (const auto& proj : compiledGroupKeyProjs_) {
+            groupKeyVals_.emplace_back(proj.eval(*input));
+        }
+
+        if (!GroupHashTable::sameKey(groupKeyVals_, streamedKey_)) {
+            // The row starts the next group.
+            auto rcandidate = std::move(streamedKey_);
+            appendGroupValues(streamedVals_.data(), rcandidate);
+
+            streamedKey_ = std::move(groupKeyVals_);
+            streamedVals_.assign(numGroupVals_, std::any());
+            accumulate(streamedVals_.data(), *input, compiledInitExprs_);
+
+            return projectOutput(std::move(rcandidate));
+        }
+
+        accumulate(streamedVals_.data(), *input, compiledContExprs_);
+    }
+
+    // The input is exhausted and the streamed group is the last one.
+    hasStreamedGroup_ = false;
+    auto rcandidate = std::move(streamedKey_);
+    appendGroupValues(streamedVals_.data(), rcandidate);
+
+    return projectOutput(std::move(rcandidate));
+}
+
+std::vector<std::any> HashAggregator::projectOutput(std::vector<std::any>&& group)
+{
     if (outputProjs_.size() == 0) {
-        return std::move(rcandidate);
+        return std::move(group);
     }
 
-    for (size_t i = 0; i < outputProjs_.size(); ++i) {
-        rcandidate[i] = std::move(outputProjs_[i](groupMetadata_, rcandidate));
+    for (size_t i = 0; i < compiledOutputProjs_.size(); ++i) {
+        group[i] = std::move(compiledOutputProjs_[i](group));
     }
-    rcandidate.resize(outputProjs_.size());
+    group.resize(compiledOutputProjs_.size());
 
-    return std::move(rcandidate);
+    return std::move(group);
 }
 
 } // namespace codein;
@@ -6,32 +6,89 @@
  */
 
 #include <any>
+#include <cstddef>
+#include <cstdint>
 #include <memory>
 #include <optional>
+#include <string>
+#include <string_view>
 #include <tuple>
-#include <unordered_map>
 #include <utility>
 #include <vector>
 
+#include "accumulator.h"
 #include "any_visitor.h"
 #include "expression.h"
+#include "group_hash_table.h"
 #include "iterator.h"
+#include "spill_file.h"
 
 #pragma once
 
 namespace codein {
 
+/// Prefix of the names by which merge expressions refer to values of another partial aggregation.
+inline constexpr std::string_view kPartialPrefix = "partial.";
+
 /**
  * @brief Expression for aggregation. Composed of an initialization expression
  * and continuation expression.
+ *
+ * The merge expression combines two partial aggregations of a group, which is required to
+ * aggregate on multiple threads. It refers to the group key columns and the aggregation
+ * values by their names, and to the values of the other partial aggregation by their names
+ * prefixed with kPartialPrefix. e.g. "count" + "partial.count" merges counts.
  */
 struct AggregationExpression {
     Expression initExpr;
     Expression contExpr;
+    // OpCode::Noop if not given.
+    Expression mergeExpr = {};
+};
+
+/**
+ * @brief Exception thrown when aggregation on multiple threads is requested with
+ * aggregation expressions not having merge expressions.
+ */
+class MissingMergeExpression {};
+
+/**
+ * @brief Options for HashAggregator.
+ */
+struct HashAggregatorOptions {
+    // Bytes of memory the hash table and the states of its groups may use. 0 means no limit.
+    // When the table grows beyond the budget, input rows of groups not in the table are
+    // spilled to disk.
+    std::size_t memoryBudget = 0;
+    // Number of files spilled rows are hash-partitioned into.
+    std::size_t numSpillPartitions = 16;
+    // Directory where spill files are created. The system temporary directory if empty.
+    std::string spillDirectory;
+    // Number of threads aggregating input. 0 means the number of hardware threads.
+    // With more than one thread, every aggregation expression must have a merge expression,
+    // and memoryBudget is not applied.
+    std::size_t numThreads = 1;
+    // If true, the input must be clustered on the group keys, i.e., rows of a group are
+    // adjacent. Each group is output as soon as a row of another group arrives, without
+    // a hash table. memoryBudget and numThreads are not applied.
+    bool clusteredInput = false;
 };
 
 /**
  * @brief Hash aggregation iterator.
+ *
+ * If a memory budget is given and the hash table grows beyond it, the table stops taking new
+ * groups. Input rows of groups in the table are still aggregated in memory, while the other
+ * rows are hash-partitioned into spill files. After the groups in memory are output, each
+ * partition is aggregated in turn the same way, partitioning it further if it does not fit
+ * either. Each group is therefore aggregated in memory from all its rows at once.
+ *
+ * With multiple threads, each thread pulls batches from the child and pre-aggregates them
+ * into its own table. The groups of the thread-local tables are then hash-partitioned, and
+ * each thread merges one partition of every table with merge expressions.
+ *
+ * If the input is clustered on the group keys, groups are streamed: open() does not consume
+ * the input, and only the group being aggregated is kept in memory.
  */
 class HashAggregator : public Iterator {
 public:
@@ -47,11 +104,13 @@ public:
 
     bool hasNext() const override
     {
-        return it_ != hashStorage_.cend();
+        return options_.clusteredInput ? hasStreamedGroup_ : nextGroup_ < hashTable_.size();
     }
 
     std::optional<std::vector<std::any>> processNext() override;
 
+    std::optional<Batch> processNextBatch(std::size_t maxRows = kDefaultBatchSize) override;
+
     void close() override
     {}
 
@@ -71,12 +130,14 @@ private:
      * @param groupKeyCols Columns for group key.
      * @param groupValMetadata Defines aggregation variables.
      * @param aggExprs Aggregation expressions.
+     * @param options Options of aggregation.
      */
     HashAggregator(
         std::unique_ptr<Iterator>&& child,
         const std::vector<std::string>& groupKeyCols,
         const Metadata& groupValMetadata,
-        const std::vector<AggregationExpression>& aggExprs);
+        const std::vector<AggregationExpression>& aggExprs,
+        const HashAggregatorOptions& options = {});
 
     HashAggregator(
         std::unique_ptr<Iterator>&& child,
@@ -84,21 +145,79 @@ private:
         const Metadata& groupValMetadata,
         const Metadata& outputMetadata,
         const std::vector<AggregationExpression>& aggExprs,
-        const std::vector<Expression>& outputProjs);
+        const std::vector<Expression>& outputProjs,
+        const HashAggregatorOptions& options = {});
 
-    struct Hasher {
-        std::size_t operator()(const std::vector<std::any>& groupKeyVals) const;
-    };
+    /**
+     * @brief Constructs a new HashAggregator object aggregating with built-in aggregate functions.
+     * The output is group key columns followed by aggregated values.
+     *
+     * @param child A child iterator.
+     * @param groupKeyCols Columns for group key.
+     * @param aggregates Built-in aggregations.
+     * @param options Options of aggregation.
+     */
+    HashAggregator(
+        std::unique_ptr<Iterator>&& child,
+        const std::vector<std::string>& groupKeyCols,
+        const std::vector<AggregateSpec>& aggregates,
+        const HashAggregatorOptions& options = {});
 
-    struct KeyEqual {
-        bool operator()(const std::vector<std::any>& lhs, const std::vector<std::any>& rhs) const;
-    };
+    static std::vector<Expression> createGroupKeyProjExprs(const Metadata&, const std::vector<std::string>&);
 
-    using GroupKeyType = std::vector<std::any>;
-    using GroupValueType = std::vector<std::any>;
-    using HashStorageType = std::unordered_map<GroupKeyType, GroupValueType, Hasher, KeyEqual>;
+    static Metadata createGroupKeyMetadata(const Metadata&, const std::vector<std::string>&);
 
-    static std::vector<Expression> createGroupKeyProjExprs(const Metadata&, const std::vector<std::string>&);
+    // Compiles expressions against inputMetadata_ and groupMetadata_.
+    void compileExpressions();
+
+    // Aggregates an input row into its group, or spills it if its group is not in the table
+    // and the table is over the memory budget.
+    void aggregate(std::vector<std::any>&& input);
+
+    // Writes an input row into the spill partition of hash.
+    void spill(const std::vector<std::any>& input, std::uint64_t hash);
+
+    // Queues the partitions spilled while aggregating the current input.
+    void finishSpilling();
+
+    // Updates the values of a group with an input row, with accumulators_ if any, or exprs.
+    // exprs may append values to input.
+    void accumulate(std::any* groupVals, std::vector<std::any>& input, const std::vector<CompiledExpression>& exprs) const;
+
+    // Returns the bytes allocated on the heap by the states of accumulators_ in groupVals.
+    std::size_t stateMemoryUsage(const std::any* groupVals) const;
+
+    // Merges the values of another partial aggregation of a group into groupVals, with
+    // accumulators_ if any, or mergeExprs. keyVals holds group key values, and mergeExprs may
+    // append values to it.
+    void mergeGroup(std::any* groupVals, std::any* partialVals, std::vector<std::any>& keyVals,
+        const std::vector<CompiledExpression>& mergeExprs) const;
+
+    // Appends the aggregated values of a group to out, moving them out of groupVals.
+    void appendGroupValues(std::any* groupVals, std::vector<std::any>& out) const;
+
+    // Aggregates input on options_.numThreads threads into mergedPartitions_.
+    void aggregateInParallel();
+
+    // Loads the next merged partition, or aggregates queued spill partitions, until there are
+    // groups to output or nothing is left.
+    void loadNextGroups();
+
+    // Returns the group at nextGroup_ as an output row. The table is cleared after the last group.
+    std::vector<std::any> extractNextGroup();
+
+    // Returns the next input row from the child, or nullopt if the child is exhausted.
+    std::optional<std::vector<std::any>> nextInputRow();
+
+    // Starts the streamed group with the next input row, if any.
+    void startStreamedGroup();
+
+    // Aggregates input rows into the streamed group until a row of another group arrives,
+    // and returns the group as an output row.
+    std::vector<std::any> extractStreamedGroup();
+
+    // Applies output projections to group key values followed by aggregation values.
+    std::vector<std::any> projectOutput(std::vector<std::any>&& group);
 
     std::unique_ptr<Iterator> child_;
     Metadata inputMetadata_;
@@ -107,8 +226,46 @@ private:
     const std::vector<Expression> groupKeyProjs_;
     const std::vector<AggregationExpression> aggExprs_;
     std::vector<Expression> outputProjs_;
-    HashStorageType hashStorage_;
-    HashStorageType::const_iterator it_;
+    std::vector<CompiledExpression> compiledGroupKeyProjs_;
+    std::vector<CompiledExpression> compiledInitExprs_;
+    std::vector<CompiledExpression> compiledContExprs_;
+    // Group key columns, aggregation values and values of another partial aggregation.
+    Metadata mergeMetadata_;
+    std::vector<CompiledExpression> compiledMergeExprs_;
+    std::vector<CompiledExpression> compiledOutputProjs_;
+    // Accumulators of built-in aggregations, used instead of aggExprs_ if not empty.
+    std::vector<std::unique_ptr<Accumulator>> accumulators_;
+    // Index of the first state of each accumulator in the values of a group.
+    std::vector<std::size_t> stateOffsets_;
+    // Number of values of a group in hashTable_.
+    std::size_t numGroupVals_;
+    GroupHashTable hashTable_;
+    // Index of the next group to output.
+    std::size_t nextGroup_;
+    // Group key values of the row being aggregated.
+    std::vector<std::any> groupKeyVals_;
+
+    const HashAggregatorOptions options_;
+    // Bytes allocated on the heap by the states of groups in hashTable_, counted in the budget.
+    std::size_t stateMemoryUsage_;
+    // True if the table is over the memory budget and does not take new groups.
+    bool overBudget_;
+    // Number of times the rows being aggregated have been spilled.
+    std::size_t spillLevel_;
+    // Partitions being spilled into. Created when the first row is spilled.
+    std::vector<std::unique_ptr<SpillFile>> spillPartitions_;
+    // Partitions waiting to be aggregated with their spill levels.
+    std::vector<std::pair<std::unique_ptr<SpillFile>, std::size_t>> pendingPartitions_;
+    // Partitions merged on multiple threads waiting to be output.
+    std::vector<GroupHashTable> mergedPartitions_;
+
+    // Batch of input being streamed and the position of its next row.
+    std::optional<Batch> inputBatch_;
+    std::size_t inputPos_;
+    // Key and aggregation values of the streamed group.
+    bool hasStreamedGroup_;
+    std::vector<std::any> streamedKey_;
+    std::vector<std::any> streamedVals_;
 };
 
 } // namespace codein
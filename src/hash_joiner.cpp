@@ -0,0 +1,420 @@
+/**
+ * Copyright (C) 2021-present Codein Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify it under the terms of
+ * BSD-3-Clause License which can be found at the root directory of this repository.
+ */
+
+#include <algorithm>
+#include <any>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "any_visitor.h"
+#include "hash_joiner.h"
+
+namespace codein {
+
+namespace {
+
+constexpr std::size_t kNoRow = SIZE_MAX;
+
+Metadata createKeyMetadata(const Metadata& metadata, const std::vector<std::size_t>& keyCols)
+{
+    Metadata keyMetadata;
+    keyMetadata.reserve(keyCols.size());
+    for (auto col: keyCols) {
+        keyMetadata.emplace_back(metadata[col]);
+    }
+
+    return keyMetadata;
+}
+
+}
+
+HashJoiner::HashJoiner(
+    std::unique_ptr<Iterator>&& build,
+    std::unique_ptr<Iterator>&& probe,
+    const std::vector<std::string>& buildKeyCols,
+    const std::vector<std::string>& probeKeyCols,
+    JoinType joinType,
+    const HashJoinerOptions& options)
+    : build_(std::move(build))
+    , probe_(std::move(probe))
+    , joinType_(joinType)
+    , options_(options)
+    , buildKeyCols_(findKeyCols(build_->getMetadata(), buildKeyCols))
+    , probeKeyCols_(findKeyCols(probe_->getMetadata(), probeKeyCols))
+    , outputMetadata_(createOutputMetadata(build_->getMetadata(), probe_->getMetadata(), joinType))
+    , hashTable_(createKeyMetadata(build_->getMetadata(), buildKeyCols_), 0)
+    , buildRows_()
+    , firstRow_()
+    , lastRow_()
+    , nextRow_()
+    , memoryUsage_(0)
+    , buildPartitions_()
+    , probePartitions_()
+    , pendingPartitions_()
+    , probePartition_()
+    , keyVals_()
+    , output_()
+    , outputPos_(0)
+{
+    if (buildKeyCols_.size() != probeKeyCols_.size()) {
+        throw UnsupportedOperation();
+    }
+
+    for (std::size_t i = 0; i < buildKeyCols_.size(); ++i) {
+        if (build_->getMetadata()[buildKeyCols_[i]].typeIndex != probe_->getMetadata()[probeKeyCols_[i]].typeIndex) {
+            throw UnsupportedOperation();
+        }
+    }
+}
+
+std::vector<std::size_t> HashJoiner::findKeyCols(const Metadata& metadata, const std::vector<std::string>& keyCols)
+{
+    std::vector<std::size_t> cols;
+    cols.reserve(keyCols.size());
+    for (const auto& name: keyCols) {
+        cols.push_back(metadata[name]);
+    }
+
+    return cols;
+}
+
+Metadata HashJoiner::createOutputMetadata(const Metadata& build, const Metadata& probe, JoinType joinType)
+{
+    Metadata metadata(probe);
+    if (joinType == JoinType::Semi || joinType == JoinType::Anti) {
+        return metadata;
+    }
+
+    metadata.reserve(probe.size() + build.size());
+    for (std::size_t i = 0; i < build.size(); ++i) {
+        const auto& name = build[i].fieldName;
+        if (probe.find(name).first) {
+            metadata.emplace_back(std::string(kBuildPrefix) + name, build[i].typeIndex);
+        }
+        else {
+            metadata.emplace_back(build[i]);
+        }
+    }
+
+    return metadata;
+}
+
+HashJoiner::RowSource HashJoiner::readRows(Iterator& iterator)
+{
+    return [&iterator, batch = std::optional<Batch>(), pos = std::size_t(0)](auto& row) mutable {
+        while (!batch || pos == batch->numRows()) {
+            batch.reset();
+            pos = 0;
+            if (!iterator.hasNext() || !(batch = iterator.processNextBatch())) {
+                return false;
+            }
+        }
+
+        batch->readRow(pos++, row);
+        return true;
+    };
+}
+
+bool HashJoiner::readKey(const std::vector<std::any>& row, const std::vector<std::size_t>& keyCols,
+    std::vector<std::any>& keyVals)
+{
+    keyVals.clear();
+    for (auto col: keyCols) {
+        if (!row[col].has_value()) {
+            return false;
+        }
+        keyVals.push_back(row[col]);
+    }
+
+    return true;
+}
+
+void HashJoiner::open()
+{
+    build_->open();
+    probe_->open();
+
+    output_.clear();
+    outputPos_ = 0;
+    pendingPartitions_.clear();
+    probePartition_.reset();
+
+    if (!buildTable(readRows(*build_), 0)) {
+        partitionProbe(readRows(*probe_), 0);
+        loadNextPartition();
+    }
+
+    fillOutput();
+}
+
+void HashJoiner::clearTable()
+{
+    hashTable_.clear();
+    buildRows_.clear();
+    firstRow_.clear();
+    lastRow_.clear();
+    nextRow_.clear();
+    memoryUsage_ = 0;
+}
+
+bool HashJoiner::buildTable(const RowSource& source, std::size_t level)
+{
+    clearTable();
+
+    const bool keepRows = joinType_ == JoinType::Inner || joinType_ == JoinType::LeftOuter;
+    const bool canSpill = options_.memoryBudget != 0 && level < kMaxSpillLevel;
+    bool spilled = false;
+
+    std::vector<std::any> row;
+    while (source(row)) {
+        // Rows with a null key never match.
+        if (!readKey(row, buildKeyCols_, keyVals_)) {
+            continue;
+        }
+
+        if (spilled) {
+            std::uint64_t hash;
+            hashTable_.find(keyVals_, &hash);
+            spill(buildPartitions_, row, hash, level);
+            continue;
+        }
+
+        const auto [group, inserted] = hashTable_.findOrInsert(keyVals_);
+        if (keepRows) {
+            const auto rowIdx = buildRows_.size();
+            memoryUsage_ += rowMemoryUsage(row);
+            buildRows_.push_back(std::move(row));
+            nextRow_.push_back(kNoRow);
+            if (inserted) {
+                firstRow_.push_back(rowIdx);
+                lastRow_.push_back(rowIdx);
+            }
+            else {
+                nextRow_[lastRow_[group]] = rowIdx;
+                lastRow_[group] = rowIdx;
+            }
+        }
+
+        if (canSpill && memoryUsage_ + hashTable_.memoryUsage() > options_.memoryBudget) {
+            spillTable(level);
+            spilled = true;
+        }
+    }
+
+    // Rewinding frees the buffers of partitions while probe rows are partitioned.
+    for (auto& partition: buildPartitions_) {
+        if (partition) {
+            partition->rewind();
+        }
+    }
+
+    return !spilled;
+}
+
+void HashJoiner::spillTable(std::size_t level)
+{
+    std::vector<std::any> row;
+    for (std::size_t group = 0; group < hashTable_.size(); ++group) {
+        const auto hash = hashTable_.hash(group);
+        if (!buildRows_.empty()) {
+            for (auto r = firstRow_[group]; r != kNoRow; r = nextRow_[r]) {
+                spill(buildPartitions_, buildRows_[r], hash, level);
+            }
+            continue;
+        }
+
+        // Semi and anti joins keep only keys, which are spilled at their columns.
+        keyVals_.clear();
+        hashTable_.appendKey(group, keyVals_);
+        row.assign(build_->getMetadata().size(), std::any());
+        for (std::size_t i = 0; i < buildKeyCols_.size(); ++i) {
+            row[buildKeyCols_[i]] = std::move(keyVals_[i]);
+        }
+        spill(buildPartitions_, row, hash, level);
+    }
+
+    clearTable();
+}
+
+void HashJoiner::spill(std::vector<std::unique_ptr<SpillFile>>& partitions, const std::vector<std::any>& row,
+    std::uint64_t hash, std::size_t level)
+{
+    const auto numPartitions = std::max<std::size_t>(options_.numSpillPartitions, 2);
+    if (partitions.empty()) {
+        partitions.resize(numPartitions);
+    }
+
+    auto& partition = partitions[partitionOf(hash, level, numPartitions)];
+    if (!partition) {
+        partition = std::make_unique<SpillFile>(options_.spillDirectory);
+    }
+    partition->write(row);
+}
+
+void HashJoiner::partitionProbe(const RowSource& source, std::size_t level)
+{
+    std::vector<std::any> row;
+    while (source(row)) {
+        // Rows with a null key match no partition, and go to any partition to be output by
+        // left outer and anti joins.
+        std::uint64_t hash = 0;
+        if (readKey(row, probeKeyCols_, keyVals_)) {
+            hashTable_.find(keyVals_, &hash);
+        }
+        spill(probePartitions_, row, hash, level);
+    }
+
+    // A partition without probe rows outputs nothing, and one without build rows outputs
+    // nothing unless probe rows are output without matches.
+    const bool keepUnmatched = joinType_ == JoinType::LeftOuter || joinType_ == JoinType::Anti;
+    buildPartitions_.resize(probePartitions_.size());
+    for (std::size_t i = 0; i < probePartitions_.size(); ++i) {
+        if (probePartitions_[i] && (buildPartitions_[i] || keepUnmatched)) {
+            probePartitions_[i]->rewind();
+            pendingPartitions_.push_back(
+                Partition{std::move(buildPartitions_[i]), std::move(probePartitions_[i]), level + 1});
+        }
+    }
+
+    buildPartitions_.clear();
+    probePartitions_.clear();
+}
+
+bool HashJoiner::loadNextPartition()
+{
+    while (!pendingPartitions_.empty()) {
+        // The last queued partition is joined first, so that the partitions of a partition
+        // split further are joined before its siblings and few files are open at once.
+        auto partition = std::move(pendingPartitions_.back());
+        pendingPartitions_.pop_back();
+
+        auto build = partition.build.get();
+        const bool fits = buildTable([build](auto& row) { return build != nullptr && build->read(row); },
+            partition.level);
+        partition.build.reset();
+
+        auto probe = partition.probe.get();
+        if (!fits) {
+            partitionProbe([probe](auto& row) { return probe->read(row); }, partition.level);
+            continue;
+        }
+
+        probePartition_ = std::move(partition.probe);
+        return true;
+    }
+
+    return false;
+}
+
+void HashJoiner::joinRow(std::vector<std::any>& probeRow)
+{
+    std::optional<std::size_t> group;
+    if (readKey(probeRow, probeKeyCols_, keyVals_)) {
+        group = hashTable_.find(keyVals_);
+    }
+
+    switch (joinType_) {
+    case JoinType::Semi:
+    case JoinType::Anti:
+        if (group.has_value() == (joinType_ == JoinType::Semi)) {
+            output_.push_back(std::move(probeRow));
+        }
+        return;
+
+    case JoinType::Inner:
+    case JoinType::LeftOuter:
+        break;
+    }
+
+    if (!group) {
+        if (joinType_ == JoinType::LeftOuter) {
+            auto& out = output_.emplace_back(std::move(probeRow));
+            out.resize(outputMetadata_.size());
+        }
+        return;
+    }
+
+    for (auto r = firstRow_[*group]; r != kNoRow; r = nextRow_[r]) {
+        auto& out = output_.emplace_back();
+        out.reserve(outputMetadata_.size());
+        out.insert(out.end(), probeRow.begin(), probeRow.end());
+        out.insert(out.end(), buildRows_[r].begin(), buildRows_[r].end());
+    }
+}
+
+void HashJoiner::fillOutput()
+{
+    std::vector<std::any> probeRow;
+    while (outputPos_ == output_.size()) {
+        output_.clear();
+        outputPos_ = 0;
+
+        if (probePartition_) {
+            std::size_t n = 0;
+            while (n < kDefaultBatchSize && probePartition_->read(probeRow)) {
+                joinRow(probeRow);
+                ++n;
+            }
+            if (n < kDefaultBatchSize) {
+                probePartition_.reset();
+                loadNextPartition();
+            }
+            continue;
+        }
+
+        if (!probe_->hasNext()) {
+            break;
+        }
+
+        auto batch = probe_->processNextBatch();
+        if (!batch) {
+            break;
+        }
+
+        for (std::size_t i = 0; i < batch->numRows(); ++i) {
+            batch->readRow(i, probeRow);
+            joinRow(probeRow);
+        }
+    }
+}
+
+std::optional<std::vector<std::any>> HashJoiner::processNext()
+{
+    if (!hasNext()) {
+        return std::nullopt;
+    }
+
+    auto row = std::move(output_[outputPos_++]);
+    if (outputPos_ == output_.size()) {
+        fillOutput();
+    }
+
+    return row;
+}
+
+std::optional<Batch> HashJoiner::processNextBatch(std::size_t maxRows)
+{
+    if (!hasNext()) {
+        return std::nullopt;
+    }
+
+    Batch batch(outputMetadata_.size());
+    while (batch.numRows() < maxRows && hasNext()) {
+        batch.appendRow(std::move(output_[outputPos_++]));
+        if (outputPos_ == output_.size()) {
+            fillOutput();
+        }
+    }
+
+    return batch;
+}
+
+} // namespace codein
@@ -0,0 +1,227 @@
+/**
+ * Copyright (C) 2021-present Codein Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify it under the terms of
+ * BSD-3-Clause License which can be found at the root directory of this repository.
+ */
+
+#include <any>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "group_hash_table.h"
+#include "iterator.h"
+#include "spill_file.h"
+
+#pragma once
+
+namespace codein {
+
+/// Prefix of output names of build columns whose names are taken by probe columns.
+inline constexpr std::string_view kBuildPrefix = "build.";
+
+/**
+ * @brief Types of joins. The probe side is the left side of the join.
+ */
+enum class JoinType {
+    // Pairs of probe and build rows with equal keys.
+    Inner,
+    // Inner join, plus probe rows matching no build row paired with nulls.
+    LeftOuter,
+    // Probe rows matching any build row.
+    Semi,
+    // Probe rows matching no build row.
+    Anti,
+};
+
+/**
+ * @brief Options for HashJoiner.
+ */
+struct HashJoinerOptions {
+    // Bytes of memory the hash table of build rows may use. 0 means no limit. When the table
+    // grows beyond the budget, both inputs are hash-partitioned into spill files.
+    std::size_t memoryBudget = 0;
+    // Number of files spilled rows of each side are hash-partitioned into.
+    std::size_t numSpillPartitions = 16;
+    // Directory where spill files are created. The system temporary directory if empty.
+    std::string spillDirectory;
+};
+
+/**
+ * @brief Hash join iterator.
+ *
+ * open() reads the whole build input into a hash table on the build key columns, and probe
+ * rows are then streamed and looked up in the table. Keys are equal only if all their values
+ * are equal and not null, like SQL.
+ *
+ * If a memory budget is given and the build input does not fit in it, the join falls back to
+ * a grace hash join: both inputs are hash-partitioned on the keys into spill files, and each
+ * pair of partitions is joined in turn the same way, partitioning it further if its build
+ * side does not fit either. Rows are then output partition by partition instead of in probe
+ * input order. Partitions are split at most kMaxSpillLevel times, after which a partition
+ * is joined in memory even if it exceeds the budget, because rows of a single key cannot
+ * be split.
+ *
+ * Inner and left outer joins output the probe columns followed by the build columns, with
+ * matches of a probe row in build input order. Semi and anti joins output the probe columns
+ * only, and do not keep build rows in memory.
+ */
+class HashJoiner : public Iterator {
+public:
+    static constexpr std::size_t kMaxSpillLevel = 4;
+
+    template <typename T, typename... ArgTs>
+    friend std::unique_ptr<Iterator> makeIterator(ArgTs&&...);
+
+    void open() override;
+
+    void reopen() override
+    {
+        open();
+    }
+
+    bool hasNext() const override
+    {
+        return outputPos_ < output_.size();
+    }
+
+    std::optional<std::vector<std::any>> processNext() override;
+
+    std::optional<Batch> processNextBatch(std::size_t maxRows = kDefaultBatchSize) override;
+
+    void close() override
+    {
+        build_->close();
+        probe_->close();
+    }
+
+    const Metadata& getMetadata() const override
+    {
+        return outputMetadata_;
+    }
+
+    ~HashJoiner() override
+    {}
+
+    /// Returns the output metadata of a join of build and probe rows described by the arguments.
+    static Metadata createOutputMetadata(const Metadata& build, const Metadata& probe, JoinType joinType);
+
+private:
+    /**
+     * @brief Constructs a new HashJoiner object.
+     *
+     * Throws UnknownName if a key column does not exist, and UnsupportedOperation if the
+     * numbers or the types of the key columns of both sides differ.
+     *
+     * @param build Child iterator whose rows are kept in the hash table.
+     * @param probe Child iterator whose rows are streamed.
+     * @param buildKeyCols Key columns of the build side.
+     * @param probeKeyCols Key columns of the probe side, in the order of buildKeyCols.
+     * @param joinType Type of the join.
+     * @param options Options of the join.
+     */
+    HashJoiner(
+        std::unique_ptr<Iterator>&& build,
+        std::unique_ptr<Iterator>&& probe,
+        const std::vector<std::string>& buildKeyCols,
+        const std::vector<std::string>& probeKeyCols,
+        JoinType joinType = JoinType::Inner,
+        const HashJoinerOptions& options = {});
+
+    /// Constructs a new HashJoiner object joining on key columns of the same names on both sides.
+    HashJoiner(
+        std::unique_ptr<Iterator>&& build,
+        std::unique_ptr<Iterator>&& probe,
+        const std::vector<std::string>& keyCols,
+        JoinType joinType = JoinType::Inner,
+        const HashJoinerOptions& options = {})
+        : HashJoiner(std::move(build), std::move(probe), keyCols, keyCols, joinType, options)
+    {}
+
+    // Reads the next row into its argument. Returns false at the end.
+    using RowSource = std::function<bool(std::vector<std::any>&)>;
+
+    // Build and probe sides of a spilled partition, and the spill level they are split at.
+    struct Partition {
+        std::unique_ptr<SpillFile> build;
+        std::unique_ptr<SpillFile> probe;
+        std::size_t level;
+    };
+
+    static std::vector<std::size_t> findKeyCols(const Metadata&, const std::vector<std::string>&);
+
+    // Returns a source reading rows of iterator batch by batch.
+    static RowSource readRows(Iterator& iterator);
+
+    // Reads key values of row at keyCols into keyVals. Returns false if any of them is null.
+    static bool readKey(const std::vector<std::any>& row, const std::vector<std::size_t>& keyCols,
+        std::vector<std::any>& keyVals);
+
+    // Removes all build rows from the hash table.
+    void clearTable();
+
+    // Reads build rows into the hash table. If the table grows beyond the memory budget at
+    // a level below kMaxSpillLevel, spills the table and the remaining rows into
+    // buildPartitions_ and returns false.
+    bool buildTable(const RowSource& source, std::size_t level);
+
+    // Writes build rows in the hash table into buildPartitions_ and clears the table.
+    void spillTable(std::size_t level);
+
+    // Writes row into the partition of hash among partitions.
+    void spill(std::vector<std::unique_ptr<SpillFile>>& partitions, const std::vector<std::any>& row,
+        std::uint64_t hash, std::size_t level);
+
+    // Writes probe rows into probePartitions_, and queues them with buildPartitions_.
+    void partitionProbe(const RowSource& source, std::size_t level);
+
+    // Builds the table of the next queued partition whose build side fits in memory,
+    // partitioning the others further. Returns false if no partition is left.
+    bool loadNextPartition();
+
+    // Joins a probe row, appending output rows to output_. probeRow may be moved out.
+    void joinRow(std::vector<std::any>& probeRow);
+
+    // Joins probe batches until there are output rows or the probe input is exhausted.
+    void fillOutput();
+
+    std::unique_ptr<Iterator> build_;
+    std::unique_ptr<Iterator> probe_;
+    const JoinType joinType_;
+    const HashJoinerOptions options_;
+    const std::vector<std::size_t> buildKeyCols_;
+    const std::vector<std::size_t> probeKeyCols_;
+    const Metadata outputMetadata_;
+
+    GroupHashTable hashTable_;
+    // Build rows, and the chains of rows of each key in build input order. Empty for semi
+    // and anti joins.
+    std::vector<std::vector<std::any>> buildRows_;
+    std::vector<std::size_t> firstRow_;
+    std::vector<std::size_t> lastRow_;
+    std::vector<std::size_t> nextRow_;
+    // Bytes used by build rows.
+    std::size_t memoryUsage_;
+
+    // Partitions being spilled, partitions waiting to be joined, and the probe side of the
+    // partition being joined.
+    std::vector<std::unique_ptr<SpillFile>> buildPartitions_;
+    std::vector<std::unique_ptr<SpillFile>> probePartitions_;
+    std::vector<Partition> pendingPartitions_;
+    std::unique_ptr<SpillFile> probePartition_;
+
+    // Buffer of key values of a row.
+    std::vector<std::any> keyVals_;
+
+    // Output rows of the probe batch joined last.
+    std::vector<std::vector<std::any>> output_;
+    std::size_t outputPos_;
+};
+
+} // namespace codein
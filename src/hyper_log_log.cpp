@@ -0,0 +1,88 @@
+/**
+ * Copyright (C) 2021-present Codein Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify it under the terms of
+ * BSD-3-Clause License which can be found at the root directory of this repository.
+ */
+
+#include <algorithm>
+#include <any>
+#include <bit>
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+
+#include "any_visitor.h"
+#include "hyper_log_log.h"
+
+namespace codein {
+
+namespace {
+
+// Final mix of murmur3. hashAny() returns std::hash values, which are the identity for integers.
+std::uint64_t mixHash(std::uint64_t h)
+{
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdull;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ull;
+    h ^= h >> 33;
+
+    return h;
+}
+
+}
+
+HyperLogLog::HyperLogLog(unsigned int precision)
+    : precision_(std::clamp(precision, kMinPrecision, kMaxPrecision))
+    , registers_(std::size_t(1) << precision_, 0)
+{}
+
+void HyperLogLog::addHash(std::uint64_t hash)
+{
+    // The upper bits choose a register, and the register keeps the maximum rank of the first
+    // 1 bit in the remaining bits.
+    const std::size_t idx = hash >> (64 - precision_);
+    const std::uint64_t rest = (hash << precision_) | (std::uint64_t(1) << (precision_ - 1));
+    const auto rank = static_cast<std::uint8_t>(std::countl_zero(rest) + 1);
+
+    registers_[idx] = std::max(registers_[idx], rank);
+}
+
+void HyperLogLog::add(const std::any& value)
+{
+    addHash(mixHash(hashAny(value)));
+}
+
+void HyperLogLog::merge(const HyperLogLog& other)
+{
+    assert(precision_ == other.precision_);
+
+    for (std::size_t i = 0; i < registers_.size(); ++i) {
+        registers_[i] = std::max(registers_[i], other.registers_[i]);
+    }
+}
+
+double HyperLogLog::estimate() const
+{
+    const double m = static_cast<double>(registers_.size());
+
+    double sum = 0;
+    std::size_t zeros = 0;
+    for (auto r: registers_) {
+        sum += std::ldexp(1.0, -r);
+        zeros += r == 0;
+    }
+
+    const double alpha = 0.7213 / (1 + 1.079 / m);
+    const double e = alpha * m * m / sum;
+
+    // Linear counting is more accurate for small cardinalities.
+    if (e <= 2.5 * m && zeros != 0) {
+        return m * std::log(m / zeros);
+    }
+
+    return e;
+}
+
+} // namespace codein
@@ -10,6 +10,7 @@
 #include <optional>
 #include <vector>
 
+#include "batch.h"
 #include "metadata.h"
 
 #pragma once
@@ -21,6 +22,7 @@ namespace codein {
  * 
  * Iterator interface defines all methods that all iterators must implement.
  * open(), reopen(), hasMore(), processNext(), close(), and getMetadata().
+ * processNextBatch() has a default implementation on top of processNext().
  */
 struct Iterator {
     /**
@@ -53,6 +55,35 @@ struct Iterator {
      */
     virtual std::optional<std::vector<std::any>> processNext() = 0;
 
+    /**
+     * @brief Process up to maxRows next data and return them as a batch
+     * 
+     * The default implementation collects rows from processNext(). Iterators override it
+     * so that a virtual call and a row vector are not paid for every row.
+     * 
+     * @param maxRows Maximum number of rows in the returned batch
+     * @return std::optional<Batch> 
+     * If there's no more data, return value must be std::nullopt.
+     * Otherwise, the returned batch must contain at least one row.
+     */
+    virtual std::optional<Batch> processNextBatch(std::size_t maxRows = kDefaultBatchSize)
+    {
+        std::optional<Batch> batch;
+        while ((!batch || batch->numRows() < maxRows) && hasNext()) {
+            auto row = processNext();
+            if (!row) {
+                break;
+            }
+
+            if (!batch) {
+                batch.emplace(row->size());
+            }
+            batch->appendRow(std::move(row.value()));
+        }
+
+        return batch;
+    }
+
     /**
      * @brief 
      */
@@ -5,6 +5,7 @@
  * BSD-3-Clause License which can be found at the root directory of this repository.
  */
 
+#include <algorithm>
 #include <any>
 #include <optional>
 #include <vector>
@@ -23,4 +24,22 @@ std::optional<std::vector<std::any>> Limiter::processNext()
     return child_->processNext();
 }
 
+std::optional<Batch> Limiter::processNextBatch(std::size_t maxRows)
+{
+    if (!hasNext()) {
+        return std::nullopt;
+    }
+
+    const size_t remaining = limit_ - curOutput_;
+    auto batch = child_->processNextBatch(std::min(maxRows, remaining));
+    if (!batch.has_value()) {
+        return std::nullopt;
+    }
+
+    batch->truncate(remaining);
+    curOutput_ += batch->numRows();
+
+    return batch;
+}
+
 } // namespace codein
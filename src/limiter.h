@@ -37,6 +37,8 @@ public:
 
     std::optional<std::vector<std::any>> processNext() override;
 
+    std::optional<Batch> processNextBatch(std::size_t maxRows = kDefaultBatchSize) override;
+
     void close() override
     {
         child_->close();
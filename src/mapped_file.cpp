@@ -0,0 +1,93 @@
+/**
+ * Copyright (C) 2021-present Codein Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify it under the terms of
+ * BSD-3-Clause License which can be found at the root directory of this repository.
+ */
+
+#include <fcntl.h>
+#include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <utility>
+
+#include "mapped_file.h"
+
+namespace codein {
+
+MappedFile::MappedFile(const std::string& fileName)
+{
+    open(fileName);
+}
+
+MappedFile::MappedFile(MappedFile&& other) noexcept
+    : data_(std::exchange(other.data_, nullptr))
+    , size_(std::exchange(other.size_, 0))
+    , isOpen_(std::exchange(other.isOpen_, false))
+{}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept
+{
+    if (this != &other) {
+        close();
+        data_ = std::exchange(other.data_, nullptr);
+        size_ = std::exchange(other.size_, 0);
+        isOpen_ = std::exchange(other.isOpen_, false);
+    }
+
+    return *this;
+}
+
+MappedFile::~MappedFile()
+{
+    close();
+}
+
+bool MappedFile::open(const std::string& fileName)
+{
+    close();
+
+    int fd = ::open(fileName.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+
+    struct stat st;
+    if (::fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+        ::close(fd);
+        return false;
+    }
+
+    // mmap() does not accept zero length. An empty file is open but has no mapping.
+    if (st.st_size > 0) {
+        void* p = ::mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (p == MAP_FAILED) {
+            ::close(fd);
+            return false;
+        }
+
+        ::madvise(p, st.st_size, MADV_SEQUENTIAL);
+        data_ = static_cast<const char*>(p);
+        size_ = st.st_size;
+    }
+
+    // The mapping stays valid after the descriptor is closed.
+    ::close(fd);
+    isOpen_ = true;
+
+    return true;
+}
+
+void MappedFile::close()
+{
+    if (data_ != nullptr) {
+        ::munmap(const_cast<char*>(data_), size_);
+    }
+
+    data_ = nullptr;
+    size_ = 0;
+    isOpen_ = false;
+}
+
+} // namespace codein
@@ -0,0 +1,73 @@
+/**
+ * Copyright (C) 2021-present Codein Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify it under the terms of
+ * BSD-3-Clause License which can be found at the root directory of this repository.
+ */
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+#pragma once
+
+namespace codein {
+
+/**
+ * @brief Read-only memory mapping of a whole file.
+ * 
+ * Pages are loaded on demand by the kernel and shared with the page cache, so rescanning
+ * a file that was read recently does not copy it again.
+ */
+class MappedFile {
+public:
+    MappedFile() = default;
+
+    /**
+     * @brief Maps the file. isOpen() tells whether mapping succeeded.
+     * 
+     * @param fileName: name of the file to map.
+     */
+    explicit MappedFile(const std::string& fileName);
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile(MappedFile&& other) noexcept;
+
+    MappedFile& operator=(const MappedFile&) = delete;
+    MappedFile& operator=(MappedFile&& other) noexcept;
+
+    ~MappedFile();
+
+    /**
+     * @brief Maps the file, unmapping the currently mapped file if any.
+     * 
+     * @param fileName: name of the file to map.
+     * @return true if the file is mapped. false otherwise.
+     */
+    bool open(const std::string& fileName);
+
+    void close();
+
+    bool isOpen() const
+    {
+        return isOpen_;
+    }
+
+    /// Contents of the file. Valid until the file is closed.
+    std::string_view data() const
+    {
+        return std::string_view(data_, size_);
+    }
+
+    std::size_t size() const
+    {
+        return size_;
+    }
+
+private:
+    const char* data_ = nullptr;
+    std::size_t size_ = 0;
+    bool isOpen_ = false;
+};
+
+} // namespace codein
@@ -0,0 +1,267 @@
+/**
+ * Copyright (C) 2021-present Codein Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify it under the terms of
+ * BSD-3-Clause License which can be found at the root directory of this repository.
+ */
+
+#include <any>
+#include <cmath>
+#include <cstddef>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "any_visitor.h"
+#include "merge_joiner.h"
+
+namespace codein {
+
+namespace {
+
+bool isNaN(const std::any& value)
+{
+    if (const auto f = std::any_cast<float>(&value); f != nullptr) {
+        return std::isnan(*f);
+    }
+    if (const auto d = std::any_cast<double>(&value); d != nullptr) {
+        return std::isnan(*d);
+    }
+
+    return false;
+}
+
+}
+
+MergeJoiner::MergeJoiner(
+    std::unique_ptr<Iterator>&& left,
+    std::unique_ptr<Iterator>&& right,
+    const std::vector<std::string>& leftKeyCols,
+    const std::vector<std::string>& rightKeyCols,
+    JoinType joinType)
+    : left_(std::move(left))
+    , right_(std::move(right))
+    , joinType_(joinType)
+    , leftKeyCols_(findKeyCols(left_->getMetadata(), leftKeyCols))
+    , rightKeyCols_(findKeyCols(right_->getMetadata(), rightKeyCols))
+    , outputMetadata_(HashJoiner::createOutputMetadata(right_->getMetadata(), left_->getMetadata(), joinType))
+    , keyComparator_(createKeyComparator(left_->getMetadata(), leftKeyCols_))
+    , prevLeftKey_()
+    , hasPrevLeftKey_(false)
+    , rightBatch_()
+    , rightPos_(0)
+    , rightRow_()
+    , rightKey_()
+    , hasRightRow_(false)
+    , rightRun_()
+    , runKey_()
+    , hasRun_(false)
+    , keyVals_()
+    , output_()
+    , outputPos_(0)
+{
+    if (leftKeyCols_.size() != rightKeyCols_.size()) {
+        throw UnsupportedOperation();
+    }
+
+    for (std::size_t i = 0; i < leftKeyCols_.size(); ++i) {
+        if (left_->getMetadata()[leftKeyCols_[i]].typeIndex != right_->getMetadata()[rightKeyCols_[i]].typeIndex) {
+            throw UnsupportedOperation();
+        }
+    }
+}
+
+std::vector<std::size_t> MergeJoiner::findKeyCols(const Metadata& metadata, const std::vector<std::string>& keyCols)
+{
+    std::vector<std::size_t> cols;
+    cols.reserve(keyCols.size());
+    for (const auto& name: keyCols) {
+        cols.push_back(metadata[name]);
+    }
+
+    return cols;
+}
+
+RowComparator MergeJoiner::createKeyComparator(const Metadata& metadata, const std::vector<std::size_t>& keyCols)
+{
+    // Key values are compared as rows of their own, whose columns are named by position.
+    Metadata keyMetadata;
+    std::vector<SortKey> keys;
+    for (std::size_t i = 0; i < keyCols.size(); ++i) {
+        keyMetadata.emplace_back(std::to_string(i), metadata[keyCols[i]].typeIndex);
+        keys.push_back(SortKey{std::to_string(i)});
+    }
+
+    return RowComparator(keys, keyMetadata);
+}
+
+bool MergeJoiner::readKey(const std::vector<std::any>& row, const std::vector<std::size_t>& keyCols,
+    std::vector<std::any>& keyVals)
+{
+    bool notNull = true;
+    keyVals.clear();
+    for (auto col: keyCols) {
+        notNull = notNull && row[col].has_value() && !isNaN(row[col]);
+        keyVals.push_back(row[col]);
+    }
+
+    return notNull;
+}
+
+void MergeJoiner::open()
+{
+    left_->open();
+    right_->open();
+
+    hasPrevLeftKey_ = false;
+    rightBatch_.reset();
+    rightPos_ = 0;
+    hasRightRow_ = true;
+    rightKey_.clear();
+    rightRun_.clear();
+    hasRun_ = false;
+    output_.clear();
+    outputPos_ = 0;
+
+    nextRightRow();
+    fillOutput();
+}
+
+void MergeJoiner::nextRightRow()
+{
+    while (!rightBatch_ || rightPos_ == rightBatch_->numRows()) {
+        rightBatch_.reset();
+        rightPos_ = 0;
+        if (!right_->hasNext() || !(rightBatch_ = right_->processNextBatch())) {
+            hasRightRow_ = false;
+            return;
+        }
+    }
+
+    rightBatch_->readRow(rightPos_++, rightRow_);
+    const bool hadRightRow = !rightKey_.empty();
+    readKey(rightRow_, rightKeyCols_, keyVals_);
+    if (hadRightRow && keyComparator_.compare(keyVals_, rightKey_) < 0) {
+        throw UnsortedInput();
+    }
+    rightKey_.swap(keyVals_);
+}
+
+void MergeJoiner::advanceRight(const std::vector<std::any>& key)
+{
+    rightRun_.clear();
+    runKey_ = key;
+    hasRun_ = true;
+
+    // Right rows of null keys are less than key, and skipped like right rows of smaller keys.
+    while (hasRightRow_) {
+        const int c = keyComparator_.compare(rightKey_, key);
+        if (c > 0) {
+            break;
+        }
+
+        if (c == 0) {
+            rightRun_.push_back(std::move(rightRow_));
+        }
+        nextRightRow();
+    }
+}
+
+void MergeJoiner::joinRow(std::vector<std::any>& leftRow)
+{
+    const bool notNull = readKey(leftRow, leftKeyCols_, keyVals_);
+    if (hasPrevLeftKey_ && keyComparator_.compare(keyVals_, prevLeftKey_) < 0) {
+        throw UnsortedInput();
+    }
+    prevLeftKey_.swap(keyVals_);
+    hasPrevLeftKey_ = true;
+
+    bool matched = false;
+    if (notNull) {
+        if (!hasRun_ || keyComparator_.compare(prevLeftKey_, runKey_) != 0) {
+            advanceRight(prevLeftKey_);
+        }
+        matched = !rightRun_.empty();
+    }
+
+    switch (joinType_) {
+    case JoinType::Semi:
+    case JoinType::Anti:
+        if (matched == (joinType_ == JoinType::Semi)) {
+            output_.push_back(std::move(leftRow));
+        }
+        return;
+
+    case JoinType::Inner:
+    case JoinType::LeftOuter:
+        break;
+    }
+
+    if (!matched) {
+        if (joinType_ == JoinType::LeftOuter) {
+            auto& out = output_.emplace_back(std::move(leftRow));
+            out.resize(outputMetadata_.size());
+        }
+        return;
+    }
+
+    for (const auto& rightRow: rightRun_) {
+        auto& out = output_.emplace_back();
+        out.reserve(outputMetadata_.size());
+        out.insert(out.end(), leftRow.begin(), leftRow.end());
+        out.insert(out.end(), rightRow.begin(), rightRow.end());
+    }
+}
+
+void MergeJoiner::fillOutput()
+{
+    std::vector<std::any> leftRow;
+    while (outputPos_ == output_.size() && left_->hasNext()) {
+        output_.clear();
+        outputPos_ = 0;
+
+        auto batch = left_->processNextBatch();
+        if (!batch) {
+            break;
+        }
+
+        for (std::size_t i = 0; i < batch->numRows(); ++i) {
+            batch->readRow(i, leftRow);
+            joinRow(leftRow);
+        }
+    }
+}
+
+std::optional<std::vector<std::any>> MergeJoiner::processNext()
+{
+    if (!hasNext()) {
+        return std::nullopt;
+    }
+
+    auto row = std::move(output_[outputPos_++]);
+    if (outputPos_ == output_.size()) {
+        fillOutput();
+    }
+
+    return row;
+}
+
+std::optional<Batch> MergeJoiner::processNextBatch(std::size_t maxRows)
+{
+    if (!hasNext()) {
+        return std::nullopt;
+    }
+
+    Batch batch(outputMetadata_.size());
+    while (batch.numRows() < maxRows && hasNext()) {
+        batch.appendRow(std::move(output_[outputPos_++]));
+        if (outputPos_ == output_.size()) {
+            fillOutput();
+        }
+    }
+
+    return batch;
+}
+
+} // namespace codein
@@ -0,0 +1,161 @@
+/**
+ * Copyright (C) 2021-present Codein Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify it under the terms of
+ * BSD-3-Clause License which can be found at the root directory of this repository.
+ */
+
+#include <any>
+#include <cstddef>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "hash_joiner.h"
+#include "iterator.h"
+#include "sort_key.h"
+
+#pragma once
+
+namespace codein {
+
+/**
+ * @brief Exception thrown when an input of MergeJoiner is not sorted on its key columns.
+ */
+class UnsortedInput {};
+
+/**
+ * @brief Sort-merge join iterator for inputs sorted on their key columns.
+ *
+ * Both children must be sorted in ascending order of the key columns like Sorter does, with
+ * null keys first. Rows are streamed from both sides, and only the run of right rows sharing
+ * the current key is kept in memory, so no hash table is built. Keys are equal only if all
+ * their values are equal and not null, like SQL. NaN equals no value, and sorts after any
+ * other number.
+ *
+ * The left side plays the probe side of HashJoiner and the right side plays the build side:
+ * inner and left outer joins output the left columns followed by the right columns, and
+ * semi and anti joins output left rows having or not having matches. Output rows are in the
+ * order of left rows, with matches in the order of right rows.
+ */
+class MergeJoiner : public Iterator {
+public:
+    template <typename T, typename... ArgTs>
+    friend std::unique_ptr<Iterator> makeIterator(ArgTs&&...);
+
+    void open() override;
+
+    void reopen() override
+    {
+        open();
+    }
+
+    bool hasNext() const override
+    {
+        return outputPos_ < output_.size();
+    }
+
+    std::optional<std::vector<std::any>> processNext() override;
+
+    std::optional<Batch> processNextBatch(std::size_t maxRows = kDefaultBatchSize) override;
+
+    void close() override
+    {
+        left_->close();
+        right_->close();
+    }
+
+    const Metadata& getMetadata() const override
+    {
+        return outputMetadata_;
+    }
+
+    ~MergeJoiner() override
+    {}
+
+private:
+    /**
+     * @brief Constructs a new MergeJoiner object.
+     *
+     * Throws UnknownName if a key column does not exist, and UnsupportedOperation if the
+     * numbers or the types of the key columns of both sides differ or cannot be ordered.
+     * While rows are output, throws UnsortedInput if an input turns out not to be sorted.
+     *
+     * @param left Child iterator sorted on leftKeyCols.
+     * @param right Child iterator sorted on rightKeyCols.
+     * @param leftKeyCols Key columns of the left side.
+     * @param rightKeyCols Key columns of the right side, in the order of leftKeyCols.
+     * @param joinType Type of the join.
+     */
+    MergeJoiner(
+        std::unique_ptr<Iterator>&& left,
+        std::unique_ptr<Iterator>&& right,
+        const std::vector<std::string>& leftKeyCols,
+        const std::vector<std::string>& rightKeyCols,
+        JoinType joinType = JoinType::Inner);
+
+    /// Constructs a new MergeJoiner object joining on key columns of the same names on both sides.
+    MergeJoiner(
+        std::unique_ptr<Iterator>&& left,
+        std::unique_ptr<Iterator>&& right,
+        const std::vector<std::string>& keyCols,
+        JoinType joinType = JoinType::Inner)
+        : MergeJoiner(std::move(left), std::move(right), keyCols, keyCols, joinType)
+    {}
+
+    static std::vector<std::size_t> findKeyCols(const Metadata&, const std::vector<std::string>&);
+
+    static RowComparator createKeyComparator(const Metadata&, const std::vector<std::size_t>&);
+
+    // Reads key values of row at keyCols into keyVals. Returns false if any of them is null or
+    // NaN, which equals no value.
+    static bool readKey(const std::vector<std::any>& row, const std::vector<std::size_t>& keyCols,
+        std::vector<std::any>& keyVals);
+
+    // Reads the next right row and its key, checking that keys do not decrease.
+    void nextRightRow();
+
+    // Makes rightRun_ the right rows of key, skipping right rows of smaller keys.
+    void advanceRight(const std::vector<std::any>& key);
+
+    // Joins a left row, appending output rows to output_. leftRow may be moved out.
+    void joinRow(std::vector<std::any>& leftRow);
+
+    // Joins left batches until there are output rows or the left input is exhausted.
+    void fillOutput();
+
+    std::unique_ptr<Iterator> left_;
+    std::unique_ptr<Iterator> right_;
+    const JoinType joinType_;
+    const std::vector<std::size_t> leftKeyCols_;
+    const std::vector<std::size_t> rightKeyCols_;
+    const Metadata outputMetadata_;
+    // Compares key values extracted from rows of either side.
+    const RowComparator keyComparator_;
+
+    // Key of the previous left row, to check the order of the left input.
+    std::vector<std::any> prevLeftKey_;
+    bool hasPrevLeftKey_;
+
+    // Next right row not consumed yet and its key.
+    std::optional<Batch> rightBatch_;
+    std::size_t rightPos_;
+    std::vector<std::any> rightRow_;
+    std::vector<std::any> rightKey_;
+    bool hasRightRow_;
+
+    // Right rows of runKey_, which is the key of the last left row looked up.
+    std::vector<std::vector<std::any>> rightRun_;
+    std::vector<std::any> runKey_;
+    bool hasRun_;
+
+    // Buffer of key values of a row.
+    std::vector<std::any> keyVals_;
+
+    // Output rows of the left batch joined last.
+    std::vector<std::vector<std::any>> output_;
+    std::size_t outputPos_;
+};
+
+} // namespace codein
@@ -0,0 +1,414 @@
+/**
+ * Copyright (C) 2021-present Codein Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify it under the terms of
+ * BSD-3-Clause License which can be found at the root directory of this repository.
+ */
+
+#include <algorithm>
+#include <any>
+#include <cassert>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "csv_file_scanner.h"
+#include "parallel_csv_file_scanner.h"
+#include "structural_scanner.h"
+#include "to_any_converter.h"
+#include "value.h"
+
+namespace codein {
+
+/**
+ * @brief Bounded queue of batches between workers and the consumer.
+ */
+class BatchQueue {
+public:
+    BatchQueue(std::size_t capacity, std::size_t numProducers)
+        : mutex_()
+        , notEmpty_()
+        , notFull_()
+        , batches_()
+        , capacity_(std::max<std::size_t>(capacity, 1))
+        , numProducers_(numProducers)
+        , cancelled_(false)
+    {}
+
+    /**
+     * @brief Pushes a batch, waiting while the queue is full.
+     * @return false if the queue is cancelled.
+     */
+    bool push(Batch&& batch)
+    {
+        std::unique_lock lock(mutex_);
+        notFull_.wait(lock, [this]() { return cancelled_ || batches_.size() < capacity_; });
+        if (cancelled_) {
+            return false;
+        }
+
+        batches_.emplace_back(std::move(batch));
+        notEmpty_.notify_one();
+
+        return true;
+    }
+
+    /**
+     * @brief Pops a batch, waiting while the queue is empty.
+     * @return nullopt if the queue is cancelled, or all producers are done and the queue is empty.
+     */
+    std::optional<Batch> pop()
+    {
+        std::unique_lock lock(mutex_);
+        notEmpty_.wait(lock, [this]() { return cancelled_ || !batches_.empty() || numProducers_ == 0; });
+        if (cancelled_ || batches_.empty()) {
+            return std::nullopt;
+        }
+
+        Batch batch = std::move(batches_.front());
+        batches_.pop_front();
+        notFull_.notify_one();
+
+        return batch;
+    }
+
+    // Called by each producer when it pushed all its batches.
+    void finishProducer()
+    {
+        std::lock_guard lock(mutex_);
+        --numProducers_;
+        notEmpty_.notify_all();
+    }
+
+    // Wakes up all waiting producers and consumers. Subsequent pushes and pops fail.
+    void cancel()
+    {
+        std::lock_guard lock(mutex_);
+        cancelled_ = true;
+        notEmpty_.notify_all();
+        notFull_.notify_all();
+    }
+
+private:
+    std::mutex mutex_;
+    std::condition_variable notEmpty_;
+    std::condition_variable notFull_;
+    std::deque<Batch> batches_;
+    const std::size_t capacity_;
+    std::size_t numProducers_;
+    bool cancelled_;
+};
+
+namespace {
+
+// Same threshold as CsvFileScanner, applied to the lines of each range.
+constexpr unsigned int kThreshold = 30;
+
+/**
+ * @brief Splits data into at most n ranges, each of which ends right after a newline
+ * or at the end of data.
+ */
+std::vector<std::string_view> splitRanges(std::string_view data, std::size_t n)
+{
+    std::vector<std::string_view> ranges;
+    std::size_t begin = 0;
+    for (std::size_t i = 1; i <= n && begin < data.size(); ++i) {
+        std::size_t end = std::max(begin, data.size() / n * i);
+        if (i == n) {
+            end = data.size();
+        }
+        else if (end < data.size()) {
+            end = data.find('\n', end);
+            end = end == std::string_view::npos ? data.size() : end + 1;
+        }
+
+        if (end > begin) {
+            ranges.emplace_back(data.substr(begin, end - begin));
+        }
+        begin = end;
+    }
+
+    return ranges;
+}
+
+}
+
+ParallelCsvFileScanner::ParallelCsvFileScanner(
+    const std::string& metadataFileName,
+    const std::string& dataFileName,
+    const Expression& filterExpr,
+    const ParallelCsvScanOptions& options)
+    : ParallelCsvFileScanner(metadataFileName, dataFileName, filterExpr, {}, options)
+{
+    for (size_t i = 0; i < metadata_.size(); ++i) {
+        projections_.emplace_back(OpCode::Ref, metadata_[i].fieldName);
+    }
+    compileProjections();
+}
+
+ParallelCsvFileScanner::ParallelCsvFileScanner(
+    const std::string& metadataFileName,
+    const std::string& dataFileName,
+    const Expression& filterExpr,
+    const std::vector<Expression>& projections,
+    const ParallelCsvScanOptions& options)
+    : metadata_(readMetadataFile(metadataFileName))
+    , filterExpr_(filterExpr)
+    , projections_(projections)
+    , compiledFilter_(filterExpr_.compile(metadata_))
+    , compiledProjections_()
+    , filterColumns_()
+    , projectedColumns_()
+    , options_(options)
+    , mappedFile_()
+    , workers_()
+    , queues_()
+    , queueIdx_(0)
+    , error_()
+    , errorMutex_()
+    , started_(false)
+    , finished_(false)
+    , batch_()
+    , pos_(0)
+{
+    if (!mappedFile_.open(dataFileName)) {
+        throw NonExistentFile();
+    }
+    compileProjections();
+}
+
+void ParallelCsvFileScanner::compileProjections()
+{
+    compiledProjections_ = compile(projections_, metadata_);
+
+    findConvertedColumns(filterExpr_, projections_, metadata_, filterColumns_, projectedColumns_);
+}
+
+void ParallelCsvFileScanner::addFilter(const Expression& expr)
+{
+    assert(!started_);
+    filterExpr_ = conjunction(filterExpr_, expr);
+    compiledFilter_ = filterExpr_.compile(metadata_);
+    compileProjections();
+}
+
+ParallelCsvFileScanner::~ParallelCsvFileScanner()
+{
+    stopWorkers();
+}
+
+void ParallelCsvFileScanner::open()
+{
+    if (!started_ && !finished_) {
+        startWorkers();
+    }
+}
+
+void ParallelCsvFileScanner::reopen()
+{
+    stopWorkers();
+    error_ = nullptr;
+    started_ = false;
+    finished_ = false;
+    batch_.reset();
+    pos_ = 0;
+
+    open();
+}
+
+void ParallelCsvFileScanner::close()
+{
+    stopWorkers();
+    mappedFile_.close();
+    finished_ = true;
+}
+
+void ParallelCsvFileScanner::startWorkers()
+{
+    started_ = true;
+    queueIdx_ = 0;
+
+    std::size_t numThreads = options_.numThreads != 0 ? options_.numThreads : std::thread::hardware_concurrency();
+    auto ranges = splitRanges(mappedFile_.data(), std::max<std::size_t>(numThreads, 1));
+
+    // All queues are created before any worker starts, since a failing worker cancels all of them.
+    if (options_.ordered) {
+        for (std::size_t i = 0; i < ranges.size(); ++i) {
+            queues_.emplace_back(std::make_unique<BatchQueue>(options_.queueCapacity, 1));
+        }
+    }
+    else {
+        queues_.emplace_back(std::make_unique<BatchQueue>(options_.queueCapacity * ranges.size(), ranges.size()));
+    }
+
+    for (std::size_t i = 0; i < ranges.size(); ++i) {
+        auto& queue = *queues_[options_.ordered ? i : 0];
+        workers_.emplace_back([this, range = ranges[i], &queue]() {
+            try {
+                scanRange(range, queue);
+            }
+            catch (...) {
+                {
+                    std::lock_guard lock(errorMutex_);
+                    if (!error_) {
+                        error_ = std::current_exception();
+                    }
+                }
+                for (auto& q: queues_) {
+                    q->cancel();
+                }
+            }
+            queue.finishProducer();
+        });
+    }
+}
+
+void ParallelCsvFileScanner::stopWorkers()
+{
+    for (auto& queue: queues_) {
+        queue->cancel();
+    }
+    for (auto& worker: workers_) {
+        worker.join();
+    }
+
+    workers_.clear();
+    queues_.clear();
+}
+
+void ParallelCsvFileScanner::scanRange(std::string_view data, BatchQueue& queue) const
+{
+    const CompiledExpression filter = compiledFilter_;
+    const std::vector<CompiledExpression> projections = compiledProjections_;
+    const std::size_t numFields = metadata_.size();
+    const std::size_t size = projections.size();
+
+    std::vector<std::string_view> fields;
+    // String values in r are overwritten line after line.
+    std::vector<std::any> r(numFields);
+    std::vector<std::any> output;
+    output.reserve(size);
+    Batch batch(size);
+    unsigned int readLines = 0;
+    unsigned int errorLines = 0;
+
+    std::size_t pos = 0;
+    while (pos < data.size()) {
+        pos += splitFields(data.substr(pos), fields, true) + 1;
+        ++readLines;
+
+        // Only the fields referred to by the filter or projections are converted, and fields
+        // only projections refer to are converted after the line passes the filter.
+        bool valid = fields.size() == numFields && convertFields(metadata_, fields, filterColumns_, r);
+        if (valid) {
+            if (notValue(filter.evalValue(r))) {
+                continue;
+            }
+            valid = convertFields(metadata_, fields, projectedColumns_, r);
+        }
+
+        if (!valid) {
+            ++errorLines;
+            if (readLines > kThreshold && errorLines > readLines / 2) {
+                throw WrongMetadata();
+            }
+            continue;
+        }
+
+        for (std::size_t i = 0; i < size; ++i) {
+            output.emplace_back(projections[i].eval(r));
+        }
+        batch.appendRow(std::move(output));
+        output.clear();
+
+        if (batch.numRows() == options_.batchSize) {
+            if (!queue.push(std::move(batch))) {
+                return;
+            }
+            batch = Batch(size);
+        }
+    }
+
+    if (!batch.empty()) {
+        queue.push(std::move(batch));
+    }
+}
+
+std::optional<Batch> ParallelCsvFileScanner::popBatch()
+{
+    if (finished_) {
+        return std::nullopt;
+    }
+    open();
+
+    for (; queueIdx_ < queues_.size(); ++queueIdx_) {
+        if (auto batch = queues_[queueIdx_]->pop()) {
+            return batch;
+        }
+
+        std::exception_ptr error;
+        {
+            std::lock_guard lock(errorMutex_);
+            error = error_;
+        }
+        if (error) {
+            stopWorkers();
+            finished_ = true;
+            std::rethrow_exception(error);
+        }
+    }
+
+    stopWorkers();
+    finished_ = true;
+
+    return std::nullopt;
+}
+
+std::optional<std::vector<std::any>> ParallelCsvFileScanner::processNext()
+{
+    while (!batch_ || pos_ == batch_->numRows()) {
+        batch_ = popBatch();
+        pos_ = 0;
+        if (!batch_) {
+            return std::nullopt;
+        }
+    }
+
+    return batch_->row(pos_++);
+}
+
+std::optional<Batch> ParallelCsvFileScanner::processNextBatch(std::size_t maxRows)
+{
+    if (!batch_ || pos_ == batch_->numRows()) {
+        batch_ = popBatch();
+        pos_ = 0;
+        if (!batch_) {
+            return std::nullopt;
+        }
+    }
+
+    if (pos_ == 0 && batch_->numRows() <= maxRows) {
+        std::optional<Batch> batch = std::move(batch_);
+        batch_.reset();
+
+        return batch;
+    }
+
+    Batch batch(batch_->numColumns());
+    std::vector<std::any> row;
+    for (; batch.numRows() < maxRows && pos_ < batch_->numRows(); ++pos_) {
+        batch_->readRow(pos_, row);
+        batch.appendRow(std::move(row));
+    }
+
+    return batch;
+}
+
+} // namespace codein
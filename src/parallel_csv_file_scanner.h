@@ -0,0 +1,168 @@
+/**
+ * Copyright (C) 2021-present Codein Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify it under the terms of
+ * BSD-3-Clause License which can be found at the root directory of this repository.
+ */
+
+#include <any>
+#include <cstddef>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "batch.h"
+#include "expression.h"
+#include "iterator.h"
+#include "mapped_file.h"
+#include "metadata.h"
+
+#pragma once
+
+namespace codein {
+
+class BatchQueue;
+
+/**
+ * @brief Options for ParallelCsvFileScanner.
+ */
+struct ParallelCsvScanOptions {
+    // Number of worker threads. 0 means the number of hardware threads.
+    std::size_t numThreads = 0;
+    // If true, rows are returned in the order of the file. Otherwise, rows are returned as soon
+    // as any worker produces them.
+    bool ordered = true;
+    // Maximum number of rows in a batch produced by a worker.
+    std::size_t batchSize = kDefaultBatchSize;
+    // Maximum number of batches buffered per worker before the worker waits for the consumer.
+    std::size_t queueCapacity = 4;
+};
+
+/**
+ * @brief Parallel CSV file scanner iterator. Scans the given CSV-formatted file on multiple threads.
+ *
+ * The data file is mapped into memory and split into byte ranges aligned to line boundaries.
+ * Each range is parsed, filtered and projected by its own worker thread, and the resulting
+ * batches are handed to the consumer through bounded queues. An exception thrown by a worker
+ * stops all workers and is rethrown from processNext() or processNextBatch().
+ */
+class ParallelCsvFileScanner : public Iterator {
+public:
+    template <typename T, typename... ArgTs>
+    friend std::unique_ptr<Iterator> makeIterator(ArgTs&&...);
+    friend class PredicatePushdown;
+
+    /// Starts worker threads if they are not running yet.
+    void open() override;
+
+    void reopen() override;
+
+    bool hasNext() const override
+    {
+        return !finished_;
+    }
+
+    std::optional<std::vector<std::any>> processNext() override;
+
+    std::optional<Batch> processNextBatch(std::size_t maxRows = kDefaultBatchSize) override;
+
+    /// Stops worker threads and unmaps the file.
+    void close() override;
+
+    const Metadata& getMetadata() const override
+    {
+        return metadata_;
+    }
+
+    ~ParallelCsvFileScanner() override;
+
+private:
+    /**
+     * @brief Constructs a new parallel scanner returning every column of each line.
+     *
+     * @param metadataFileName: name of the file that contains metadata about CSV file.
+     * @param dataFileName: name of the CSV file.
+     * @param filterExpr: Expression to filter desired lines. if not specified, passes every line.
+     * @param options: options of scanning.
+     */
+    ParallelCsvFileScanner(const std::string& metadataFileName,
+        const std::string& dataFileName, const Expression& filterExpr = kAlwaysTrue,
+        const ParallelCsvScanOptions& options = {});
+
+    /**
+     * @brief Constructor where arguments must specify values of filterExpr and projections.
+     *
+     * @param metadataFileName: name of the metadata file.
+     * @param dataFileName: name of the CSV file.
+     * @param filterExpr: Expression to filter desired lines.
+     * @param projections: projections to select desired columns or output in a line.
+     * @param options: options of scanning.
+     */
+    ParallelCsvFileScanner(const std::string& metadataFileName,
+        const std::string& dataFileName, const Expression& filterExpr,
+        const std::vector<Expression>& projections, const ParallelCsvScanOptions& options = {});
+
+    // Splits the mapped file into line-aligned ranges and starts a worker for each range.
+    void startWorkers();
+
+    // Cancels the queues and joins worker threads.
+    void stopWorkers();
+
+    /**
+     * @brief Parses, filters and projects lines in data, pushing batches of output into queue.
+     *
+     * @param data: line-aligned range of the mapped file.
+     * @param queue: queue to which the output is pushed.
+     */
+    void scanRange(std::string_view data, BatchQueue& queue) const;
+
+    // Compiles projections_ and finds the columns that filterExpr_ and projections_ refer to.
+    void compileProjections();
+
+    // Filters lines also by expr, which refers to columns of metadata_ like filterExpr_.
+    // Must be called before open(), since workers read the filter and its columns.
+    void addFilter(const Expression& expr);
+
+    // Pops the next batch from the queues. nullopt if all workers are done.
+    std::optional<Batch> popBatch();
+
+    // Metadata about the CSV file.
+    Metadata metadata_;
+    // Expression based on which lines are filtered.
+    Expression filterExpr_;
+    // Projections to get desired columns.
+    std::vector<Expression> projections_;
+    // filterExpr_ and projections_ compiled against metadata_. Workers evaluate their own copies.
+    CompiledExpression compiledFilter_;
+    std::vector<CompiledExpression> compiledProjections_;
+    // Columns that filterExpr_ refers to, and the other columns that projections_ refer to.
+    // The latter are converted only for lines passing the filter, and fields of the other
+    // columns are never converted and left null in rows.
+    std::vector<std::size_t> filterColumns_;
+    std::vector<std::size_t> projectedColumns_;
+    const ParallelCsvScanOptions options_;
+    // Mapping of the CSV file shared by workers.
+    MappedFile mappedFile_;
+
+    std::vector<std::thread> workers_;
+    // One queue per worker if options_.ordered. Otherwise, a single queue shared by workers.
+    std::vector<std::unique_ptr<BatchQueue>> queues_;
+    // Index of the queue the consumer is popping from.
+    std::size_t queueIdx_;
+    // The first exception thrown by a worker.
+    std::exception_ptr error_;
+    std::mutex errorMutex_;
+    bool started_;
+    bool finished_;
+
+    // Batch being handed out and the position of its next row.
+    std::optional<Batch> batch_;
+    std::size_t pos_;
+};
+
+} // namespace codein
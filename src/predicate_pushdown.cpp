@@ -0,0 +1,155 @@
+/**
+ * Copyright (C) 2021-present Codein Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify it under the terms of
+ * BSD-3-Clause License which can be found at the root directory of this repository.
+ */
+
+#include <any>
+#include <memory>
+#include <optional>
+#include <string>
+#include <variant>
+#include <vector>
+
+#include "columnar_file_scanner.h"
+#include "csv_file_scanner.h"
+#include "filter.h"
+#include "parallel_csv_file_scanner.h"
+#include "predicate_pushdown.h"
+#include "projector.h"
+#include "sequencer.h"
+
+namespace codein {
+
+std::unique_ptr<Iterator> PredicatePushdown::apply(std::unique_ptr<Iterator>&& plan)
+{
+    auto root = std::move(plan);
+    visit(root);
+
+    return root;
+}
+
+void PredicatePushdown::visit(std::unique_ptr<Iterator>& node)
+{
+    if (auto filter = dynamic_cast<Filter*>(node.get()); filter != nullptr) {
+        // Filters below are pushed down first, so that this one can follow them.
+        visit(filter->child_);
+        if (pushInto(filter->expr_, filter->child_)) {
+            auto child = std::move(filter->child_);
+            node = std::move(child);
+        }
+    }
+    else if (auto projector = dynamic_cast<Projector*>(node.get()); projector != nullptr) {
+        visit(projector->child_);
+    }
+    else if (auto sequencer = dynamic_cast<Sequencer*>(node.get()); sequencer != nullptr) {
+        for (auto& child: sequencer->children_) {
+            visit(child);
+        }
+    }
+}
+
+bool PredicatePushdown::pushInto(const Expression& expr, std::unique_ptr<Iterator>& node)
+{
+    if (auto filter = dynamic_cast<Filter*>(node.get()); filter != nullptr) {
+        return pushInto(expr, filter->child_);
+    }
+
+    if (auto projector = dynamic_cast<Projector*>(node.get()); projector != nullptr) {
+        auto rewritten = substitute(expr, projector->outputMetadata_, projector->projections_);
+        if (!rewritten) {
+            return false;
+        }
+
+        // Projections are evaluated only on rows passing the filter even if it stops here.
+        if (!pushInto(*rewritten, projector->child_)) {
+            projector->child_ = makeIterator<Filter>(std::move(projector->child_), *rewritten);
+        }
+        return true;
+    }
+
+    if (auto sequencer = dynamic_cast<Sequencer*>(node.get()); sequencer != nullptr) {
+        for (auto& child: sequencer->children_) {
+            if (!pushInto(expr, child)) {
+                child = makeIterator<Filter>(std::move(child), expr);
+            }
+        }
+        return true;
+    }
+
+    // Rows that the filters of scanners see are not projected yet.
+    if (auto scanner = dynamic_cast<CsvFileScanner*>(node.get()); scanner != nullptr) {
+        auto rewritten = substitute(expr, scanner->metadata_, scanner->projections_);
+        if (!rewritten) {
+            return false;
+        }
+
+        scanner->addFilter(*rewritten);
+        return true;
+    }
+
+    if (auto scanner = dynamic_cast<ParallelCsvFileScanner*>(node.get()); scanner != nullptr) {
+        auto rewritten = substitute(expr, scanner->metadata_, scanner->projections_);
+        if (!rewritten || scanner->started_) {
+            return false;
+        }
+
+        scanner->addFilter(*rewritten);
+        return true;
+    }
+
+    if (auto scanner = dynamic_cast<ColumnarFileScanner*>(node.get()); scanner != nullptr) {
+        std::vector<Expression> projections;
+        for (std::size_t i = 0; i < scanner->metadata_.size(); ++i) {
+            projections.push_back(
+                Expression{.opCode = OpCode::Ref, .leafOrChildren = std::any(scanner->metadata_[i].fieldName)});
+        }
+
+        auto rewritten = substitute(expr, scanner->metadata_, projections);
+        if (!rewritten) {
+            return false;
+        }
+
+        scanner->addFilter(*rewritten);
+        return true;
+    }
+
+    return false;
+}
+
+std::optional<Expression> PredicatePushdown::substitute(
+    const Expression& expr, const Metadata& metadata, const std::vector<Expression>& projections)
+{
+    if (std::holds_alternative<std::vector<Expression>>(expr.leafOrChildren)) {
+        Expression rewritten{.opCode = expr.opCode, .leafOrChildren = std::vector<Expression>()};
+        for (const auto& child: expr.children()) {
+            auto rewrittenChild = substitute(child, metadata, projections);
+            if (!rewrittenChild) {
+                return std::nullopt;
+            }
+            rewritten.children().push_back(std::move(*rewrittenChild));
+        }
+
+        return rewritten;
+    }
+
+    if (expr.opCode != OpCode::Ref) {
+        return expr;
+    }
+
+    // A reference that fails to resolve is left to the filter, which throws on evaluation.
+    const auto name = std::any_cast<std::string>(&expr.leaf());
+    if (name == nullptr) {
+        return std::nullopt;
+    }
+
+    const auto [found, col] = metadata.find(*name);
+    if (!found || col >= projections.size()) {
+        return std::nullopt;
+    }
+
+    return projections[col];
+}
+
+} // namespace codein
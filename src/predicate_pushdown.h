@@ -0,0 +1,60 @@
+/**
+ * Copyright (C) 2021-present Codein Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify it under the terms of
+ * BSD-3-Clause License which can be found at the root directory of this repository.
+ */
+
+#include <memory>
+#include <optional>
+#include <vector>
+
+#include "expression.h"
+#include "iterator.h"
+#include "metadata.h"
+
+#pragma once
+
+namespace codein {
+
+/**
+ * @brief Plan rewriting pass pushing Filter iterators down the iterator tree.
+ *
+ * A Filter is moved below Projector, with its column references replaced by the projection
+ * expressions, and copied into each child of Sequencer. It is merged into the filter of
+ * CsvFileScanner, ParallelCsvFileScanner and ColumnarFileScanner, which then filter rows
+ * while scanning and convert or decode only the columns they need. A Filter that cannot be
+ * pushed further stays where it stopped. Subtrees below other iterators are left as they are.
+ */
+class PredicatePushdown {
+public:
+    /**
+     * @brief Rewrites plan, which must not be opened yet, pushing down its filters.
+     *
+     * @return the rewritten plan returning the same rows as plan.
+     */
+    static std::unique_ptr<Iterator> apply(std::unique_ptr<Iterator>&& plan);
+
+private:
+    // Pushes down the filters in the subtree of node, replacing node if it is a Filter merged
+    // into its child.
+    static void visit(std::unique_ptr<Iterator>& node);
+
+    /**
+     * @brief Pushes expr filtering the output of node into node.
+     *
+     * @return true if node filters its output by expr from now on.
+     */
+    static bool pushInto(const Expression& expr, std::unique_ptr<Iterator>& node);
+
+    /**
+     * @brief Rewrites expr over rows described by metadata, each column of which is the value of
+     * the projection at its position, into an expression over the input of the projections.
+     *
+     * @return nullopt if expr refers to a column without a projection.
+     */
+    static std::optional<Expression> substitute(
+        const Expression& expr, const Metadata& metadata, const std::vector<Expression>& projections);
+};
+
+} // namespace codein
@@ -20,8 +20,14 @@ Projector::Projector(std::unique_ptr<Iterator>&& child, const std::vector<Expres
     : child_(std::move(child))
     , inputMetadata_(child_->getMetadata())
     , projections_(projections)
+    , compiledProjections_(compile(projections_, inputMetadata_))
+    , kernels_()
     , outputMetadata_(std::move(metadata))
-{}
+{
+    for (const auto& proj: projections_) {
+        kernels_.emplace_back(makeColumnKernel(proj, inputMetadata_));
+    }
+}
 
 std::optional<std::vector<std::any>> Projector::processNext()
 {
@@ -38,10 +44,46 @@ std::optional<std::vector<std::any>> Projector::processNext()
     std::vector<std::any> output;
     output.reserve(outputMetadata_.size());
     for (size_t i = 0; i < outputMetadata_.size(); ++i) {
-        output.emplace_back(std::move(projections_[i].eval(inputMetadata_, inputValue)));
+        output.emplace_back(std::move(compiledProjections_[i].eval(inputValue)));
     }
 
     return { output };
 }
 
+std::optional<Batch> Projector::processNextBatch(std::size_t maxRows)
+{
+    if (!child_->hasNext()) {
+        return std::nullopt;
+    }
+
+    auto input = child_->processNextBatch(maxRows);
+    if (!input.has_value()) {
+        return std::nullopt;
+    }
+
+    const size_t numRows = input->numRows();
+    std::vector<Column> columns(outputMetadata_.size());
+
+    // Projections without kernels, or whose kernels don't apply to the batch, are evaluated row by row.
+    std::vector<size_t> rowProjs;
+    for (size_t i = 0; i < outputMetadata_.size(); ++i) {
+        if (!kernels_[i] || !kernels_[i]->eval(*input, columns[i])) {
+            columns[i] = Column();
+            rowProjs.push_back(i);
+        }
+    }
+
+    if (!rowProjs.empty()) {
+        std::vector<std::any> inputValue;
+        for (size_t r = 0; r < numRows; ++r) {
+            input->readRow(r, inputValue);
+            for (auto i: rowProjs) {
+                columns[i].append(compiledProjections_[i].eval(inputValue));
+            }
+        }
+    }
+
+    return Batch(std::move(columns), numRows);
+}
+
 } // namespace codein;
@@ -13,6 +13,7 @@
 
 #include "expression.h"
 #include "iterator.h"
+#include "typed_kernel.h"
 
 #pragma once
 
@@ -25,6 +26,7 @@ class Projector : public Iterator {
 public:
     template <typename T, typename... ArgTs>
     friend std::unique_ptr<Iterator> makeIterator(ArgTs&&...);
+    friend class PredicatePushdown;
 
     /// Just open the child.
     void open() override
@@ -49,6 +51,13 @@ public:
      */
     std::optional<std::vector<std::any>> processNext() override;
 
+    /**
+     * @brief Projects a batch of the child at once.
+     * 
+     * @return std::optional<Batch> 
+     */
+    std::optional<Batch> processNextBatch(std::size_t maxRows = kDefaultBatchSize) override;
+
     void close() override
     {
         child_->close();
@@ -73,8 +82,11 @@ private:
     Projector(std::unique_ptr<Iterator>&& child, const std::vector<Expression>& projections, Metadata metadata);
 
     std::unique_ptr<Iterator> child_;
-    const Metadata& inputMetadata_;
+    const Metadata inputMetadata_;
     std::vector<Expression> projections_;
+    std::vector<CompiledExpression> compiledProjections_;
+    // Typed kernels of projections for the batch path. nullptr for projections without kernels.
+    std::vector<std::unique_ptr<ColumnKernel>> kernels_;
     Metadata outputMetadata_;
 };
 
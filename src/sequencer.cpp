@@ -48,4 +48,24 @@ std::optional<std::vector<std::any>> Sequencer::processNext()
     return output;
 }
 
+std::optional<Batch> Sequencer::processNextBatch(std::size_t maxRows)
+{
+    if (!hasNext()) {
+        return std::nullopt;
+    }
+
+    auto output = children_[indexOfCurChild]->processNextBatch(maxRows);
+    while (!output.has_value()) {
+        ++indexOfCurChild;
+        if (indexOfCurChild == children_.size()) {
+            return std::nullopt;
+        }
+
+        children_[indexOfCurChild]->open();
+        output = children_[indexOfCurChild]->processNextBatch(maxRows);
+    }
+
+    return output;
+}
+
 }// namespace codein
@@ -22,6 +22,7 @@ class Sequencer : public Iterator {
 public:
     template <typename T, typename... ArgTs>
     friend std::unique_ptr<Iterator> makeIterator(ArgTs&&...);
+    friend class PredicatePushdown;
 
     void open()
     {
@@ -39,7 +40,9 @@ public:
         return indexOfCurChild < children_.size();
     }
 
-    std::optional<std::vector<std::any>> processNext() override; 
+    std::optional<std::vector<std::any>> processNext() override;
+
+    std::optional<Batch> processNextBatch(std::size_t maxRows = kDefaultBatchSize) override;
 
     void close() override
     {
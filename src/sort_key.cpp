@@ -0,0 +1,91 @@
+/**
+ * Copyright (C) 2021-present Codein Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify it under the terms of
+ * BSD-3-Clause License which can be found at the root directory of this repository.
+ */
+
+#include <any>
+#include <cmath>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "any_visitor.h"
+#include "sort_key.h"
+#include "to_any_converter.h"
+
+namespace codein {
+
+namespace {
+
+template <typename T>
+int compareValues(const std::any& lhs, const std::any& rhs)
+{
+    const auto l = std::any_cast<T>(&lhs);
+    const auto r = std::any_cast<T>(&rhs);
+    if (l == nullptr || r == nullptr) {
+        if (l == nullptr && r == nullptr && (lhs.has_value() || rhs.has_value())) {
+            throw UnsupportedOperation();
+        }
+        return (l != nullptr) - (r != nullptr);
+    }
+
+    // NaN is greater than any other number and equal to NaN, so that the order stays total.
+    if constexpr (std::is_floating_point_v<T>) {
+        if (std::isnan(*l) || std::isnan(*r)) {
+            return std::isnan(*l) - std::isnan(*r);
+        }
+    }
+
+    return (*r < *l) - (*l < *r);
+}
+
+}
+
+RowComparator::RowComparator(const std::vector<SortKey>& keys, const Metadata& metadata)
+    : keys_()
+{
+    for (const auto& key: keys) {
+        const auto col = metadata[key.column];
+        const auto ti = metadata[col].typeIndex;
+
+        CompareFn compare;
+        if (ti == tiBool) {
+            compare = compareValues<bool>;
+        }
+        else if (ti == tiInt) {
+            compare = compareValues<int>;
+        }
+        else if (ti == tiUint) {
+            compare = compareValues<unsigned int>;
+        }
+        else if (ti == tiFloat) {
+            compare = compareValues<float>;
+        }
+        else if (ti == tiDouble) {
+            compare = compareValues<double>;
+        }
+        else if (ti == tiString) {
+            compare = compareValues<std::string>;
+        }
+        else {
+            throw UnsupportedOperation();
+        }
+
+        keys_.push_back(Key{col, key.descending, compare});
+    }
+}
+
+int RowComparator::compare(const std::vector<std::any>& lhs, const std::vector<std::any>& rhs) const
+{
+    for (const auto& key: keys_) {
+        if (const int c = key.compare(lhs[key.col], rhs[key.col]); c != 0) {
+            return key.descending ? -c : c;
+        }
+    }
+
+    return 0;
+}
+
+} // namespace codein
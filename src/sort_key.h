@@ -0,0 +1,64 @@
+/**
+ * Copyright (C) 2021-present Codein Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify it under the terms of
+ * BSD-3-Clause License which can be found at the root directory of this repository.
+ */
+
+#include <any>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "metadata.h"
+
+#pragma once
+
+namespace codein {
+
+/**
+ * @brief A column to order rows by.
+ */
+struct SortKey {
+    std::string column;
+    bool descending = false;
+};
+
+/**
+ * @brief Compares rows by sort keys.
+ *
+ * Values are compared in their native type resolved once from the metadata. Nulls are less
+ * than any other value, so they come first in ascending order and last in descending order.
+ * Floating point NaN is greater than any other number and equal to NaN.
+ */
+class RowComparator {
+public:
+    /**
+     * @brief Constructs a comparator of rows described by metadata.
+     *
+     * Throws UnknownName if a key column does not exist, and UnsupportedOperation if its type
+     * cannot be ordered.
+     */
+    RowComparator(const std::vector<SortKey>& keys, const Metadata& metadata);
+
+    /// Returns a negative value if lhs comes before rhs, a positive value if after, and 0 if tied.
+    int compare(const std::vector<std::any>& lhs, const std::vector<std::any>& rhs) const;
+
+    bool operator()(const std::vector<std::any>& lhs, const std::vector<std::any>& rhs) const
+    {
+        return compare(lhs, rhs) < 0;
+    }
+
+private:
+    using CompareFn = int (*)(const std::any&, const std::any&);
+
+    struct Key {
+        std::size_t col;
+        bool descending;
+        CompareFn compare;
+    };
+
+    std::vector<Key> keys_;
+};
+
+} // namespace codein
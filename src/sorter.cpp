@@ -0,0 +1,207 @@
+/**
+ * Copyright (C) 2021-present Codein Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify it under the terms of
+ * BSD-3-Clause License which can be found at the root directory of this repository.
+ */
+
+#include <algorithm>
+#include <any>
+#include <memory>
+#include <optional>
+#include <vector>
+
+#include "sorter.h"
+
+namespace codein {
+
+Sorter::Sorter(std::unique_ptr<Iterator>&& child, const std::vector<SortKey>& keys, const SorterOptions& options)
+    : child_(std::move(child))
+    , options_(options)
+    , comparator_(keys, child_->getMetadata())
+    , rows_()
+    , pos_(0)
+    , memoryUsage_(0)
+    , runs_()
+    , heap_()
+{}
+
+void Sorter::open()
+{
+    child_->open();
+
+    rows_.clear();
+    pos_ = 0;
+    memoryUsage_ = 0;
+    runs_.clear();
+    heap_.clear();
+
+    while (child_->hasNext()) {
+        auto batch = child_->processNextBatch();
+        if (!batch) {
+            break;
+        }
+
+        for (size_t i = 0; i < batch->numRows(); ++i) {
+            rows_.push_back(batch->row(i));
+            memoryUsage_ += rowMemoryUsage(rows_.back());
+
+            if (options_.memoryBudget != 0 && memoryUsage_ > options_.memoryBudget) {
+                spillRun();
+            }
+        }
+    }
+
+    if (runs_.empty()) {
+        std::stable_sort(rows_.begin(), rows_.end(), [this](const auto& lhs, const auto& rhs) {
+            return comparator_(lhs, rhs);
+        });
+        return;
+    }
+
+    // The remaining rows are spilled as the last run as well, so that the memory is released
+    // before merging.
+    if (!rows_.empty()) {
+        spillRun();
+    }
+    startMerge();
+}
+
+void Sorter::spillRun()
+{
+    std::stable_sort(rows_.begin(), rows_.end(), [this](const auto& lhs, const auto& rhs) {
+        return comparator_(lhs, rhs);
+    });
+
+    auto file = std::make_unique<SpillFile>(options_.spillDirectory);
+    for (const auto& row: rows_) {
+        file->write(row);
+    }
+    // Rewinding frees the buffer of the run until it is merged.
+    file->rewind();
+    runs_.push_back(Run{std::move(file), {}});
+
+    rows_.clear();
+    rows_.shrink_to_fit();
+    memoryUsage_ = 0;
+}
+
+void Sorter::startMerge()
+{
+    const auto fanIn = std::max<std::size_t>(options_.maxMergeFanIn, 2);
+
+    // Merging adjacent runs keeps rows of earlier runs before tied rows of later runs.
+    while (runs_.size() > fanIn) {
+        std::vector<Run> merged;
+        for (std::size_t begin = 0; begin < runs_.size(); begin += fanIn) {
+            merged.push_back(Run{mergeRuns(begin, std::min(begin + fanIn, runs_.size())), {}});
+        }
+        runs_ = std::move(merged);
+    }
+
+    initHeap(0, runs_.size());
+}
+
+std::unique_ptr<SpillFile> Sorter::mergeRuns(std::size_t begin, std::size_t end)
+{
+    initHeap(begin, end);
+
+    auto file = std::make_unique<SpillFile>(options_.spillDirectory);
+    std::vector<std::any> row;
+    while (!heap_.empty()) {
+        popMerged(row);
+        file->write(row);
+    }
+    file->rewind();
+
+    return file;
+}
+
+void Sorter::initHeap(std::size_t begin, std::size_t end)
+{
+    heap_.clear();
+    for (std::size_t i = begin; i < end; ++i) {
+        auto& run = runs_[i];
+        if (run.file->read(run.row)) {
+            heap_.push_back(i);
+        }
+        else {
+            run.file.reset();
+        }
+    }
+
+    std::make_heap(heap_.begin(), heap_.end(), [this](auto lhs, auto rhs) { return runAfter(lhs, rhs); });
+}
+
+bool Sorter::runAfter(std::size_t lhs, std::size_t rhs) const
+{
+    const int c = comparator_.compare(runs_[lhs].row, runs_[rhs].row);
+
+    return c != 0 ? c > 0 : lhs > rhs;
+}
+
+void Sorter::popMerged(std::vector<std::any>& out)
+{
+    auto after = [this](auto lhs, auto rhs) { return runAfter(lhs, rhs); };
+
+    std::pop_heap(heap_.begin(), heap_.end(), after);
+    auto& run = runs_[heap_.back()];
+    out = std::move(run.row);
+
+    if (run.file->read(run.row)) {
+        std::push_heap(heap_.begin(), heap_.end(), after);
+    }
+    else {
+        run.file.reset();
+        heap_.pop_back();
+    }
+}
+
+std::optional<std::vector<std::any>> Sorter::processNext()
+{
+    if (!hasNext()) {
+        return std::nullopt;
+    }
+
+    std::vector<std::any> row;
+    if (runs_.empty()) {
+        row = std::move(rows_[pos_++]);
+        if (pos_ == rows_.size()) {
+            rows_.clear();
+            pos_ = 0;
+        }
+    }
+    else {
+        popMerged(row);
+    }
+
+    return row;
+}
+
+std::optional<Batch> Sorter::processNextBatch(std::size_t maxRows)
+{
+    if (!hasNext()) {
+        return std::nullopt;
+    }
+
+    Batch batch(getMetadata().size());
+    std::vector<std::any> row;
+    while (batch.numRows() < maxRows && hasNext()) {
+        if (runs_.empty()) {
+            batch.appendRow(std::move(rows_[pos_++]));
+        }
+        else {
+            popMerged(row);
+            batch.appendRow(std::move(row));
+        }
+    }
+
+    if (runs_.empty() && pos_ == rows_.size()) {
+        rows_.clear();
+        pos_ = 0;
+    }
+
+    return batch;
+}
+
+} // namespace codein
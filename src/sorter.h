@@ -0,0 +1,127 @@
+/**
+ * Copyright (C) 2021-present Codein Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify it under the terms of
+ * BSD-3-Clause License which can be found at the root directory of this repository.
+ */
+
+#include <any>
+#include <cstddef>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "iterator.h"
+#include "sort_key.h"
+#include "spill_file.h"
+
+#pragma once
+
+namespace codein {
+
+/**
+ * @brief Options for Sorter.
+ */
+struct SorterOptions {
+    // Bytes of memory the buffered rows may use. 0 means no limit. When the rows grow beyond
+    // the budget, they are sorted and written to a spill file as a sorted run.
+    std::size_t memoryBudget = 0;
+    // Maximum number of runs merged at once. More runs are merged into longer runs first.
+    std::size_t maxMergeFanIn = 64;
+    // Directory where spill files are created. The system temporary directory if empty.
+    std::string spillDirectory;
+};
+
+/**
+ * @brief Sort iterator ordering the rows of its child by sort keys.
+ *
+ * open() consumes the whole input. If it fits in the memory budget, it is sorted in memory.
+ * Otherwise each budget's worth of rows is sorted and spilled as a run, and the runs are
+ * k-way merged while rows are output. The sort is stable: rows with equal keys come out in
+ * input order.
+ */
+class Sorter : public Iterator {
+public:
+    template <typename T, typename... ArgTs>
+    friend std::unique_ptr<Iterator> makeIterator(ArgTs&&...);
+
+    void open() override;
+
+    void reopen() override
+    {
+        open();
+    }
+
+    bool hasNext() const override
+    {
+        return runs_.empty() ? pos_ < rows_.size() : !heap_.empty();
+    }
+
+    std::optional<std::vector<std::any>> processNext() override;
+
+    std::optional<Batch> processNextBatch(std::size_t maxRows = kDefaultBatchSize) override;
+
+    void close() override
+    {
+        child_->close();
+    }
+
+    const Metadata& getMetadata() const override
+    {
+        return child_->getMetadata();
+    }
+
+    ~Sorter() override
+    {}
+
+private:
+    /**
+     * @brief Constructs a new Sorter object.
+     *
+     * @param child A child iterator.
+     * @param keys Sort keys in order of precedence.
+     * @param options Options of sorting.
+     */
+    Sorter(std::unique_ptr<Iterator>&& child, const std::vector<SortKey>& keys, const SorterOptions& options = {});
+
+    // A sorted run being merged, and its current row.
+    struct Run {
+        std::unique_ptr<SpillFile> file;
+        std::vector<std::any> row;
+    };
+
+    // Sorts the buffered rows and spills them as a run.
+    void spillRun();
+
+    // Merges runs into fewer runs until they can be merged at once, and starts merging them.
+    void startMerge();
+
+    // Reads the first row of runs_[begin, end) and builds the heap of them.
+    void initHeap(std::size_t begin, std::size_t end);
+
+    // Merges runs_[begin, end) into a new run.
+    std::unique_ptr<SpillFile> mergeRuns(std::size_t begin, std::size_t end);
+
+    // Whether the current row of run lhs comes after the one of run rhs. Ties are broken by
+    // the order of runs to keep the sort stable.
+    bool runAfter(std::size_t lhs, std::size_t rhs) const;
+
+    // Moves the next row of the merge into out.
+    void popMerged(std::vector<std::any>& out);
+
+    std::unique_ptr<Iterator> child_;
+    const SorterOptions options_;
+    const RowComparator comparator_;
+
+    // Buffered rows, and the position of the next row to output when sorted in memory.
+    std::vector<std::vector<std::any>> rows_;
+    std::size_t pos_;
+    std::size_t memoryUsage_;
+
+    // Spilled runs, and the heap of indexes of runs having rows while merging.
+    std::vector<Run> runs_;
+    std::vector<std::size_t> heap_;
+};
+
+} // namespace codein
@@ -0,0 +1,314 @@
+/**
+ * Copyright (C) 2021-present Codein Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify it under the terms of
+ * BSD-3-Clause License which can be found at the root directory of this repository.
+ */
+
+#include <algorithm>
+#include <any>
+#include <cerrno>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <unistd.h>
+#include <utility>
+#include <vector>
+
+#include "any_visitor.h"
+#include "spill_file.h"
+
+namespace codein {
+
+namespace {
+
+// Size of the I/O buffer of a spill file.
+constexpr std::size_t kBufferSize = 64 * 1024;
+
+// Types of values as written to spill files.
+enum class SpillType : std::uint8_t {
+    Empty,
+    Bool,
+    Int,
+    Uint,
+    Float,
+    Double,
+    String,
+};
+
+}
+
+SpillFile::SpillFile(const std::string& directory)
+    : fd_(-1)
+    , numRows_(0)
+    , buffer_()
+    , begin_(0)
+    , end_(0)
+    , writing_(false)
+{
+    std::string path = directory.empty() ? std::filesystem::temp_directory_path().string() : directory;
+    path += "/falcon_spill_XXXXXX";
+
+    fd_ = mkstemp(path.data());
+    if (fd_ < 0) {
+        throw SpillFailure();
+    }
+    unlink(path.c_str());
+}
+
+SpillFile::~SpillFile()
+{
+    close(fd_);
+}
+
+std::size_t SpillFile::memoryUsage() const
+{
+    return buffer_ ? kBufferSize : 0;
+}
+
+void SpillFile::writeBytes(const void* data, std::size_t size)
+{
+    if (!buffer_) {
+        buffer_ = std::make_unique_for_overwrite<char[]>(kBufferSize);
+    }
+    writing_ = true;
+
+    auto bytes = static_cast<const char*>(data);
+    while (size > 0) {
+        if (end_ == kBufferSize) {
+            flush();
+        }
+
+        const auto n = std::min(size, kBufferSize - end_);
+        std::memcpy(buffer_.get() + end_, bytes, n);
+        end_ += n;
+        bytes += n;
+        size -= n;
+    }
+}
+
+void SpillFile::readBytes(void* data, std::size_t size)
+{
+    auto bytes = static_cast<char*>(data);
+    while (size > 0) {
+        if (begin_ == end_ && !fill()) {
+            throw SpillFailure();
+        }
+
+        const auto n = std::min(size, end_ - begin_);
+        std::memcpy(bytes, buffer_.get() + begin_, n);
+        begin_ += n;
+        bytes += n;
+        size -= n;
+    }
+}
+
+void SpillFile::flush()
+{
+    while (begin_ < end_) {
+        const auto n = ::write(fd_, buffer_.get() + begin_, end_ - begin_);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            throw SpillFailure();
+        }
+        begin_ += n;
+    }
+
+    begin_ = 0;
+    end_ = 0;
+}
+
+bool SpillFile::fill()
+{
+    if (!buffer_) {
+        buffer_ = std::make_unique_for_overwrite<char[]>(kBufferSize);
+    }
+
+    ssize_t n;
+    do {
+        n = ::read(fd_, buffer_.get(), kBufferSize);
+    } while (n < 0 && errno == EINTR);
+    if (n < 0) {
+        throw SpillFailure();
+    }
+
+    begin_ = 0;
+    end_ = n;
+
+    return n > 0;
+}
+
+void SpillFile::releaseBuffer()
+{
+    buffer_.reset();
+    begin_ = 0;
+    end_ = 0;
+}
+
+void SpillFile::write(const std::vector<std::any>& row)
+{
+    const auto numValues = static_cast<std::uint32_t>(row.size());
+    writeBytes(&numValues, sizeof(numValues));
+
+    for (const auto& value: row) {
+        SpillType type;
+        if (!value.has_value()) {
+            type = SpillType::Empty;
+            writeBytes(&type, sizeof(type));
+        }
+        else if (const auto p = std::any_cast<bool>(&value); p != nullptr) {
+            type = SpillType::Bool;
+            writeBytes(&type, sizeof(type));
+            writeBytes(p, sizeof(*p));
+        }
+        else if (const auto p = std::any_cast<int>(&value); p != nullptr) {
+            type = SpillType::Int;
+            writeBytes(&type, sizeof(type));
+            writeBytes(p, sizeof(*p));
+        }
+        else if (const auto p = std::any_cast<unsigned int>(&value); p != nullptr) {
+            type = SpillType::Uint;
+            writeBytes(&type, sizeof(type));
+            writeBytes(p, sizeof(*p));
+        }
+        else if (const auto p = std::any_cast<float>(&value); p != nullptr) {
+            type = SpillType::Float;
+            writeBytes(&type, sizeof(type));
+            writeBytes(p, sizeof(*p));
+        }
+        else if (const auto p = std::any_cast<double>(&value); p != nullptr) {
+            type = SpillType::Double;
+            writeBytes(&type, sizeof(type));
+            writeBytes(p, sizeof(*p));
+        }
+        else if (const auto p = std::any_cast<std::string>(&value); p != nullptr) {
+            type = SpillType::String;
+            const auto size = static_cast<std::uint64_t>(p->size());
+            writeBytes(&type, sizeof(type));
+            writeBytes(&size, sizeof(size));
+            writeBytes(p->data(), p->size());
+        }
+        else {
+            throw UnsupportedOperation();
+        }
+    }
+
+    ++numRows_;
+}
+
+void SpillFile::rewind()
+{
+    if (writing_) {
+        flush();
+        writing_ = false;
+    }
+    releaseBuffer();
+
+    if (lseek(fd_, 0, SEEK_SET) != 0) {
+        throw SpillFailure();
+    }
+}
+
+bool SpillFile::read(std::vector<std::any>& row)
+{
+    if (begin_ == end_ && !fill()) {
+        releaseBuffer();
+        return false;
+    }
+
+    std::uint32_t numValues;
+    readBytes(&numValues, sizeof(numValues));
+
+    row.clear();
+    row.reserve(numValues);
+    for (std::uint32_t i = 0; i < numValues; ++i) {
+        SpillType type;
+        readBytes(&type, sizeof(type));
+
+        switch (type) {
+        case SpillType::Empty:
+            row.emplace_back();
+            break;
+
+        case SpillType::Bool: {
+            bool v;
+            readBytes(&v, sizeof(v));
+            row.emplace_back(v);
+            break;
+        }
+
+        case SpillType::Int: {
+            int v;
+            readBytes(&v, sizeof(v));
+            row.emplace_back(v);
+            break;
+        }
+
+        case SpillType::Uint: {
+            unsigned int v;
+            readBytes(&v, sizeof(v));
+            row.emplace_back(v);
+            break;
+        }
+
+        case SpillType::Float: {
+            float v;
+            readBytes(&v, sizeof(v));
+            row.emplace_back(v);
+            break;
+        }
+
+        case SpillType::Double: {
+            double v;
+            readBytes(&v, sizeof(v));
+            row.emplace_back(v);
+            break;
+        }
+
+        case SpillType::String: {
+            std::uint64_t size;
+            readBytes(&size, sizeof(size));
+            std::string v(size, '\0');
+            readBytes(v.data(), size);
+            row.emplace_back(std::move(v));
+            break;
+        }
+
+        default:
+            throw SpillFailure();
+        }
+    }
+
+    return true;
+}
+
+std::size_t partitionOf(std::uint64_t hash, std::size_t seed, std::size_t numPartitions)
+{
+    std::uint64_t h = hash ^ ((seed + 1) * 0x9e3779b97f4a7c15ull);
+    h ^= h >> 30;
+    h *= 0xbf58476d1ce4e5b9ull;
+    h ^= h >> 27;
+    h *= 0x94d049bb133111ebull;
+    h ^= h >> 31;
+
+    return h % numPartitions;
+}
+
+std::size_t rowMemoryUsage(const std::vector<std::any>& row)
+{
+    std::size_t bytes = sizeof(row) + row.capacity() * sizeof(std::any);
+    for (const auto& value: row) {
+        if (const auto s = std::any_cast<std::string>(&value); s != nullptr) {
+            bytes += sizeof(std::string) + s->capacity();
+        }
+    }
+
+    return bytes;
+}
+
+} // namespace codein
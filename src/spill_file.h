@@ -0,0 +1,107 @@
+/**
+ * Copyright (C) 2021-present Codein Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify it under the terms of
+ * BSD-3-Clause License which can be found at the root directory of this repository.
+ */
+
+#include <any>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#pragma once
+
+namespace codein {
+
+/**
+ * @brief Exception thrown when a spill file cannot be created, written or read.
+ */
+class SpillFailure {};
+
+/**
+ * @brief Temporary file of rows spilled to disk by operators exceeding their memory budget.
+ *
+ * Rows are written one after another in a binary format and read back in the same order
+ * after rewind(). Each value is stored with its type, so rows can hold bool, int, uint, float,
+ * double, string and empty values regardless of metadata. The file is unlinked as soon as it
+ * is created, so it disappears when it is closed or the process exits.
+ *
+ * The I/O buffer is allocated only while the file is written or read. It is freed by rewind()
+ * and when the last row has been read, so that files waiting to be read take no memory.
+ */
+class SpillFile {
+public:
+    /**
+     * @brief Creates an empty spill file.
+     *
+     * @param directory: directory where the file is created. The system temporary directory if empty.
+     */
+    explicit SpillFile(const std::string& directory = "");
+
+    SpillFile(const SpillFile&) = delete;
+    SpillFile& operator=(const SpillFile&) = delete;
+
+    ~SpillFile();
+
+    /**
+     * @brief Appends row to the file. Throws UnsupportedOperation if a value has another type.
+     */
+    void write(const std::vector<std::any>& row);
+
+    /// Flushes written rows, frees the buffer and moves to the first row for reading.
+    void rewind();
+
+    /**
+     * @brief Reads the next row.
+     *
+     * @param row: receives the values of the row.
+     * @return false if there are no more rows.
+     */
+    bool read(std::vector<std::any>& row);
+
+    /// Number of rows written.
+    std::size_t numRows() const
+    {
+        return numRows_;
+    }
+
+    /// Bytes of memory taken by the buffer. 0 unless the file is being written or read.
+    std::size_t memoryUsage() const;
+
+private:
+    void writeBytes(const void* data, std::size_t size);
+
+    void readBytes(void* data, std::size_t size);
+
+    // Writes the buffered bytes to the file.
+    void flush();
+
+    // Reads the next bytes of the file into the buffer. Returns false at the end of the file.
+    bool fill();
+
+    void releaseBuffer();
+
+    int fd_;
+    std::size_t numRows_;
+    // Allocated on the first write or read.
+    std::unique_ptr<char[]> buffer_;
+    // Bytes to write, or bytes read but not consumed yet, are in [begin_, end_) of buffer_.
+    std::size_t begin_;
+    std::size_t end_;
+    // True if buffer_ holds bytes to write.
+    bool writing_;
+};
+
+/**
+ * @brief Chooses the partition of a hash. Each spill level uses a different seed, so that rows
+ * of one partition are spread over all partitions when the partition is spilled again.
+ */
+std::size_t partitionOf(std::uint64_t hash, std::size_t seed, std::size_t numPartitions);
+
+/// Approximate bytes of memory taken by a row buffered in memory.
+std::size_t rowMemoryUsage(const std::vector<std::any>& row);
+
+} // namespace codein
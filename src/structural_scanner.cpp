@@ -0,0 +1,192 @@
+/**
+ * Copyright (C) 2021-present Codein Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify it under the terms of
+ * BSD-3-Clause License which can be found at the root directory of this repository.
+ */
+
+#include <algorithm>
+#include <bit>
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+#include <vector>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+#include "structural_scanner.h"
+
+namespace codein {
+
+namespace {
+
+StructuralMasks findStructuralsScalar(const char* block)
+{
+    std::uint64_t commas = 0;
+    std::uint64_t newlines = 0;
+    for (std::size_t i = 0; i < kStructuralBlockSize; ++i) {
+        commas |= std::uint64_t{block[i] == ','} << i;
+        newlines |= std::uint64_t{block[i] == '\n'} << i;
+    }
+
+    return {commas, newlines};
+}
+
+#if defined(__x86_64__)
+
+// SSE2 is part of x86-64, so it needs no runtime check.
+StructuralMasks findStructuralsSse2(const char* block)
+{
+    const __m128i comma = _mm_set1_epi8(',');
+    const __m128i newline = _mm_set1_epi8('\n');
+
+    std::uint64_t commas = 0;
+    std::uint64_t newlines = 0;
+    for (std::size_t i = 0; i < kStructuralBlockSize; i += 16) {
+        const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(block + i));
+        commas |= std::uint64_t{static_cast<std::uint16_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(v, comma)))} << i;
+        newlines |= std::uint64_t{static_cast<std::uint16_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(v, newline)))} << i;
+    }
+
+    return {commas, newlines};
+}
+
+__attribute__((target("avx2")))
+StructuralMasks findStructuralsAvx2(const char* block)
+{
+    const __m256i comma = _mm256_set1_epi8(',');
+    const __m256i newline = _mm256_set1_epi8('\n');
+
+    const __m256i lo = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(block));
+    const __m256i hi = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(block + 32));
+
+    auto mask = [](__m256i lo, __m256i hi, __m256i c) __attribute__((target("avx2"))) {
+        const std::uint32_t l = _mm256_movemask_epi8(_mm256_cmpeq_epi8(lo, c));
+        const std::uint32_t h = _mm256_movemask_epi8(_mm256_cmpeq_epi8(hi, c));
+        return std::uint64_t{l} | (std::uint64_t{h} << 32);
+    };
+
+    return {mask(lo, hi, comma), mask(lo, hi, newline)};
+}
+
+#endif
+
+SimdLevel detectSimdLevel()
+{
+#if defined(__x86_64__)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        return SimdLevel::Avx2;
+    }
+
+    return SimdLevel::Sse2;
+#else
+    return SimdLevel::Scalar;
+#endif
+}
+
+using FindStructuralsFunc = StructuralMasks (*)(const char*);
+
+FindStructuralsFunc selectFindStructurals(SimdLevel level)
+{
+    switch (level) {
+#if defined(__x86_64__)
+    case SimdLevel::Avx2:
+        return findStructuralsAvx2;
+    case SimdLevel::Sse2:
+        return findStructuralsSse2;
+#endif
+    default:
+        return findStructuralsScalar;
+    }
+}
+
+const SimdLevel kSupportedSimdLevel = detectSimdLevel();
+
+const FindStructuralsFunc findStructuralsBest = selectFindStructurals(kSupportedSimdLevel);
+
+inline bool isBlank(char c)
+{
+    return c == ' ' || c == '\t';
+}
+
+inline void addField(std::string_view data, std::size_t left, std::size_t right, std::vector<std::string_view>& fields)
+{
+    while (left < right && isBlank(data[left])) {
+        ++left;
+    }
+    while (right > left && isBlank(data[right - 1])) {
+        --right;
+    }
+
+    fields.emplace_back(data.data() + left, right - left);
+}
+
+}
+
+SimdLevel supportedSimdLevel()
+{
+    return kSupportedSimdLevel;
+}
+
+StructuralMasks findStructurals(const char* block)
+{
+    return findStructuralsBest(block);
+}
+
+StructuralMasks findStructurals(const char* block, SimdLevel level)
+{
+    assert(level <= kSupportedSimdLevel);
+
+    return selectFindStructurals(level)(block);
+}
+
+std::size_t splitFields(std::string_view data, std::vector<std::string_view>& fields, bool stopAtNewline)
+{
+    fields.clear();
+
+    const std::size_t n = data.size();
+    std::size_t left = 0;
+    for (std::size_t blockStart = 0; blockStart < n; blockStart += kStructuralBlockSize) {
+        const std::size_t len = std::min(kStructuralBlockSize, n - blockStart);
+        const char* block = data.data() + blockStart;
+
+        // The last partial block is copied so that a whole block can be read.
+        char tail[kStructuralBlockSize];
+        if (len < kStructuralBlockSize) {
+            std::memcpy(tail, block, len);
+            std::memset(tail + len, 0, kStructuralBlockSize - len);
+            block = tail;
+        }
+
+        auto [commas, newlines] = findStructuralsBest(block);
+        if (stopAtNewline && newlines != 0) {
+            // Only commas before the first newline belong to this line.
+            const std::size_t lineEnd = blockStart + std::countr_zero(newlines);
+            commas &= (newlines & -newlines) - 1;
+            for (; commas != 0; commas &= commas - 1) {
+                const std::size_t right = blockStart + std::countr_zero(commas);
+                addField(data, left, right, fields);
+                left = right + 1;
+            }
+            addField(data, left, lineEnd, fields);
+
+            return lineEnd;
+        }
+
+        for (; commas != 0; commas &= commas - 1) {
+            const std::size_t right = blockStart + std::countr_zero(commas);
+            addField(data, left, right, fields);
+            left = right + 1;
+        }
+    }
+
+    addField(data, left, n, fields);
+
+    return n;
+}
+
+} // namespace codein
@@ -0,0 +1,67 @@
+/**
+ * Copyright (C) 2021-present Codein Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify it under the terms of
+ * BSD-3-Clause License which can be found at the root directory of this repository.
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+#pragma once
+
+namespace codein {
+
+/// Number of bytes examined at once by findStructurals().
+constexpr std::size_t kStructuralBlockSize = 64;
+
+/**
+ * @brief Positions of structural characters in a 64-byte block.
+ * Bit i of each mask is set if byte i of the block is the character.
+ */
+struct StructuralMasks {
+    std::uint64_t commas;
+    std::uint64_t newlines;
+};
+
+/**
+ * @brief Instruction sets that findStructurals() can be implemented with.
+ */
+enum class SimdLevel {
+    Scalar,
+    Sse2,
+    Avx2,
+};
+
+/**
+ * @brief The best instruction set supported by the running CPU. Detected once at startup.
+ */
+SimdLevel supportedSimdLevel();
+
+/**
+ * @brief Finds commas and newlines in a block of kStructuralBlockSize bytes.
+ * 
+ * @param block: pointer to kStructuralBlockSize readable bytes.
+ * @return Bitmasks of commas and newlines in the block.
+ */
+StructuralMasks findStructurals(const char* block);
+
+/**
+ * @brief Same as findStructurals(const char*) but implemented with the given instruction set,
+ * which must not be better than supportedSimdLevel().
+ */
+StructuralMasks findStructurals(const char* block, SimdLevel level);
+
+/**
+ * @brief Splits comma-separated fields, trimming spaces and tabs on both sides of each field.
+ * 
+ * @param data: input data.
+ * @param fields: receives views of each field into data. Its storage is reused.
+ * @param stopAtNewline: if true, only the first line of data is split.
+ * @return Number of bytes of the split line, not including the terminating newline.
+ */
+std::size_t splitFields(std::string_view data, std::vector<std::string_view>& fields, bool stopAtNewline);
+
+} // namespace codein
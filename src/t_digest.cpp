@@ -0,0 +1,151 @@
+/**
+ * Copyright (C) 2021-present Codein Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify it under the terms of
+ * BSD-3-Clause License which can be found at the root directory of this repository.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <numbers>
+#include <vector>
+
+#include "t_digest.h"
+
+namespace codein {
+
+namespace {
+
+// Number of buffered values relative to the compression before they are merged.
+constexpr double kBufferFactor = 5;
+
+}
+
+TDigest::TDigest(double compression)
+    : compression_(std::max(compression, 10.0))
+    , centroids_()
+    , buffer_()
+    , totalWeight_(0)
+    , min_(std::numeric_limits<double>::infinity())
+    , max_(-std::numeric_limits<double>::infinity())
+{}
+
+void TDigest::add(double value, double weight)
+{
+    if (std::isnan(value) || weight <= 0) {
+        return;
+    }
+
+    buffer_.push_back(Centroid{value, weight});
+    totalWeight_ += weight;
+    min_ = std::min(min_, value);
+    max_ = std::max(max_, value);
+
+    if (buffer_.size() >= kBufferFactor * compression_) {
+        compress();
+    }
+}
+
+void TDigest::merge(const TDigest& other)
+{
+    if (other.totalWeight_ == 0) {
+        return;
+    }
+
+    buffer_.insert(buffer_.end(), other.centroids_.begin(), other.centroids_.end());
+    buffer_.insert(buffer_.end(), other.buffer_.begin(), other.buffer_.end());
+    totalWeight_ += other.totalWeight_;
+    min_ = std::min(min_, other.min_);
+    max_ = std::max(max_, other.max_);
+
+    compress();
+}
+
+void TDigest::compress()
+{
+    if (!buffer_.empty()) {
+        centroids_ = mergeCentroids(std::move(centroids_));
+        buffer_.clear();
+    }
+}
+
+std::vector<TDigest::Centroid> TDigest::mergeCentroids(std::vector<Centroid> centroids) const
+{
+    centroids.insert(centroids.end(), buffer_.begin(), buffer_.end());
+    std::sort(centroids.begin(), centroids.end(), [](const auto& lhs, const auto& rhs) {
+        return lhs.mean < rhs.mean;
+    });
+
+    // Scale function k(q) = compression / 2pi * asin(2q - 1) and its inverse. A centroid may
+    // cover at most 1 in k.
+    const double scale = compression_ / (2 * std::numbers::pi);
+    auto k = [scale](double q) { return scale * std::asin(2 * q - 1); };
+    auto qOfK = [scale](double k) { return (std::sin(k / scale) + 1) / 2; };
+
+    std::vector<Centroid> merged;
+    merged.reserve(static_cast<std::size_t>(compression_) + 1);
+
+    double weightSoFar = 0;
+    double qLimit = qOfK(k(0) + 1);
+    Centroid cur = centroids[0];
+    for (std::size_t i = 1; i < centroids.size(); ++i) {
+        const auto& next = centroids[i];
+        const double q = (weightSoFar + cur.weight + next.weight) / totalWeight_;
+        if (q <= qLimit) {
+            cur.weight += next.weight;
+            cur.mean += (next.mean - cur.mean) * next.weight / cur.weight;
+        }
+        else {
+            weightSoFar += cur.weight;
+            merged.push_back(cur);
+            qLimit = qOfK(k(std::min(weightSoFar / totalWeight_, 1.0)) + 1);
+            cur = next;
+        }
+    }
+    merged.push_back(cur);
+
+    return merged;
+}
+
+std::size_t TDigest::numCentroids() const
+{
+    return buffer_.empty() ? centroids_.size() : mergeCentroids(centroids_).size();
+}
+
+double TDigest::quantile(double q) const
+{
+    if (totalWeight_ == 0) {
+        return std::numeric_limits<double>::quiet_NaN();
+    }
+
+    const auto centroids = buffer_.empty() ? centroids_ : mergeCentroids(centroids_);
+    if (centroids.size() == 1) {
+        return centroids[0].mean;
+    }
+
+    // Each centroid is taken to be centered at its mean, and values between centers are
+    // interpolated linearly. min_ and max_ bound the first and last halves.
+    const double index = std::clamp(q, 0.0, 1.0) * totalWeight_;
+
+    const auto& first = centroids.front();
+    if (index < first.weight / 2) {
+        return min_ + (first.mean - min_) * index / (first.weight / 2);
+    }
+
+    double weightSoFar = first.weight / 2;
+    for (std::size_t i = 0; i + 1 < centroids.size(); ++i) {
+        const double dw = (centroids[i].weight + centroids[i + 1].weight) / 2;
+        if (index < weightSoFar + dw) {
+            return centroids[i].mean + (centroids[i + 1].mean - centroids[i].mean) * (index - weightSoFar) / dw;
+        }
+        weightSoFar += dw;
+    }
+
+    const auto& last = centroids.back();
+    const double value = last.mean + (max_ - last.mean) * (index - weightSoFar) / (last.weight / 2);
+
+    return std::min(value, max_);
+}
+
+} // namespace codein
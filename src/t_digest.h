@@ -0,0 +1,84 @@
+/**
+ * Copyright (C) 2021-present Codein Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify it under the terms of
+ * BSD-3-Clause License which can be found at the root directory of this repository.
+ */
+
+#include <cstddef>
+#include <vector>
+
+#pragma once
+
+namespace codein {
+
+/**
+ * @brief Merging t-digest sketch estimating quantiles of the values added to it.
+ *
+ * Values are summarized into centroids of a mean and a weight. Centroids near the tails of the
+ * distribution are kept small by the arcsine scale function, so extreme quantiles such as p99
+ * are more accurate than the median. The number of centroids is bounded by about the
+ * compression regardless of the number of values. Digests can be merged into the digest of
+ * the union of their values.
+ */
+class TDigest {
+public:
+    static constexpr double kDefaultCompression = 100;
+
+    /**
+     * @brief Constructs an empty digest.
+     *
+     * @param compression: larger values keep more centroids for better accuracy.
+     */
+    explicit TDigest(double compression = kDefaultCompression);
+
+    void add(double value, double weight = 1);
+
+    void merge(const TDigest& other);
+
+    /**
+     * @brief Estimates the q-quantile.
+     *
+     * @param q: quantile in [0, 1]. e.g. 0.99 for p99.
+     * @return the estimated value, or NaN if no value has been added.
+     */
+    double quantile(double q) const;
+
+    /// Total weight of the added values.
+    double totalWeight() const
+    {
+        return totalWeight_;
+    }
+
+    /// Number of centroids after merging buffered values.
+    std::size_t numCentroids() const;
+
+    /// Bytes of the digest including its centroids and buffered values.
+    std::size_t memoryUsage() const
+    {
+        return sizeof(*this) + (centroids_.capacity() + buffer_.capacity()) * sizeof(Centroid);
+    }
+
+private:
+    struct Centroid {
+        double mean;
+        double weight;
+    };
+
+    // Merges the buffered values into centroids.
+    void compress();
+
+    // Returns centroids merged from centroids and buffered values.
+    std::vector<Centroid> mergeCentroids(std::vector<Centroid> centroids) const;
+
+    double compression_;
+    // Sorted by mean.
+    std::vector<Centroid> centroids_;
+    // Values not merged into centroids yet.
+    std::vector<Centroid> buffer_;
+    double totalWeight_;
+    double min_;
+    double max_;
+};
+
+} // namespace codein
@@ -5,84 +5,75 @@
  * BSD-3-Clause License which can be found at the root directory of this repository.
  */
 
+#include <cctype>
+#include <charconv>
 #include <string>
+#include <string_view>
+#include <system_error>
 #include <typeindex>
 #include <unordered_map>
 
 #include "to_any_converter.h"
+#include "value.h"
 
 namespace codein {
 
 const std::any nullany;
 
-/**
- * @brief Make a type_index&converter to any pair to register the converter for a specific type.
- * 
- * @tparam T The type of value which the string is converted into
- * @param f The converter function which convert string into a value of T
- * @return a pair of type_index & converter
- */
-template <typename T>
-constexpr std::pair<
-    const std::type_index,
-    std::function<std::any(const std::string&)>
->
-toAnyConverter(const std::function<T(const std::string&)> f)
+std::any convertTo(const std::type_index& ti, const std::string& s) noexcept
 {
-    return {
-        std::type_index(typeid(T)),
-        [g = f](const std::string& s) -> std::any
-        {
-            return g(s);
-        }
-    };
+    return toAny(convertToValue(ti, s));
 }
 
 /**
- * @brief Type alias for map between type index and string-to-value converter function.
+ * @brief Parse a number at the beginning of s. Like std::sto* functions, leading white spaces
+ * and a plus sign are accepted and characters after the number are ignored.
+ *
+ * @return Parsed number. Null value if s does not start with a number of T or the number
+ *   is out of the range of T.
  */
-using AnyConverterMap = std::unordered_map<
-    std::type_index,
-    std::function<std::any(const std::string&)>
->;
-
-std::any convertTo(const std::type_index& ti, const std::string& s) noexcept
+template <typename T>
+Value parseNumber(std::string_view s) noexcept
 {
-    /**
-     * @brief The hash table between type and string-to-value converter function.
-     * Converter function's return type is std::any which can contain any value inside it.
-     * FieldMetadataInfo provides type info with typeIndex and the type info can be used
-     * to convert a string into a value of that type.
-     */
-    static const AnyConverterMap anyConverters {
-        // TODO: #112 Add string to bool converter
-        toAnyConverter<int>([](const std::string& s) {
-            return stoi(s);
-        }),
-        toAnyConverter<unsigned>([](const std::string& s) {
-            return static_cast<unsigned>(stoul(s));
-        }),
-        toAnyConverter<float>([](const std::string& s) {
-            return stof(s);
-        }),
-        toAnyConverter<double>([](const std::string& s) {
-            return stod(s);
-        }),
-        toAnyConverter<std::string>([](const std::string& s) {
-            return s;
-        }),
-    };
+    const char* first = s.data();
+    const char* last = first + s.size();
+    while (first != last && std::isspace(static_cast<unsigned char>(*first))) {
+        ++first;
+    }
+    if (first != last && *first == '+' && (first + 1 == last || first[1] != '-')) {
+        ++first;
+    }
+
+    T v;
+    if (auto [_, ec] = std::from_chars(first, last, v); ec != std::errc()) {
+        return Value();
+    }
+
+    return v;
+}
 
-    try {
-        if (const auto it = anyConverters.find(ti); it != anyConverters.cend()) {
-            return it->second(s);
-        }
+Value convertToValue(const std::type_index& ti, std::string_view s) noexcept
+{
+    // Type indexes are compared directly, most frequent types first, instead of looking up
+    // a converter function in a hash table.
+    if (ti == tiInt) {
+        return parseNumber<int>(s);
+    }
+    else if (ti == tiString) {
+        return std::string(s);
+    }
+    else if (ti == tiDouble) {
+        return parseNumber<double>(s);
+    }
+    else if (ti == tiUint) {
+        return parseNumber<unsigned>(s);
     }
-    catch (...) {
-        // Absorb any exceptions and return null any value instead.
+    else if (ti == tiFloat) {
+        return parseNumber<float>(s);
     }
+    // TODO: #112 Add string to bool converter
 
-    return nullany;
+    return Value();
 }
 
 const std::unordered_map<std::string, std::type_index> typeMap {
@@ -9,8 +9,11 @@
 #include <cassert>
 #include <functional>
 #include <string>
+#include <string_view>
 #include <typeindex>
 
+#include "value.h"
+
 #pragma once
 
 namespace codein {
@@ -29,6 +32,16 @@ extern const std::any nullany;
  */
 std::any convertTo(const std::type_index& ti, const std::string& s) noexcept;
 
+/**
+ * @brief Convert a string into a Value of ti type. Numbers are parsed in place with
+ * std::from_chars, so s can be a slice of a larger buffer.
+ *
+ * @param ti Type index
+ * @param s String value
+ * @return Converted value. Null value if s cannot be converted into ti type.
+ */
+Value convertToValue(const std::type_index& ti, std::string_view s) noexcept;
+
 std::type_index convertToTypeid(const std::string& typeName);
 
 /// Type index for void type.
@@ -0,0 +1,86 @@
+/**
+ * Copyright (C) 2021-present Codein Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify it under the terms of
+ * BSD-3-Clause License which can be found at the root directory of this repository.
+ */
+
+#include <algorithm>
+#include <any>
+#include <optional>
+#include <vector>
+
+#include "top_n.h"
+
+namespace codein {
+
+bool TopN::before(const Entry& lhs, const Entry& rhs) const
+{
+    const int c = comparator_.compare(lhs.row, rhs.row);
+
+    return c != 0 ? c < 0 : lhs.seq < rhs.seq;
+}
+
+void TopN::open()
+{
+    child_->open();
+
+    rows_.clear();
+    rows_.reserve(std::min<std::size_t>(limit_, kDefaultBatchSize));
+    pos_ = 0;
+
+    auto less = [this](const Entry& lhs, const Entry& rhs) { return before(lhs, rhs); };
+
+    // Rows are read into candidate and moved into the heap only if they are among the best
+    // rows, so the storage of rejected rows is reused.
+    Entry candidate{{}, 0};
+    while (limit_ != 0 && child_->hasNext()) {
+        auto batch = child_->processNextBatch();
+        if (!batch) {
+            break;
+        }
+
+        for (std::size_t i = 0; i < batch->numRows(); ++i, ++candidate.seq) {
+            batch->readRow(i, candidate.row);
+
+            if (rows_.size() < limit_) {
+                rows_.push_back(std::move(candidate));
+                std::push_heap(rows_.begin(), rows_.end(), less);
+            }
+            // A later row tied with the last of the best rows comes after it.
+            else if (comparator_.compare(candidate.row, rows_.front().row) < 0) {
+                std::pop_heap(rows_.begin(), rows_.end(), less);
+                std::swap(rows_.back(), candidate);
+                candidate.seq = rows_.back().seq;
+                std::push_heap(rows_.begin(), rows_.end(), less);
+            }
+        }
+    }
+
+    std::sort_heap(rows_.begin(), rows_.end(), less);
+}
+
+std::optional<std::vector<std::any>> TopN::processNext()
+{
+    if (!hasNext()) {
+        return std::nullopt;
+    }
+
+    return std::move(rows_[pos_++].row);
+}
+
+std::optional<Batch> TopN::processNextBatch(std::size_t maxRows)
+{
+    if (!hasNext()) {
+        return std::nullopt;
+    }
+
+    Batch batch(getMetadata().size());
+    while (batch.numRows() < maxRows && hasNext()) {
+        batch.appendRow(std::move(rows_[pos_++].row));
+    }
+
+    return batch;
+}
+
+} // namespace codein
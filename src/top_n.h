@@ -0,0 +1,98 @@
+/**
+ * Copyright (C) 2021-present Codein Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify it under the terms of
+ * BSD-3-Clause License which can be found at the root directory of this repository.
+ */
+
+#include <any>
+#include <cstddef>
+#include <memory>
+#include <optional>
+#include <vector>
+
+#include "iterator.h"
+#include "sort_key.h"
+
+#pragma once
+
+namespace codein {
+
+/**
+ * @brief Top-N iterator outputting the first n rows of its child in the order of sort keys.
+ *
+ * It is equivalent to Sorter followed by Limiter, but keeps only a heap of the best n rows
+ * seen so far, so it takes O(rows * log n) time and O(n) memory. open() consumes the whole
+ * input. Like Sorter, rows with equal keys are taken in input order and nulls sort first.
+ */
+class TopN : public Iterator {
+public:
+    template <typename T, typename... ArgTs>
+    friend std::unique_ptr<Iterator> makeIterator(ArgTs&&...);
+
+    void open() override;
+
+    void reopen() override
+    {
+        open();
+    }
+
+    bool hasNext() const override
+    {
+        return pos_ < rows_.size();
+    }
+
+    std::optional<std::vector<std::any>> processNext() override;
+
+    std::optional<Batch> processNextBatch(std::size_t maxRows = kDefaultBatchSize) override;
+
+    void close() override
+    {
+        child_->close();
+    }
+
+    const Metadata& getMetadata() const override
+    {
+        return child_->getMetadata();
+    }
+
+    ~TopN() override
+    {}
+
+private:
+    /**
+     * @brief Constructs a new TopN object.
+     *
+     * @param child A child iterator.
+     * @param keys Sort keys in order of precedence.
+     * @param limit Maximum number of rows to output.
+     */
+    TopN(std::unique_ptr<Iterator>&& child, const std::vector<SortKey>& keys, std::size_t limit)
+        : child_(std::move(child))
+        , comparator_(keys, child_->getMetadata())
+        , limit_(limit)
+        , rows_()
+        , pos_(0)
+    {}
+
+    // A row kept in the heap, and its position in the input to break ties.
+    struct Entry {
+        std::vector<std::any> row;
+        std::size_t seq;
+    };
+
+    // Whether lhs comes before rhs in the output.
+    bool before(const Entry& lhs, const Entry& rhs) const;
+
+    std::unique_ptr<Iterator> child_;
+    const RowComparator comparator_;
+    const std::size_t limit_;
+
+    // Max-heap of the best rows while consuming input, whose top is the last of them.
+    // Sorted after open().
+    std::vector<Entry> rows_;
+    // Position of the next row to output.
+    std::size_t pos_;
+};
+
+} // namespace codein
@@ -0,0 +1,663 @@
+/**
+ * Copyright (C) 2021-present Codein Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify it under the terms of
+ * BSD-3-Clause License which can be found at the root directory of this repository.
+ */
+
+#include <any>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <string>
+#include <type_traits>
+#include <typeindex>
+#include <utility>
+#include <variant>
+#include <vector>
+
+#include "batch.h"
+#include "expression.h"
+#include "metadata.h"
+#include "structural_scanner.h"
+#include "to_any_converter.h"
+#include "typed_kernel.h"
+#include "value_ops.h"
+
+namespace codein {
+
+namespace {
+
+/**
+ * Operands of kernels. bind() returns an accessor of values for a batch, or nullopt if the batch
+ * does not have the expected column type.
+ */
+
+template <typename T>
+class ColumnOperand {
+public:
+    using Type = T;
+
+    struct Accessor {
+        const T& operator[](std::size_t i) const
+        {
+            return values[i];
+        }
+
+        // Loads values from i into a SIMD vector.
+        template <typename V>
+        [[gnu::always_inline]] void load(std::size_t i, V& out) const
+        {
+            std::memcpy(&out, values + i, sizeof(V));
+        }
+
+        const T* values;
+    };
+
+    explicit ColumnOperand(std::size_t col)
+        : col_(col)
+    {}
+
+    std::optional<Accessor> bind(const Batch& batch) const
+    {
+        if (col_ >= batch.numColumns()) {
+            return std::nullopt;
+        }
+
+        const auto& column = batch.column(col_);
+        if (!column.holds<T>() || column.hasNulls()) {
+            return std::nullopt;
+        }
+
+        return Accessor{column.values<T>().data()};
+    }
+
+private:
+    std::size_t col_;
+};
+
+template <typename T>
+class ConstOperand {
+public:
+    using Type = T;
+
+    struct Accessor {
+        const T& operator[](std::size_t) const
+        {
+            return *value;
+        }
+
+        // Broadcasts the value into a SIMD vector.
+        template <typename V>
+        [[gnu::always_inline]] void load(std::size_t, V& out) const
+        {
+            out = V{} + *value;
+        }
+
+        const T* value;
+    };
+
+    explicit ConstOperand(T value)
+        : value_(std::move(value))
+    {}
+
+    std::optional<Accessor> bind(const Batch&) const
+    {
+        return Accessor{&value_};
+    }
+
+private:
+    T value_;
+};
+
+template <typename T, typename Op, typename L, typename R>
+class ArithmeticKernel : public ColumnKernel {
+public:
+    ArithmeticKernel(L lhs, R rhs)
+        : lhs_(std::move(lhs))
+        , rhs_(std::move(rhs))
+    {}
+
+    bool eval(const Batch& batch, Column& out) const override
+    {
+        const auto lhs = lhs_.bind(batch);
+        const auto rhs = rhs_.bind(batch);
+        if (!lhs || !rhs) {
+            return false;
+        }
+
+        const Op op;
+        std::vector<T> values(batch.numRows());
+        for (std::size_t i = 0; i < values.size(); ++i) {
+            values[i] = op((*lhs)[i], (*rhs)[i]);
+        }
+        out.assign(std::move(values));
+
+        return true;
+    }
+
+private:
+    const L lhs_;
+    const R rhs_;
+};
+
+class RefKernel : public ColumnKernel {
+public:
+    explicit RefKernel(std::size_t col)
+        : col_(col)
+    {}
+
+    bool eval(const Batch& batch, Column& out) const override
+    {
+        if (col_ >= batch.numColumns()) {
+            return false;
+        }
+        out = batch.column(col_);
+
+        return true;
+    }
+
+private:
+    std::size_t col_;
+};
+
+template <OpCode Op, typename A, typename B>
+bool compare(const A& lhs, const B& rhs)
+{
+    if constexpr (Op == OpCode::Eq) {
+        return lhs == rhs;
+    }
+    else if constexpr (Op == OpCode::Neq) {
+        return lhs != rhs;
+    }
+    else if constexpr (Op == OpCode::Lt) {
+        return lhs < rhs;
+    }
+    else if constexpr (Op == OpCode::Lte) {
+        return lhs <= rhs;
+    }
+    else if constexpr (Op == OpCode::Gt) {
+        return lhs > rhs;
+    }
+    else {
+        return lhs >= rhs;
+    }
+}
+
+// 32-byte SIMD vector of T, using GCC vector extensions.
+template <typename T>
+struct SimdVector {
+    typedef T Type __attribute__((vector_size(32)));
+};
+
+template <typename T>
+constexpr bool kHasSimdVector = OneOf<T, int, unsigned, float, double>;
+
+/**
+ * @brief Compares n values of lhs and rhs, writing 1 or 0 into mask.
+ *
+ * Numeric values are compared a SIMD vector at a time. Vectors are compared within this function
+ * instead of by helpers since passing vectors across functions depends on the instruction set.
+ */
+template <typename T, OpCode Op, typename LA, typename RA>
+[[gnu::always_inline]] inline void compareValues(const LA& lhs, const RA& rhs, std::size_t n, std::uint8_t* mask)
+{
+    std::size_t i = 0;
+    if constexpr (kHasSimdVector<T>) {
+        using V = typename SimdVector<T>::Type;
+        constexpr std::size_t kLanes = sizeof(V) / sizeof(T);
+
+        for (; i + kLanes <= n; i += kLanes) {
+            V l;
+            V r;
+            lhs.load(i, l);
+            rhs.load(i, r);
+
+            // Each lane of m is -1 if the comparison holds and 0 otherwise.
+            decltype(l < r) m;
+            if constexpr (Op == OpCode::Eq) {
+                m = l == r;
+            }
+            else if constexpr (Op == OpCode::Neq) {
+                m = l != r;
+            }
+            else if constexpr (Op == OpCode::Lt) {
+                m = l < r;
+            }
+            else if constexpr (Op == OpCode::Lte) {
+                m = l <= r;
+            }
+            else if constexpr (Op == OpCode::Gt) {
+                m = l > r;
+            }
+            else {
+                m = l >= r;
+            }
+
+            for (std::size_t k = 0; k < kLanes; ++k) {
+                mask[i + k] = m[k] & 1;
+            }
+        }
+    }
+
+    for (; i < n; ++i) {
+        mask[i] = compare<Op>(lhs[i], rhs[i]);
+    }
+}
+
+#if defined(__x86_64__)
+
+// compareValues() compiled with AVX2. Must be called only if the CPU supports AVX2.
+template <typename T, OpCode Op, typename LA, typename RA>
+__attribute__((target("avx2")))
+void compareValuesAvx2(const LA& lhs, const RA& rhs, std::size_t n, std::uint8_t* mask)
+{
+    compareValues<T, Op>(lhs, rhs, n, mask);
+}
+
+#endif
+
+template <typename T, OpCode Op, typename L, typename R>
+class ComparisonKernel : public PredicateKernel {
+public:
+    ComparisonKernel(L lhs, R rhs)
+        : lhs_(std::move(lhs))
+        , rhs_(std::move(rhs))
+    {}
+
+    bool eval(const Batch& batch, std::vector<std::uint8_t>& mask) const override
+    {
+        const auto lhs = lhs_.bind(batch);
+        const auto rhs = rhs_.bind(batch);
+        if (!lhs || !rhs) {
+            return false;
+        }
+
+        mask.resize(batch.numRows());
+#if defined(__x86_64__)
+        if constexpr (kHasSimdVector<T>) {
+            if (supportedSimdLevel() == SimdLevel::Avx2) {
+                compareValuesAvx2<T, Op>(*lhs, *rhs, mask.size(), mask.data());
+                return true;
+            }
+        }
+#endif
+        compareValues<T, Op>(*lhs, *rhs, mask.size(), mask.data());
+
+        return true;
+    }
+
+private:
+    const L lhs_;
+    const R rhs_;
+};
+
+class BoolColumnKernel : public PredicateKernel {
+public:
+    explicit BoolColumnKernel(std::size_t col)
+        : col_(col)
+    {}
+
+    bool eval(const Batch& batch, std::vector<std::uint8_t>& mask) const override
+    {
+        if (col_ >= batch.numColumns()) {
+            return false;
+        }
+
+        const auto& column = batch.column(col_);
+        if (!column.holds<bool>() || column.hasNulls()) {
+            return false;
+        }
+
+        const auto& values = column.values<bool>();
+        mask.assign(values.cbegin(), values.cend());
+
+        return true;
+    }
+
+private:
+    std::size_t col_;
+};
+
+class ConstPredicateKernel : public PredicateKernel {
+public:
+    explicit ConstPredicateKernel(bool value)
+        : value_(value)
+    {}
+
+    bool eval(const Batch& batch, std::vector<std::uint8_t>& mask) const override
+    {
+        mask.assign(batch.numRows(), value_);
+
+        return true;
+    }
+
+private:
+    bool value_;
+};
+
+class NotKernel : public PredicateKernel {
+public:
+    explicit NotKernel(std::unique_ptr<PredicateKernel>&& child)
+        : child_(std::move(child))
+    {}
+
+    bool eval(const Batch& batch, std::vector<std::uint8_t>& mask) const override
+    {
+        if (!child_->eval(batch, mask)) {
+            return false;
+        }
+
+        for (auto& m: mask) {
+            m ^= 1;
+        }
+
+        return true;
+    }
+
+private:
+    std::unique_ptr<PredicateKernel> child_;
+};
+
+template <typename Op>
+class LogicalKernel : public PredicateKernel {
+public:
+    LogicalKernel(std::unique_ptr<PredicateKernel>&& lhs, std::unique_ptr<PredicateKernel>&& rhs)
+        : lhs_(std::move(lhs))
+        , rhs_(std::move(rhs))
+        , rhsMask_()
+    {}
+
+    bool eval(const Batch& batch, std::vector<std::uint8_t>& mask) const override
+    {
+        // Both sides are evaluated for all rows. It doesn't matter since comparisons never throw.
+        if (!lhs_->eval(batch, mask) || !rhs_->eval(batch, rhsMask_)) {
+            return false;
+        }
+
+        const Op op;
+        for (std::size_t i = 0; i < mask.size(); ++i) {
+            mask[i] = op(mask[i], rhsMask_[i]);
+        }
+
+        return true;
+    }
+
+private:
+    std::unique_ptr<PredicateKernel> lhs_;
+    std::unique_ptr<PredicateKernel> rhs_;
+    // Buffer reused across batches.
+    mutable std::vector<std::uint8_t> rhsMask_;
+};
+
+// Index of the column referred by expr. nullopt if expr is not a Ref to a column in metadata.
+std::optional<std::size_t> refIndex(const Expression& expr, const Metadata& metadata)
+{
+    if (expr.opCode != OpCode::Ref || !std::holds_alternative<std::any>(expr.leafOrChildren)) {
+        return std::nullopt;
+    }
+
+    const auto name = std::any_cast<std::string>(&expr.leaf());
+    if (name == nullptr) {
+        return std::nullopt;
+    }
+
+    auto [found, i] = metadata.find(*name);
+    if (!found) {
+        return std::nullopt;
+    }
+
+    return i;
+}
+
+// Value of a constant expression. nullptr if expr is not a constant.
+const std::any* constValue(const Expression& expr)
+{
+    if (expr.opCode != OpCode::Const || !std::holds_alternative<std::any>(expr.leafOrChildren)) {
+        return nullptr;
+    }
+
+    return &expr.leaf();
+}
+
+bool isBinary(const Expression& expr)
+{
+    return std::holds_alternative<std::vector<Expression>>(expr.leafOrChildren) && expr.children().size() == 2;
+}
+
+/**
+ * @brief Calls f with std::type_identity<T> for the type T identified by ti.
+ * Returns R() if the type has no kernels.
+ */
+template <typename R, typename F>
+R dispatchType(const std::type_index& ti, bool numericOnly, F&& f)
+{
+    if (ti == tiInt) {
+        return f(std::type_identity<int>());
+    }
+    else if (ti == tiUint) {
+        return f(std::type_identity<unsigned>());
+    }
+    else if (ti == tiFloat) {
+        return f(std::type_identity<float>());
+    }
+    else if (ti == tiDouble) {
+        return f(std::type_identity<double>());
+    }
+    else if (ti == tiString && !numericOnly) {
+        return f(std::type_identity<std::string>());
+    }
+
+    return R();
+}
+
+/**
+ * @brief Calls f with the operands of a binary expression between a column and a column or
+ * a constant of the same type. Returns R() if expr does not have such operands.
+ */
+template <typename R, typename F>
+R dispatchOperands(const Expression& expr, const Metadata& metadata, bool numericOnly, F&& f)
+{
+    const auto lhsCol = refIndex(expr.first(), metadata);
+    const auto rhsCol = refIndex(expr.second(), metadata);
+    const auto lhsConst = constValue(expr.first());
+    const auto rhsConst = constValue(expr.second());
+
+    std::type_index ti = tiVoid;
+    if (lhsCol && rhsCol) {
+        ti = metadata[*lhsCol].typeIndex;
+        if (metadata[*rhsCol].typeIndex != ti) {
+            return R();
+        }
+    }
+    else if (lhsCol && rhsConst != nullptr) {
+        ti = metadata[*lhsCol].typeIndex;
+        if (std::type_index(rhsConst->type()) != ti) {
+            return R();
+        }
+    }
+    else if (lhsConst != nullptr && rhsCol) {
+        ti = metadata[*rhsCol].typeIndex;
+        if (std::type_index(lhsConst->type()) != ti) {
+            return R();
+        }
+    }
+    else {
+        return R();
+    }
+
+    return dispatchType<R>(ti, numericOnly, [&]<typename T>(std::type_identity<T>) -> R {
+        if (lhsCol && rhsCol) {
+            return f(ColumnOperand<T>(*lhsCol), ColumnOperand<T>(*rhsCol));
+        }
+        else if (lhsCol) {
+            return f(ColumnOperand<T>(*lhsCol), ConstOperand<T>(std::any_cast<T>(*rhsConst)));
+        }
+        else {
+            return f(ConstOperand<T>(std::any_cast<T>(*lhsConst)), ColumnOperand<T>(*rhsCol));
+        }
+    });
+}
+
+// Calls f with std::integral_constant of a comparison opcode. Returns R() for other opcodes.
+template <typename R, typename F>
+R dispatchComparison(OpCode opCode, F&& f)
+{
+    switch (opCode) {
+    case OpCode::Eq:
+        return f(std::integral_constant<OpCode, OpCode::Eq>());
+    case OpCode::Neq:
+        return f(std::integral_constant<OpCode, OpCode::Neq>());
+    case OpCode::Lt:
+        return f(std::integral_constant<OpCode, OpCode::Lt>());
+    case OpCode::Lte:
+        return f(std::integral_constant<OpCode, OpCode::Lte>());
+    case OpCode::Gt:
+        return f(std::integral_constant<OpCode, OpCode::Gt>());
+    case OpCode::Gte:
+        return f(std::integral_constant<OpCode, OpCode::Gte>());
+    default:
+        return R();
+    }
+}
+
+// Calls f with the functor of an arithmetic opcode. Returns R() for other opcodes.
+template <typename R, typename F>
+R dispatchArithmetic(OpCode opCode, F&& f)
+{
+    switch (opCode) {
+    case OpCode::Add:
+        return f(std::plus<>());
+    case OpCode::Sub:
+        return f(std::minus<>());
+    case OpCode::Mult:
+        return f(std::multiplies<>());
+    case OpCode::Div:
+        return f(std::divides<>());
+    case OpCode::Mod:
+        return f(std::modulus<>());
+    default:
+        return R();
+    }
+}
+
+}
+
+std::unique_ptr<ColumnKernel> makeColumnKernel(const Expression& expr, const Metadata& metadata)
+{
+    using R = std::unique_ptr<ColumnKernel>;
+
+    if (auto col = refIndex(expr, metadata)) {
+        return std::make_unique<RefKernel>(*col);
+    }
+
+    if (!isBinary(expr)) {
+        return nullptr;
+    }
+
+    return dispatchArithmetic<R>(expr.opCode, [&](auto op) {
+        return dispatchOperands<R>(expr, metadata, true, [&](auto lhs, auto rhs) -> R {
+            using T = typename decltype(lhs)::Type;
+            using Op = decltype(op);
+            // Only integral types have modulo.
+            if constexpr (std::is_invocable_r_v<T, Op, T, T>) {
+                return std::make_unique<ArithmeticKernel<T, Op, decltype(lhs), decltype(rhs)>>(lhs, rhs);
+            }
+            else {
+                return nullptr;
+            }
+        });
+    });
+}
+
+std::unique_ptr<PredicateKernel> makePredicateKernel(const Expression& expr, const Metadata& metadata)
+{
+    using R = std::unique_ptr<PredicateKernel>;
+
+    switch (expr.opCode) {
+    case OpCode::Const: {
+        const auto p = std::any_cast<bool>(constValue(expr));
+        return p != nullptr ? std::make_unique<ConstPredicateKernel>(*p) : nullptr;
+    }
+
+    case OpCode::Ref: {
+        const auto col = refIndex(expr, metadata);
+        if (!col || metadata[*col].typeIndex != tiBool) {
+            return nullptr;
+        }
+        return std::make_unique<BoolColumnKernel>(*col);
+    }
+
+    case OpCode::Not: {
+        if (!std::holds_alternative<std::vector<Expression>>(expr.leafOrChildren) || expr.children().size() != 1) {
+            return nullptr;
+        }
+
+        auto child = makePredicateKernel(expr.first(), metadata);
+        return child ? std::make_unique<NotKernel>(std::move(child)) : nullptr;
+    }
+
+    case OpCode::And:
+    case OpCode::Or: {
+        if (!isBinary(expr)) {
+            return nullptr;
+        }
+
+        auto lhs = makePredicateKernel(expr.first(), metadata);
+        auto rhs = makePredicateKernel(expr.second(), metadata);
+        if (!lhs || !rhs) {
+            return nullptr;
+        }
+
+        if (expr.opCode == OpCode::And) {
+            return std::make_unique<LogicalKernel<std::bit_and<>>>(std::move(lhs), std::move(rhs));
+        }
+        return std::make_unique<LogicalKernel<std::bit_or<>>>(std::move(lhs), std::move(rhs));
+    }
+
+    default:
+        if (!isBinary(expr)) {
+            return nullptr;
+        }
+
+        return dispatchComparison<R>(expr.opCode, [&](auto op) {
+            return dispatchOperands<R>(expr, metadata, false, [&](auto lhs, auto rhs) -> R {
+                using T = typename decltype(lhs)::Type;
+                return std::make_unique<ComparisonKernel<T, decltype(op)::value, decltype(lhs), decltype(rhs)>>(lhs, rhs);
+            });
+        });
+    }
+}
+
+void toSelectionVector(const std::vector<std::uint8_t>& mask, SelectionVector& sel)
+{
+    const std::size_t n = mask.size();
+    sel.resize(n);
+
+    // Indexes are written unconditionally and kept only for selected rows, which avoids
+    // mispredicted branches. Words of 8 unselected rows are skipped at once.
+    std::size_t numSelected = 0;
+    std::size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        std::uint64_t word;
+        std::memcpy(&word, mask.data() + i, sizeof(word));
+        if (word == 0) {
+            continue;
+        }
+
+        for (std::size_t k = i; k < i + 8; ++k) {
+            sel[numSelected] = k;
+            numSelected += mask[k] != 0;
+        }
+    }
+    for (; i < n; ++i) {
+        sel[numSelected] = i;
+        numSelected += mask[i] != 0;
+    }
+
+    sel.resize(numSelected);
+}
+
+} // namespace codein
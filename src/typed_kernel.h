@@ -0,0 +1,90 @@
+/**
+ * Copyright (C) 2021-present Codein Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify it under the terms of
+ * BSD-3-Clause License which can be found at the root directory of this repository.
+ */
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "batch.h"
+#include "expression.h"
+#include "metadata.h"
+
+#pragma once
+
+namespace codein {
+
+/**
+ * Typed kernels evaluate an expression over whole columns of a batch at once.
+ *
+ * A kernel is instantiated from templates for the operation and the column type chosen from
+ * metadata when the kernel is made, so no type is checked per row and loops over column values
+ * can be vectorized by the compiler. Only common shapes of expressions have kernels. Other
+ * expressions, and batches whose columns turn out not to have the expected types or have nulls,
+ * have to be evaluated row by row.
+ */
+
+/**
+ * @brief Kernel computing a column from columns of a batch.
+ */
+class ColumnKernel {
+public:
+    virtual ~ColumnKernel() = default;
+
+    /**
+     * @brief Evaluates the expression on every row of batch.
+     * 
+     * @param batch: input batch.
+     * @param out: receives the result.
+     * @return false if batch does not have the column types the kernel was made for. out is
+     * unspecified then.
+     */
+    virtual bool eval(const Batch& batch, Column& out) const = 0;
+};
+
+/**
+ * @brief Kernel evaluating a predicate on rows of a batch.
+ */
+class PredicateKernel {
+public:
+    virtual ~PredicateKernel() = default;
+
+    /**
+     * @brief Evaluates the predicate on every row of batch.
+     * 
+     * @param batch: input batch.
+     * @param mask: receives 1 for each row satisfying the predicate and 0 for the others.
+     * @return false if batch does not have the column types the kernel was made for. mask is
+     * unspecified then.
+     */
+    virtual bool eval(const Batch& batch, std::vector<std::uint8_t>& mask) const = 0;
+};
+
+/**
+ * @brief Makes a kernel for column references and arithmetic between a column and a column
+ * or a constant of the same numeric type.
+ * 
+ * @return nullptr if expr has no kernel.
+ */
+std::unique_ptr<ColumnKernel> makeColumnKernel(const Expression& expr, const Metadata& metadata);
+
+/**
+ * @brief Makes a kernel for comparisons between a column and a column or a constant of the same
+ * type, and for Not, And and Or of such comparisons.
+ * 
+ * @return nullptr if expr has no kernel.
+ */
+std::unique_ptr<PredicateKernel> makePredicateKernel(const Expression& expr, const Metadata& metadata);
+
+/**
+ * @brief Collects indexes of rows whose mask is non-zero.
+ * 
+ * @param mask: mask made by a PredicateKernel.
+ * @param sel: receives the indexes. Its storage is reused.
+ */
+void toSelectionVector(const std::vector<std::uint8_t>& mask, SelectionVector& sel);
+
+} // namespace codein
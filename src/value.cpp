@@ -0,0 +1,171 @@
+/**
+ * Copyright (C) 2021-present Codein Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify it under the terms of
+ * BSD-3-Clause License which can be found at the root directory of this repository.
+ */
+
+#include <any>
+#include <string>
+#include <type_traits>
+#include <typeindex>
+#include <utility>
+#include <variant>
+
+#include "any_visitor.h"
+#include "to_any_converter.h"
+#include "value.h"
+#include "value_ops.h"
+
+namespace codein {
+
+std::type_index Value::type() const
+{
+    return std::visit([](const auto& v) {
+        using T = std::decay_t<decltype(v)>;
+        if constexpr (std::is_same_v<T, std::monostate>) {
+            return tiVoid;
+        }
+        else {
+            return std::type_index(typeid(T));
+        }
+    }, v_);
+}
+
+Value toValue(const std::any& a)
+{
+    return visitAny(a, [](const auto& v) {
+        return Value(v);
+    });
+}
+
+Value toValue(std::any&& a)
+{
+    if (auto p = std::any_cast<std::string>(&a)) {
+        return Value(std::move(*p));
+    }
+
+    return toValue(static_cast<const std::any&>(a));
+}
+
+std::any toAny(const Value& v)
+{
+    return std::visit([](const auto& v) {
+        using T = std::decay_t<decltype(v)>;
+        if constexpr (std::is_same_v<T, std::monostate>) {
+            return std::any();
+        }
+        else {
+            return std::any(v);
+        }
+    }, v.variant());
+}
+
+std::any toAny(Value&& v)
+{
+    if (v.holds<std::string>()) {
+        return std::any(std::move(v.get<std::string>()));
+    }
+
+    return toAny(static_cast<const Value&>(v));
+}
+
+bool operator==(const Value& lhs, const Value& rhs)
+{
+    return applyBinary<bool>(lhs, rhs, EqOp());
+}
+
+bool operator!=(const Value& lhs, const Value& rhs)
+{
+    return !(lhs == rhs);
+}
+
+bool operator<(const Value& lhs, const Value& rhs)
+{
+    return applyBinary<bool>(lhs, rhs, LtOp());
+}
+
+bool operator<=(const Value& lhs, const Value& rhs)
+{
+    return applyBinary<bool>(lhs, rhs, LteOp());
+}
+
+bool operator>(const Value& lhs, const Value& rhs)
+{
+    return applyBinary<bool>(lhs, rhs, GtOp());
+}
+
+bool operator>=(const Value& lhs, const Value& rhs)
+{
+    return applyBinary<bool>(lhs, rhs, GteOp());
+}
+
+Value operator+(const Value& lhs, const Value& rhs)
+{
+    return applyBinary<Value>(lhs, rhs, AddOp());
+}
+
+Value operator-(const Value& lhs, const Value& rhs)
+{
+    return applyBinary<Value>(lhs, rhs, SubOp());
+}
+
+Value operator*(const Value& lhs, const Value& rhs)
+{
+    return applyBinary<Value>(lhs, rhs, MultOp());
+}
+
+Value operator/(const Value& lhs, const Value& rhs)
+{
+    return applyBinary<Value>(lhs, rhs, DivOp());
+}
+
+Value operator%(const Value& lhs, const Value& rhs)
+{
+    return applyBinary<Value>(lhs, rhs, ModOp());
+}
+
+bool asBool(const Value& v)
+{
+    if (const auto p = getIf<bool>(v); p != nullptr) {
+        return *p;
+    }
+
+    throw UnsupportedOperation();
+}
+
+bool notValue(const Value& lhs)
+{
+    return !asBool(lhs);
+}
+
+std::size_t hashValue(const Value& lhs)
+{
+    return applyUnary<std::size_t>(lhs, HashOp());
+}
+
+Value convertValue(const Value& lhs, const std::type_index& ti)
+{
+    if (ti == tiBool) {
+        return applyUnary<Value>(lhs, ConvertOp<bool>());
+    }
+    else if (ti == tiInt) {
+        return applyUnary<Value>(lhs, ConvertOp<int>());
+    }
+    else if (ti == tiUint) {
+        return applyUnary<Value>(lhs, ConvertOp<unsigned>());
+    }
+    else if (ti == tiFloat) {
+        return applyUnary<Value>(lhs, ConvertOp<float>());
+    }
+    else if (ti == tiDouble) {
+        return applyUnary<Value>(lhs, ConvertOp<double>());
+    }
+    else if (ti == tiString) {
+        return applyUnary<Value>(lhs, ConvertOp<std::string>());
+    }
+
+    throw UnsupportedOperation();
+}
+
+} // namespace codein
@@ -0,0 +1,115 @@
+/**
+ * Copyright (C) 2021-present Codein Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify it under the terms of
+ * BSD-3-Clause License which can be found at the root directory of this repository.
+ */
+
+#include <any>
+#include <cstddef>
+#include <string>
+#include <type_traits>
+#include <typeindex>
+#include <utility>
+#include <variant>
+
+#pragma once
+
+namespace codein {
+
+/**
+ * @brief Tagged value of one of the supported types: bool, int, unsigned, float, double and string.
+ *
+ * Value is used in the evaluation path instead of std::any so that operations dispatch on
+ * the tag of the variant instead of hashing type_index and calling through std::function.
+ * A default-constructed Value is null, which corresponds to an empty std::any.
+ */
+class Value {
+public:
+    using Variant = std::variant<std::monostate, bool, int, unsigned, float, double, std::string>;
+
+    Value() = default;
+    Value(const Value&) = default;
+    Value(Value&&) = default;
+
+    template <typename T>
+        requires std::is_constructible_v<Variant, T&&> && (!std::is_same_v<std::decay_t<T>, Value>)
+    Value(T&& v)
+        : v_(std::forward<T>(v))
+    {}
+
+    Value& operator=(const Value&) = default;
+    Value& operator=(Value&&) = default;
+
+    bool isNull() const
+    {
+        return std::holds_alternative<std::monostate>(v_);
+    }
+
+    template <typename T>
+    bool holds() const
+    {
+        return std::holds_alternative<T>(v_);
+    }
+
+    template <typename T>
+    const T& get() const
+    {
+        return std::get<T>(v_);
+    }
+
+    template <typename T>
+    T& get()
+    {
+        return std::get<T>(v_);
+    }
+
+    /// Type index of the held value. tiVoid for null.
+    std::type_index type() const;
+
+    const Variant& variant() const
+    {
+        return v_;
+    }
+
+    Variant& variant()
+    {
+        return v_;
+    }
+
+private:
+    Variant v_;
+};
+
+/// Converts std::any into Value. Throws UnsupportedOperation if the type is not supported.
+Value toValue(const std::any& a);
+Value toValue(std::any&& a);
+
+/// Converts Value into std::any. Null becomes an empty std::any.
+std::any toAny(const Value& v);
+std::any toAny(Value&& v);
+
+bool operator==(const Value& lhs, const Value& rhs);
+bool operator!=(const Value& lhs, const Value& rhs);
+bool operator<(const Value& lhs, const Value& rhs);
+bool operator<=(const Value& lhs, const Value& rhs);
+bool operator>(const Value& lhs, const Value& rhs);
+bool operator>=(const Value& lhs, const Value& rhs);
+
+Value operator+(const Value& lhs, const Value& rhs);
+Value operator-(const Value& lhs, const Value& rhs);
+Value operator*(const Value& lhs, const Value& rhs);
+Value operator/(const Value& lhs, const Value& rhs);
+Value operator%(const Value& lhs, const Value& rhs);
+
+bool notValue(const Value& lhs);
+
+/// Returns the bool held in v. Throws UnsupportedOperation if v is not a bool.
+bool asBool(const Value& v);
+
+std::size_t hashValue(const Value& lhs);
+
+/// Converts a value into the type ti. Throws UnsupportedOperation if the conversion is not supported.
+Value convertValue(const Value& lhs, const std::type_index& ti);
+
+} // namespace codein
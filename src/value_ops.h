@@ -0,0 +1,234 @@
+/**
+ * Copyright (C) 2021-present Codein Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify it under the terms of
+ * BSD-3-Clause License which can be found at the root directory of this repository.
+ */
+
+#include <any>
+#include <concepts>
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <type_traits>
+#include <variant>
+
+#include "any_visitor.h"
+#include "value.h"
+
+#pragma once
+
+namespace codein {
+
+/**
+ * Typed operations shared by the Value operators and the std::any operators.
+ * An operation is applicable to a type if its functor is invocable with that type.
+ * Dispatching to a non-applicable type or between different types throws UnsupportedOperation.
+ */
+
+template <typename T, typename... Ts>
+concept OneOf = (std::same_as<T, Ts> || ...);
+
+template <typename T>
+concept Orderable = OneOf<T, bool, int, unsigned, float, double, std::string>;
+
+template <typename T>
+concept Numeric = OneOf<T, int, unsigned, float, double>;
+
+template <typename T>
+concept Addable = Numeric<T> || std::same_as<T, std::string>;
+
+template <typename T>
+concept Integral = OneOf<T, int, unsigned>;
+
+template <template <typename> typename Op>
+struct CompOp {
+    // Two nulls are equal to each other but not ordered.
+    bool operator()(std::monostate, std::monostate) const
+        requires std::same_as<Op<int>, std::equal_to<int>>
+    {
+        return true;
+    }
+
+    template <Orderable T>
+    bool operator()(const T& lhs, const T& rhs) const
+    {
+        return Op<T>()(lhs, rhs);
+    }
+};
+
+using EqOp = CompOp<std::equal_to>;
+using LtOp = CompOp<std::less>;
+using LteOp = CompOp<std::less_equal>;
+using GtOp = CompOp<std::greater>;
+using GteOp = CompOp<std::greater_equal>;
+
+struct AddOp {
+    template <Addable T>
+    T operator()(const T& lhs, const T& rhs) const
+    {
+        return lhs + rhs;
+    }
+};
+
+struct SubOp {
+    template <Numeric T>
+    T operator()(const T& lhs, const T& rhs) const
+    {
+        return lhs - rhs;
+    }
+};
+
+struct MultOp {
+    template <Numeric T>
+    T operator()(const T& lhs, const T& rhs) const
+    {
+        return lhs * rhs;
+    }
+};
+
+struct DivOp {
+    template <Numeric T>
+    T operator()(const T& lhs, const T& rhs) const
+    {
+        return lhs / rhs;
+    }
+};
+
+struct ModOp {
+    template <Integral T>
+    T operator()(const T& lhs, const T& rhs) const
+    {
+        return lhs % rhs;
+    }
+};
+
+struct HashOp {
+    template <Orderable T>
+    std::size_t operator()(const T& lhs) const
+    {
+        return std::hash<T>()(lhs);
+    }
+};
+
+/**
+ * @brief Calls f with the value held in a as its native type, or std::monostate if a is empty.
+ * Throws UnsupportedOperation if a holds a type that is not supported.
+ */
+template <typename F>
+decltype(auto) visitAny(const std::any& a, F&& f)
+{
+    if (!a.has_value()) {
+        return f(std::monostate());
+    }
+    // any_cast to a pointer only compares the type manager of a, which is much cheaper
+    // than hashing type_index.
+    if (auto p = std::any_cast<int>(&a)) {
+        return f(*p);
+    }
+    if (auto p = std::any_cast<unsigned>(&a)) {
+        return f(*p);
+    }
+    if (auto p = std::any_cast<double>(&a)) {
+        return f(*p);
+    }
+    if (auto p = std::any_cast<std::string>(&a)) {
+        return f(*p);
+    }
+    if (auto p = std::any_cast<float>(&a)) {
+        return f(*p);
+    }
+    if (auto p = std::any_cast<bool>(&a)) {
+        return f(*p);
+    }
+
+    throw UnsupportedOperation();
+}
+
+template <typename T>
+const T* getIf(const Value& v)
+{
+    return std::get_if<T>(&v.variant());
+}
+
+template <typename T>
+const T* getIf(const std::any& a)
+{
+    if constexpr (std::is_same_v<T, std::monostate>) {
+        static const std::monostate null;
+        return a.has_value() ? nullptr : &null;
+    }
+    else {
+        return std::any_cast<T>(&a);
+    }
+}
+
+template <typename V, typename F>
+decltype(auto) visitOperand(const V& v, F&& f)
+{
+    if constexpr (std::is_same_v<V, Value>) {
+        return std::visit(std::forward<F>(f), v.variant());
+    }
+    else {
+        return visitAny(v, std::forward<F>(f));
+    }
+}
+
+/**
+ * @brief Applies a binary operation to two operands of the same type.
+ *
+ * @tparam R Result type. The result of op is converted into R.
+ * @tparam V Value or std::any
+ */
+template <typename R, typename Op, typename V>
+R applyBinary(const V& lhs, const V& rhs, Op op)
+{
+    return visitOperand(lhs, [&rhs, &op](const auto& l) -> R {
+        using T = std::decay_t<decltype(l)>;
+        if constexpr (std::is_invocable_v<Op, const T&, const T&>) {
+            if (const T* r = getIf<T>(rhs); r != nullptr) {
+                return R(op(l, *r));
+            }
+        }
+
+        throw UnsupportedOperation();
+    });
+}
+
+/**
+ * @brief Applies a unary operation to an operand.
+ */
+template <typename R, typename Op, typename V>
+R applyUnary(const V& lhs, Op op)
+{
+    return visitOperand(lhs, [&op](const auto& l) -> R {
+        using T = std::decay_t<decltype(l)>;
+        if constexpr (std::is_invocable_v<Op, const T&>) {
+            return R(op(l));
+        }
+        else {
+            throw UnsupportedOperation();
+        }
+    });
+}
+
+/**
+ * @brief Conversion from one supported type into another. Conversions from string,
+ * and into the same type, are not supported.
+ */
+template <typename U>
+struct ConvertOp {
+    template <typename T>
+        requires Orderable<T> && Orderable<U> && (!std::same_as<T, U>) && (!std::same_as<T, std::string>)
+    U operator()(const T& v) const
+    {
+        if constexpr (std::is_same_v<U, std::string>) {
+            return std::to_string(v);
+        }
+        else {
+            return static_cast<U>(v);
+        }
+    }
+};
+
+} // namespace codein
@@ -0,0 +1,264 @@
+/**
+ * Copyright (C) 2021-present Codein Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify it under the terms of
+ * BSD-3-Clause License which can be found at the root directory of this repository.
+ */
+
+#include <any>
+#include <optional>
+#include <string>
+#include <typeindex>
+#include <utility>
+#include <variant>
+#include <vector>
+
+#include "any_visitor.h"
+#include "zone_map.h"
+
+namespace codein {
+
+namespace {
+
+// Index of the column referred by expr. nullopt if expr is not a Ref to a column in metadata.
+std::optional<std::size_t> refIndex(const Expression& expr, const Metadata& metadata)
+{
+    if (expr.opCode != OpCode::Ref || !std::holds_alternative<std::any>(expr.leafOrChildren)) {
+        return std::nullopt;
+    }
+
+    const auto name = std::any_cast<std::string>(&expr.leaf());
+    if (name == nullptr) {
+        return std::nullopt;
+    }
+
+    auto [found, i] = metadata.find(*name);
+    if (!found) {
+        return std::nullopt;
+    }
+
+    return i;
+}
+
+// Value of a constant expression. nullptr if expr is not a constant.
+const std::any* constValue(const Expression& expr)
+{
+    if (expr.opCode != OpCode::Const || !std::holds_alternative<std::any>(expr.leafOrChildren)) {
+        return nullptr;
+    }
+
+    return &expr.leaf();
+}
+
+bool isComparison(OpCode opCode)
+{
+    switch (opCode) {
+    case OpCode::Eq:
+    case OpCode::Neq:
+    case OpCode::Lt:
+    case OpCode::Lte:
+    case OpCode::Gt:
+    case OpCode::Gte:
+        return true;
+
+    default:
+        return false;
+    }
+}
+
+// Comparison equivalent to a op b as b op' a.
+OpCode swapOperands(OpCode opCode)
+{
+    switch (opCode) {
+    case OpCode::Lt:
+        return OpCode::Gt;
+    case OpCode::Lte:
+        return OpCode::Gte;
+    case OpCode::Gt:
+        return OpCode::Lt;
+    case OpCode::Gte:
+        return OpCode::Lte;
+    default:
+        return opCode;
+    }
+}
+
+// Comparison equivalent to Not (a op b) unless a or b is NaN.
+OpCode negate(OpCode opCode)
+{
+    switch (opCode) {
+    case OpCode::Eq:
+        return OpCode::Neq;
+    case OpCode::Neq:
+        return OpCode::Eq;
+    case OpCode::Lt:
+        return OpCode::Gte;
+    case OpCode::Lte:
+        return OpCode::Gt;
+    case OpCode::Gt:
+        return OpCode::Lte;
+    case OpCode::Gte:
+        return OpCode::Lt;
+    default:
+        return opCode;
+    }
+}
+
+bool isBinary(const Expression& expr)
+{
+    return std::holds_alternative<std::vector<Expression>>(expr.leafOrChildren) && expr.children().size() == 2;
+}
+
+}
+
+ZoneMap::ZoneMap(const Expression& filterExpr, const Metadata& metadata)
+    : root_(analyze(filterExpr, metadata, false))
+{}
+
+ZoneMap::Node ZoneMap::analyze(const Expression& expr, const Metadata& metadata, bool negated)
+{
+    const Node unknown{Kind::Unknown, OpCode::Noop, 0, Value(), {}};
+
+    switch (expr.opCode) {
+    case OpCode::Const: {
+        const auto value = constValue(expr);
+        const auto b = value != nullptr ? std::any_cast<bool>(value) : nullptr;
+        if (b == nullptr || *b != negated) {
+            return unknown;
+        }
+        return Node{Kind::False, OpCode::Noop, 0, Value(), {}};
+    }
+
+    case OpCode::Not:
+        if (!std::holds_alternative<std::vector<Expression>>(expr.leafOrChildren) || expr.children().size() != 1) {
+            return unknown;
+        }
+        return analyze(expr.first(), metadata, !negated);
+
+    case OpCode::And:
+    case OpCode::Or: {
+        if (!isBinary(expr)) {
+            return unknown;
+        }
+
+        // Not (a And b) is (Not a) Or (Not b), and vice versa.
+        const bool isAnd = (expr.opCode == OpCode::And) != negated;
+        Node node{isAnd ? Kind::And : Kind::Or, OpCode::Noop, 0, Value(), {}};
+        for (const auto& child: expr.children()) {
+            auto childNode = analyze(child, metadata, negated);
+            // Unknown passes any row, and False passes none.
+            if (childNode.kind == (isAnd ? Kind::False : Kind::Unknown)) {
+                return childNode;
+            }
+            if (childNode.kind != (isAnd ? Kind::Unknown : Kind::False)) {
+                node.children.push_back(std::move(childNode));
+            }
+        }
+
+        if (node.children.empty()) {
+            return Node{isAnd ? Kind::Unknown : Kind::False, OpCode::Noop, 0, Value(), {}};
+        }
+        if (node.children.size() == 1) {
+            return std::move(node.children[0]);
+        }
+        return node;
+    }
+
+    default:
+        if (isComparison(expr.opCode) && isBinary(expr)) {
+            return analyzeCompare(expr, metadata, negated);
+        }
+        return unknown;
+    }
+}
+
+ZoneMap::Node ZoneMap::analyzeCompare(const Expression& expr, const Metadata& metadata, bool negated)
+{
+    const Node unknown{Kind::Unknown, OpCode::Noop, 0, Value(), {}};
+
+    auto opCode = expr.opCode;
+    auto col = refIndex(expr.first(), metadata);
+    auto constant = constValue(expr.second());
+    if (!col || constant == nullptr) {
+        col = refIndex(expr.second(), metadata);
+        constant = constValue(expr.first());
+        opCode = swapOperands(opCode);
+    }
+
+    // Comparisons between different types fail on evaluation, and are left to the filter.
+    if (!col || constant == nullptr || std::type_index(constant->type()) != metadata[*col].typeIndex) {
+        return unknown;
+    }
+
+    // NaN fails every comparison but Neq, so neither Neq nor a negated comparison rules out
+    // rows of NaN, which are not counted in the minimum and maximum.
+    const auto ti = metadata[*col].typeIndex;
+    const bool floating = ti == tiFloat || ti == tiDouble;
+    if (negated) {
+        if (floating) {
+            return unknown;
+        }
+        opCode = negate(opCode);
+    }
+    if (opCode == OpCode::Neq && floating) {
+        return unknown;
+    }
+
+    return Node{Kind::Compare, opCode, *col, toValue(*constant), {}};
+}
+
+bool ZoneMap::mayMatch(const Node& node, const std::vector<ColumnChunkInfo>& columns)
+{
+    switch (node.kind) {
+    case Kind::Unknown:
+        return true;
+
+    case Kind::False:
+        return false;
+
+    case Kind::And:
+        for (const auto& child: node.children) {
+            if (!mayMatch(child, columns)) {
+                return false;
+            }
+        }
+        return true;
+
+    case Kind::Or:
+        for (const auto& child: node.children) {
+            if (mayMatch(child, columns)) {
+                return true;
+            }
+        }
+        return false;
+
+    case Kind::Compare:
+        break;
+    }
+
+    // Every value is null or NaN if there is no minimum.
+    const auto& chunk = columns[node.col];
+    if (chunk.min.isNull()) {
+        return false;
+    }
+
+    const auto& c = node.constant;
+    switch (node.opCode) {
+    case OpCode::Eq:
+        return chunk.min <= c && c <= chunk.max;
+    case OpCode::Neq:
+        return !(chunk.min == c && chunk.max == c);
+    case OpCode::Lt:
+        return chunk.min < c;
+    case OpCode::Lte:
+        return chunk.min <= c;
+    case OpCode::Gt:
+        return chunk.max > c;
+    case OpCode::Gte:
+        return chunk.max >= c;
+    default:
+        return true;
+    }
+}
+
+} // namespace codein
@@ -0,0 +1,83 @@
+/**
+ * Copyright (C) 2021-present Codein Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify it under the terms of
+ * BSD-3-Clause License which can be found at the root directory of this repository.
+ */
+
+#include <cstddef>
+#include <vector>
+
+#include "columnar_file.h"
+#include "expression.h"
+#include "metadata.h"
+#include "value.h"
+
+#pragma once
+
+namespace codein {
+
+/**
+ * @brief Filter expression analyzed against the minimum and maximum values of column chunks,
+ * also known as a zone map, to find row groups where no row can pass the filter.
+ *
+ * Comparisons between a column and a constant of the column type, And, Or, Not and bool
+ * constants are analyzed. Any other part of the filter may pass any row. Rows whose compared
+ * value is null never pass a comparison, and neither do NaN floating point values except for
+ * Neq, which is therefore not analyzed on floating point columns.
+ */
+class ZoneMap {
+public:
+    /**
+     * @brief Analyzes filterExpr for rows described by metadata. Never throws.
+     */
+    ZoneMap(const Expression& filterExpr, const Metadata& metadata);
+
+    /**
+     * @brief Checks if a row group may have rows passing the filter.
+     *
+     * @param columns: statistics of the column chunks of the row group, one per column of metadata.
+     * @return false if no row of the row group can pass the filter.
+     */
+    bool mayMatch(const std::vector<ColumnChunkInfo>& columns) const
+    {
+        return mayMatch(root_, columns);
+    }
+
+    /// Whether any row group can be ruled out by the filter.
+    bool canPrune() const
+    {
+        return root_.kind != Kind::Unknown;
+    }
+
+private:
+    enum class Kind {
+        // May pass any row.
+        Unknown,
+        // Passes no row.
+        False,
+        And,
+        Or,
+        // Comparison of column col with constant in the form of col op constant.
+        Compare,
+    };
+
+    struct Node {
+        Kind kind;
+        OpCode opCode;
+        std::size_t col;
+        Value constant;
+        std::vector<Node> children;
+    };
+
+    // Analyzes expr, or Not expr if negated.
+    static Node analyze(const Expression& expr, const Metadata& metadata, bool negated);
+
+    static Node analyzeCompare(const Expression& expr, const Metadata& metadata, bool negated);
+
+    static bool mayMatch(const Node& node, const std::vector<ColumnChunkInfo>& columns);
+
+    Node root_;
+};
+
+} // namespace codein
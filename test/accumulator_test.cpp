@@ -0,0 +1,131 @@
+/**
+ * Copyright (C) 2021-present Codein Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify it under the terms of
+ * BSD-3-Clause License which can be found at the root directory of this repository.
+ */
+
+#include <any>
+#include <gtest/gtest.h>
+#include <string>
+#include <vector>
+
+#include "accumulator.h"
+#include "any_visitor.h"
+#include "metadata.h"
+
+using namespace std;
+using namespace codein;
+
+namespace {
+
+Metadata makeMetadata()
+{
+    return {{"i", tiInt}, {"d", tiDouble}, {"s", tiString}};
+}
+
+// Accumulates rows into a state of acc, half of them in a partial state merged at the end.
+any aggregate(const Accumulator& acc, const vector<vector<any>>& rows)
+{
+    vector<any> state(acc.numStates());
+    vector<any> partial(acc.numStates());
+    for (size_t r = 0; r < rows.size(); ++r) {
+        acc.update(r % 2 == 0 ? state.data() : partial.data(), rows[r]);
+    }
+    acc.merge(state.data(), partial.data());
+
+    return acc.finish(state.data());
+}
+
+}
+
+TEST(AccumulatorTests, BasicTest)
+{
+    const auto metadata = makeMetadata();
+    const vector<vector<any>> rows{
+        {3, 1.5, "b"s},
+        {-2, any(), "c"s},
+        {7, 4.0, any()},
+        {any(), -0.5, "a"s},
+        {1, 2.0, "bb"s},
+    };
+
+    auto make = [&](AggregateFunction function, const string& column) {
+        return makeAccumulator(AggregateSpec{function, column, "out"}, metadata);
+    };
+
+    EXPECT_EQ(any_cast<unsigned>(aggregate(*make(AggregateFunction::Count, ""), rows)), 5u);
+    EXPECT_EQ(any_cast<unsigned>(aggregate(*make(AggregateFunction::Count, "d"), rows)), 4u);
+    EXPECT_EQ(any_cast<int>(aggregate(*make(AggregateFunction::Sum, "i"), rows)), 9);
+    EXPECT_EQ(any_cast<double>(aggregate(*make(AggregateFunction::Sum, "d"), rows)), 7.0);
+    EXPECT_EQ(any_cast<int>(aggregate(*make(AggregateFunction::Min, "i"), rows)), -2);
+    EXPECT_EQ(any_cast<int>(aggregate(*make(AggregateFunction::Max, "i"), rows)), 7);
+    EXPECT_EQ(any_cast<string>(aggregate(*make(AggregateFunction::Min, "s"), rows)), "a");
+    EXPECT_EQ(any_cast<string>(aggregate(*make(AggregateFunction::Max, "s"), rows)), "c");
+    EXPECT_DOUBLE_EQ(any_cast<double>(aggregate(*make(AggregateFunction::Avg, "i"), rows)), 9.0 / 4);
+    EXPECT_DOUBLE_EQ(any_cast<double>(aggregate(*make(AggregateFunction::Avg, "d"), rows)), 7.0 / 4);
+
+    EXPECT_TRUE(make(AggregateFunction::Sum, "d")->outputType() == tiDouble);
+    EXPECT_TRUE(make(AggregateFunction::Max, "s")->outputType() == tiString);
+    EXPECT_TRUE(make(AggregateFunction::Count, "s")->outputType() == tiUint);
+    EXPECT_TRUE(make(AggregateFunction::Avg, "i")->outputType() == tiDouble);
+
+    // Aggregates of only nulls are null, except counts.
+    const vector<vector<any>> nulls{{any(), any(), any()}};
+    EXPECT_FALSE(aggregate(*make(AggregateFunction::Sum, "i"), nulls).has_value());
+    EXPECT_FALSE(aggregate(*make(AggregateFunction::Min, "s"), nulls).has_value());
+    EXPECT_FALSE(aggregate(*make(AggregateFunction::Avg, "d"), nulls).has_value());
+    EXPECT_EQ(any_cast<unsigned>(aggregate(*make(AggregateFunction::Count, "i"), nulls)), 0u);
+}
+
+TEST(AccumulatorTests, ApproxCountDistinctTest)
+{
+    const auto metadata = makeMetadata();
+    auto acc = makeAccumulator({AggregateFunction::ApproxCountDistinct, "s", "out"}, metadata);
+    EXPECT_TRUE(acc->outputType() == tiUint);
+
+    vector<vector<any>> rows;
+    for (int i = 0; i < 30000; ++i) {
+        rows.push_back({i, 1.0, "v"s + to_string(i % 10000)});
+    }
+    rows.push_back({0, 1.0, any()});
+
+    const auto estimate = any_cast<unsigned>(aggregate(*acc, rows));
+    EXPECT_NEAR(estimate, 10000, 200);
+
+    EXPECT_EQ(any_cast<unsigned>(aggregate(*acc, {{0, 1.0, any()}})), 0u);
+}
+
+TEST(AccumulatorTests, ApproxQuantileTest)
+{
+    const auto metadata = makeMetadata();
+    auto p50 = makeAccumulator({AggregateFunction::ApproxQuantile, "i", "p50", 0.5}, metadata);
+    auto p99 = makeAccumulator({AggregateFunction::ApproxQuantile, "d", "p99", 0.99}, metadata);
+    EXPECT_TRUE(p50->outputType() == tiDouble);
+
+    vector<vector<any>> rows;
+    for (int i = 1; i <= 10000; ++i) {
+        rows.push_back({i, i / 100.0, any()});
+    }
+    rows.push_back({any(), any(), any()});
+
+    EXPECT_NEAR(any_cast<double>(aggregate(*p50, rows)), 5000, 50);
+    EXPECT_NEAR(any_cast<double>(aggregate(*p99, rows)), 99, 0.1);
+
+    EXPECT_FALSE(aggregate(*p50, {{any(), any(), any()}}).has_value());
+}
+
+TEST(AccumulatorTests, FailTest)
+{
+    const auto metadata = makeMetadata();
+
+    EXPECT_THROW(makeAccumulator({AggregateFunction::Sum, "x", "out"}, metadata), UnknownName);
+    EXPECT_THROW(makeAccumulator({AggregateFunction::Sum, "s", "out"}, metadata), UnsupportedOperation);
+    EXPECT_THROW(makeAccumulator({AggregateFunction::Avg, "s", "out"}, metadata), UnsupportedOperation);
+    EXPECT_THROW(makeAccumulator({AggregateFunction::ApproxQuantile, "s", "out"}, metadata), UnsupportedOperation);
+    EXPECT_THROW(makeAccumulator({AggregateFunction::ApproxQuantile, "d", "out", 1.5}, metadata), UnsupportedOperation);
+
+    auto acc = makeAccumulator({AggregateFunction::Sum, "i", "out"}, metadata);
+    any state;
+    EXPECT_THROW(acc->update(&state, {1.0, 1.0, "a"s}), UnsupportedOperation);
+}
@@ -120,11 +120,9 @@ TEST(AnyConverterTests, FailureCases)
     EXPECT_FALSE(val.has_value());
     EXPECT_THROW(any_cast<unsigned>(val), bad_any_cast);
 
-    /* TODO: implement this behavior
     val = convertTo(tiUint, "-1");
     EXPECT_FALSE(val.has_value());
     EXPECT_THROW(any_cast<unsigned>(val), bad_any_cast);
-    */
 
     val = convertTo(type_index(typeid(long double)), "1");
     EXPECT_FALSE(val.has_value());
@@ -0,0 +1,156 @@
+/**
+ * Copyright (C) 2021-present Codein Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify it under the terms of
+ * BSD-3-Clause License which can be found at the root directory of this repository.
+ */
+
+#include <any>
+#include <gtest/gtest.h>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "any_visitor.h"
+#include "batch.h"
+#include "batch_row_adapter.h"
+#include "iterator.h"
+#include "metadata.h"
+#include "mock_scanner.h"
+#include "util.h"
+
+using namespace std;
+using namespace codein;
+
+TEST(BatchTests, ColumnTest)
+{
+    Column untyped;
+    EXPECT_EQ(untyped.type(), tiVoid);
+
+    // An untyped column adopts the type of its first value.
+    untyped.append(any(1));
+    untyped.append(any(2));
+    EXPECT_EQ(untyped.type(), tiInt);
+    EXPECT_EQ(untyped.size(), 2);
+    EXPECT_EQ(untyped.values<int>(), (vector<int>{1, 2}));
+    EXPECT_THROW(untyped.append(any(1u)), UnsupportedOperation);
+
+    Column strs(tiString);
+    EXPECT_EQ(strs.type(), tiString);
+    strs.append(any("a"s));
+    strs.append(nullany);
+    strs.append(any("c"s));
+    EXPECT_FALSE(strs.isNull(0));
+    EXPECT_TRUE(strs.isNull(1));
+    EXPECT_EQ(any_cast<string>(strs.at(2)), "c"s);
+    EXPECT_FALSE(strs.at(1).has_value());
+
+    strs.select({1, 2});
+    EXPECT_EQ(strs.size(), 2);
+    EXPECT_TRUE(strs.isNull(0));
+    EXPECT_EQ(any_cast<string>(strs.at(1)), "c"s);
+
+    Column bools(tiBool);
+    bools.append(any(true));
+    bools.append(any(false));
+    EXPECT_TRUE(bools.at(0).type() == typeid(bool));
+    EXPECT_FALSE(any_cast<bool>(bools.at(1)));
+
+    // Nulls appended before the first value are kept when the column gets typed.
+    Column late;
+    late.append(nullany);
+    late.append(any(1.5));
+    EXPECT_EQ(late.type(), tiDouble);
+    EXPECT_TRUE(late.isNull(0));
+    EXPECT_EQ(any_cast<double>(late.at(1)), 1.5);
+}
+
+TEST(BatchTests, BatchTest)
+{
+    Metadata metadata{
+        {"a", tiInt}, {"b", tiString},
+    };
+
+    Batch batch(metadata);
+    EXPECT_TRUE(batch.empty());
+    EXPECT_EQ(batch.numColumns(), 2);
+    EXPECT_EQ(batch.column(0).type(), tiInt);
+    EXPECT_EQ(batch.column(1).type(), tiString);
+
+    vector<any> row{1, "one"s};
+    batch.appendRow(row);
+    batch.appendRow(vector<any>{2, "two"s});
+    batch.appendRow(vector<any>{3, "three"s});
+    EXPECT_EQ(batch.numRows(), 3);
+
+    auto r = batch.row(1);
+    EXPECT_EQ(any_cast<int>(r[0]), 2);
+    EXPECT_EQ(any_cast<string>(r[1]), "two"s);
+
+    batch.select({0, 2});
+    EXPECT_EQ(batch.numRows(), 2);
+    batch.readRow(1, r);
+    EXPECT_EQ(any_cast<int>(r[0]), 3);
+    EXPECT_EQ(any_cast<string>(r[1]), "three"s);
+
+    batch.truncate(1);
+    EXPECT_EQ(batch.numRows(), 1);
+    EXPECT_EQ(batch.column(1).values<string>(), vector<string>{"one"s});
+
+    batch.clear();
+    EXPECT_TRUE(batch.empty());
+    EXPECT_EQ(batch.column(0).type(), tiInt);
+}
+
+struct BatchIteratorTests : public ::testing::Test {
+    Metadata metadata{
+        {"a", tiString}, {"b", tiUint}, {"c", tiInt}
+    };
+
+    vector<string> lines{
+        "string1, 1, -1",
+        "string2, 2, -2",
+        "string3, 3, -3",
+        "string4, 4, -4",
+        "string5, 5, -5",
+    };
+
+    vector<vector<any>> expectedFields{
+        {"string1"s, 1u, -1},
+        {"string2"s, 2u, -2},
+        {"string3"s, 3u, -3},
+        {"string4"s, 4u, -4},
+        {"string5"s, 5u, -5},
+    };
+};
+
+TEST_F(BatchIteratorTests, DefaultProcessNextBatchTest)
+{
+    // MockScanner does not override processNextBatch().
+    verifyIteratorBatchOutput(expectedFields, makeIterator<MockScanner>(metadata, lines), 2);
+    verifyIteratorBatchOutput(expectedFields, makeIterator<MockScanner>(metadata, lines), kDefaultBatchSize);
+}
+
+TEST_F(BatchIteratorTests, RowAdapterTest)
+{
+    auto adapter = makeIterator<BatchRowAdapter>(makeIterator<MockScanner>(metadata, lines), 2);
+    EXPECT_TRUE(adapter->getMetadata() == metadata);
+    verifyIteratorOutput(expectedFields, adapter);
+
+    // Rows buffered by processNext() are handed out first by processNextBatch().
+    adapter = makeIterator<BatchRowAdapter>(makeIterator<MockScanner>(metadata, lines), 3);
+    adapter->open();
+    auto row = adapter->processNext();
+    EXPECT_EQ(any_cast<string>(row.value()[0]), "string1"s);
+
+    auto batch = adapter->processNextBatch();
+    EXPECT_EQ(batch->numRows(), 2);
+    EXPECT_EQ(any_cast<string>(batch->column(0).at(1)), "string3"s);
+
+    batch = adapter->processNextBatch();
+    EXPECT_EQ(batch->numRows(), 2);
+    EXPECT_EQ(any_cast<string>(batch->column(0).at(1)), "string5"s);
+
+    EXPECT_FALSE(adapter->hasNext());
+    EXPECT_TRUE(adapter->processNextBatch() == std::nullopt);
+}
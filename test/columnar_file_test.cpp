@@ -0,0 +1,261 @@
+/**
+ * Copyright (C) 2021-present Codein Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify it under the terms of
+ * BSD-3-Clause License which can be found at the root directory of this repository.
+ */
+
+#include <any>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <gtest/gtest.h>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "any_visitor.h"
+#include "columnar_file.h"
+#include "columnar_file_scanner.h"
+#include "csv_file_scanner.h"
+#include "iterator.h"
+#include "mapped_file.h"
+#include "metadata.h"
+#include "mock_scanner.h"
+#include "util.h"
+#include "zone_map.h"
+
+using namespace std;
+using namespace codein;
+
+class ColumnarFileTests : public ::testing::Test {
+protected:
+    void SetUp() override
+    {
+        for (int i = 0; i < 3000; ++i) {
+            expectedFields.push_back({
+                i % 2 == 1,
+                i - 1000,
+                unsigned(i / 500),
+                i % 11 == 0 ? any() : any(float(i * 0.5)),
+                i * 0.25,
+                i % 7 == 0 ? any() : any("name"s + to_string(i / 100)),
+            });
+        }
+    }
+
+    // Writes expectedFields in batches of 500 rows.
+    void writeRows(const ColumnarWriteOptions& options)
+    {
+        ColumnarFileWriter writer(fileName, metadata, options);
+        Batch batch(metadata.size());
+        for (const auto& row: expectedFields) {
+            batch.appendRow(row);
+            if (batch.numRows() == 500) {
+                writer.write(batch);
+                batch = Batch(metadata.size());
+            }
+        }
+        writer.write(batch);
+        writer.close();
+    }
+
+    void TearDown() override
+    {
+        filesystem::remove(fileName);
+    }
+
+    const string fileName = (filesystem::temp_directory_path() / "falcon_columnar_test.col").string();
+    Metadata metadata{
+        {"b", tiBool}, {"i", tiInt}, {"u", tiUint}, {"f", tiFloat}, {"d", tiDouble}, {"s", tiString}};
+    vector<vector<any>> expectedFields;
+};
+
+TEST_F(ColumnarFileTests, RoundTripTest)
+{
+    for (const auto& options: {
+        ColumnarWriteOptions{},
+        ColumnarWriteOptions{.rowGroupSize = 1000, .compress = false},
+        ColumnarWriteOptions{.rowGroupSize = 1},
+    }) {
+        writeRows(options);
+
+        auto scanner = makeIterator<ColumnarFileScanner>(fileName);
+        EXPECT_TRUE(scanner->getMetadata() == metadata);
+        EXPECT_FALSE(scanner->hasNext());
+        verifyIteratorOutput(expectedFields, scanner);
+        verifyIteratorBatchOutput(expectedFields, scanner, 700);
+    }
+}
+
+TEST_F(ColumnarFileTests, SignedZeroTest)
+{
+    // Runs of 0.0 and -0.0 are kept apart, so that both are read back as written.
+    const Metadata zeroMetadata{{"f", tiFloat}, {"d", tiDouble}};
+    Batch batch(zeroMetadata.size());
+    for (int i = 0; i < 8; ++i) {
+        batch.appendRow({i < 4 ? 0.0f : -0.0f, i < 4 ? 0.0 : -0.0});
+    }
+
+    ColumnarFileWriter writer(fileName, zeroMetadata, ColumnarWriteOptions{.compress = true});
+    writer.write(batch);
+    writer.close();
+
+    {
+        MappedFile file(fileName);
+        const auto footer = readColumnarFooter(file.data());
+        ASSERT_EQ(footer.rowGroups.size(), 1);
+        EXPECT_EQ(footer.rowGroups[0].columns[0].encoding, ColumnEncoding::RunLength);
+        EXPECT_EQ(footer.rowGroups[0].columns[1].encoding, ColumnEncoding::RunLength);
+    }
+
+    auto scanner = makeIterator<ColumnarFileScanner>(fileName);
+    scanner->open();
+    int i = 0;
+    while (auto row = scanner->processNext()) {
+        EXPECT_EQ(signbit(any_cast<float>((*row)[0])), i >= 4) << i;
+        EXPECT_EQ(signbit(any_cast<double>((*row)[1])), i >= 4) << i;
+        ++i;
+    }
+    EXPECT_EQ(i, 8);
+}
+
+TEST_F(ColumnarFileTests, ProjectionTest)
+{
+    writeRows({});
+
+    auto scanner = makeIterator<ColumnarFileScanner>(fileName, vector<string>{"s", "i"});
+    EXPECT_TRUE(scanner->getMetadata() == (Metadata{{"s", tiString}, {"i", tiInt}}));
+
+    vector<vector<any>> projected;
+    for (const auto& row: expectedFields) {
+        projected.push_back({row[5], row[1]});
+    }
+    verifyIteratorBatchOutput(projected, scanner, kDefaultBatchSize);
+
+    EXPECT_THROW(makeIterator<ColumnarFileScanner>(fileName, vector<string>{"x"}), UnknownName);
+}
+
+TEST_F(ColumnarFileTests, FooterTest)
+{
+    writeRows({.rowGroupSize = 1000});
+
+    MappedFile file(fileName);
+    const auto footer = readColumnarFooter(file.data());
+    EXPECT_TRUE(footer.metadata == metadata);
+    ASSERT_EQ(footer.rowGroups.size(), 3);
+
+    const auto& rowGroup = footer.rowGroups[1];
+    EXPECT_EQ(rowGroup.numRows, 1000);
+    EXPECT_EQ(rowGroup.columns[1].min, Value(0));
+    EXPECT_EQ(rowGroup.columns[1].max, Value(999));
+    EXPECT_EQ(rowGroup.columns[1].nullCount, 0);
+    EXPECT_EQ(rowGroup.columns[1].encoding, ColumnEncoding::Plain);
+    EXPECT_EQ(rowGroup.columns[0].min, Value(false));
+    EXPECT_EQ(rowGroup.columns[0].max, Value(true));
+    // Rows 1000 to 1999 have u of 2 and 3, which are run-length encoded.
+    EXPECT_EQ(rowGroup.columns[2].min, Value(2u));
+    EXPECT_EQ(rowGroup.columns[2].max, Value(3u));
+    EXPECT_EQ(rowGroup.columns[2].encoding, ColumnEncoding::RunLength);
+    EXPECT_EQ(rowGroup.columns[5].min, Value("name10"s));
+    EXPECT_EQ(rowGroup.columns[5].max, Value("name19"s));
+    EXPECT_EQ(rowGroup.columns[5].nullCount, 143);
+    EXPECT_EQ(rowGroup.columns[5].encoding, ColumnEncoding::RunLength);
+}
+
+TEST_F(ColumnarFileTests, IteratorTest)
+{
+    Metadata csvMetadata{{"a", tiString}, {"b", tiUint}, {"c", tiInt}};
+    vector<string> lines{
+        "string1, 1, -1",
+        "string2, 2, ",
+        "string3, 3, -3",
+    };
+
+    auto child = makeIterator<MockScanner>(csvMetadata, lines);
+    EXPECT_EQ(writeColumnarFile(*child, fileName), lines.size());
+
+    auto scanner = makeIterator<ColumnarFileScanner>(fileName);
+    EXPECT_TRUE(scanner->getMetadata() == csvMetadata);
+    verifyIteratorOutput({
+        {"string1"s, 1u, -1},
+        {"string2"s, 2u, any()},
+        {"string3"s, 3u, -3},
+    }, scanner);
+}
+
+TEST_F(ColumnarFileTests, FailTest)
+{
+    EXPECT_THROW(makeIterator<ColumnarFileScanner>("nonexistent.col"), NonExistentFile);
+
+    {
+        ofstream out(fileName);
+        out << "a,b,c\n1,2,3\n";
+    }
+    EXPECT_THROW(makeIterator<ColumnarFileScanner>(fileName), InvalidColumnarFile);
+
+    EXPECT_THROW(ColumnarFileWriter(fileName, Metadata{{"v", tiVoid}}), UnsupportedOperation);
+}
+
+TEST_F(ColumnarFileTests, FilterTest)
+{
+    writeRows({.rowGroupSize = 1000});
+
+    // 500 <= i And i < 700 And b, where i is not output.
+    Expression filterExpr{
+        .opCode = OpCode::And,
+        .leafOrChildren = vector<Expression>{
+            {
+                .opCode = OpCode::And,
+                .leafOrChildren = vector<Expression>{
+                    {
+                        .opCode = OpCode::Lte,
+                        .leafOrChildren = vector<Expression>{
+                            {.opCode = OpCode::Const, .leafOrChildren = any(500)},
+                            {.opCode = OpCode::Ref, .leafOrChildren = any("i"s)},
+                        }
+                    },
+                    {
+                        .opCode = OpCode::Lt,
+                        .leafOrChildren = vector<Expression>{
+                            {.opCode = OpCode::Ref, .leafOrChildren = any("i"s)},
+                            {.opCode = OpCode::Const, .leafOrChildren = any(700)},
+                        }
+                    },
+                }
+            },
+            {.opCode = OpCode::Ref, .leafOrChildren = any("b"s)},
+        }
+    };
+
+    // Only the row group of i from 0 to 999 may have rows passing the filter.
+    MappedFile file(fileName);
+    ZoneMap zoneMap(filterExpr, metadata);
+    vector<bool> mayMatch;
+    for (const auto& rowGroup: readColumnarFooter(file.data()).rowGroups) {
+        mayMatch.push_back(zoneMap.mayMatch(rowGroup.columns));
+    }
+    EXPECT_EQ(mayMatch, (vector<bool>{false, true, false}));
+
+    vector<vector<any>> expected;
+    for (int i = 1501; i < 1700; i += 2) {
+        expected.push_back({expectedFields[i][2], expectedFields[i][0]});
+    }
+
+    auto scanner = makeIterator<ColumnarFileScanner>(fileName, vector<string>{"u", "b"}, filterExpr);
+    EXPECT_TRUE(scanner->getMetadata() == (Metadata{{"u", tiUint}, {"b", tiBool}}));
+    verifyIteratorOutput(expected, scanner);
+    verifyIteratorBatchOutput(expected, scanner, 30);
+
+    // No row passes i > 5000.
+    Expression noPassExpr{
+        .opCode = OpCode::Gt,
+        .leafOrChildren = vector<Expression>{
+            {.opCode = OpCode::Ref, .leafOrChildren = any("i"s)},
+            {.opCode = OpCode::Const, .leafOrChildren = any(5000)},
+        }
+    };
+    scanner = makeIterator<ColumnarFileScanner>(fileName, vector<string>{}, noPassExpr);
+    scanner->open();
+    EXPECT_FALSE(scanner->hasNext());
+}
@@ -5,7 +5,10 @@
  * BSD-3-Clause License which can be found at the root directory of this repository.
  */
 
+#include <filesystem>
+#include <fstream>
 #include <gtest/gtest.h>
+#include <string_view>
 
 #include "any_visitor.h"
 #include "csv_file_scanner.h"
@@ -944,3 +947,291 @@ TEST(CsvFileScannerTests, UnorderedProjectionsTest)
         makeIterator<CsvFileScanner>("fileScanner_filter_test.txt", "fileScanner_filter_test.csv", kAlwaysTrue, projections)
     );
 }
+
+TEST(CsvFileScannerTests, BatchTest)
+{
+    // c >= 3
+    Expression filterExpr {
+        .opCode = OpCode::Gte,
+        .leafOrChildren = vector<Expression>{
+            {.opCode = OpCode::Ref, .leafOrChildren = std::any("c"s)},
+            {.opCode = OpCode::Const, .leafOrChildren = std::any(3)},
+        }
+    };
+
+    vector<Expression> projections {
+        {.opCode = OpCode::Ref, .leafOrChildren = std::any("d"s)},
+        {.opCode = OpCode::Ref, .leafOrChildren = std::any("c"s)},
+    };
+
+    vector<vector<any>> expectedFields {
+        {"OTTOGI"s, 3},
+        {"Paldo"s, 3},
+        {"Paldo"s, 3},
+        {"Nongshim"s, 3},
+        {"Samyang"s, 3},
+        {"Samyang"s, 3},
+        {"OTTOGI"s, 3},
+        {"OTTOGI"s, 5},
+        {"Samyang"s, 4}
+    };
+
+    verifyIteratorBatchOutput(expectedFields, 
+        makeIterator<CsvFileScanner>("fileScanner_filter_test.txt", "fileScanner_filter_test.csv", filterExpr, projections),
+        4
+    );
+}
+
+TEST(CsvFileScannerTests, ParseLineViewTest)
+{
+    vector<string_view> fields;
+    parseLine(" field1, field2,\tfield3  ", fields);
+    EXPECT_EQ(fields, (vector<string_view>{"field1", "field2", "field3"}));
+
+    parseLine("", fields);
+    EXPECT_EQ(fields, vector<string_view>{""});
+
+    parseLine(", ,,", fields);
+    EXPECT_EQ(fields, (vector<string_view>{"", "", "", ""}));
+
+    // Views point into the line.
+    string line = "a, bc";
+    parseLine(line, fields);
+    EXPECT_EQ(fields[1].data(), line.data() + 3);
+}
+
+/**
+ * @brief Reads all rows of a scanner. Stops at WrongMetadata and records it as the last row.
+ */
+static vector<vector<any>> readAllRows(const unique_ptr<Iterator>& scanner)
+{
+    vector<vector<any>> rows;
+    try {
+        scanner->open();
+        while (scanner->hasNext()) {
+            auto row = scanner->processNext();
+            if (!row) {
+                break;
+            }
+            rows.emplace_back(std::move(row.value()));
+        }
+    }
+    catch (const WrongMetadata&) {
+        rows.emplace_back(vector<any>{"WrongMetadata"s});
+    }
+
+    return rows;
+}
+
+TEST(CsvFileScannerTests, MemoryMappedTest)
+{
+    const vector<pair<string, string>> files{
+        {"metadata.txt", "data.csv"},
+        {"metadata1.txt", "data1.csv"},
+        {"metadata2.txt", "data2.csv"},
+        {"metadata_basic_test.txt", "data_basic_test.csv"},
+        {"different_fields.txt", "different_fields.csv"},
+        {"different_fields1.txt", "different_fields1.csv"},
+        {"different_fields2.txt", "different_fields2.csv"},
+        {"different_fields3.txt", "different_fields3.csv"},
+        {"fileScanner_filter_test.txt", "fileScanner_filter_test.csv"},
+        {"projector.txt", "projector.csv"},
+    };
+
+    for (const auto& [metadataFileName, dataFileName]: files) {
+        auto expected = readAllRows(makeIterator<CsvFileScanner>(metadataFileName, dataFileName));
+        auto actual = readAllRows(makeIterator<CsvFileScanner>(
+            metadataFileName, dataFileName, kAlwaysTrue, CsvScanOptions{.memoryMapped = true}));
+
+        ASSERT_EQ(actual.size(), expected.size()) << dataFileName;
+        for (size_t i = 0; i < expected.size(); ++i) {
+            ASSERT_EQ(actual[i].size(), expected[i].size()) << dataFileName << ": " << i;
+            for (size_t k = 0; k < expected[i].size(); ++k) {
+                EXPECT_TRUE(actual[i][k] == expected[i][k]) << dataFileName << ": " << i << ", " << k;
+            }
+        }
+    }
+}
+
+TEST(CsvFileScannerTests, MemoryMappedFilterTest)
+{
+    // c >= 3
+    Expression filterExpr {
+        .opCode = OpCode::Gte,
+        .leafOrChildren = vector<Expression>{
+            {.opCode = OpCode::Ref, .leafOrChildren = std::any("c"s)},
+            {.opCode = OpCode::Const, .leafOrChildren = std::any(3)},
+        }
+    };
+
+    vector<Expression> projections {
+        {.opCode = OpCode::Ref, .leafOrChildren = std::any("d"s)},
+        {.opCode = OpCode::Ref, .leafOrChildren = std::any("c"s)},
+    };
+
+    vector<vector<any>> expectedFields {
+        {"OTTOGI"s, 3},
+        {"Paldo"s, 3},
+        {"Paldo"s, 3},
+        {"Nongshim"s, 3},
+        {"Samyang"s, 3},
+        {"Samyang"s, 3},
+        {"OTTOGI"s, 3},
+        {"OTTOGI"s, 5},
+        {"Samyang"s, 4}
+    };
+
+    const CsvScanOptions options{.memoryMapped = true};
+    verifyIteratorOutput(expectedFields, makeIterator<CsvFileScanner>(
+        "fileScanner_filter_test.txt", "fileScanner_filter_test.csv", filterExpr, projections, options));
+    verifyIteratorBatchOutput(expectedFields, makeIterator<CsvFileScanner>(
+        "fileScanner_filter_test.txt", "fileScanner_filter_test.csv", filterExpr, projections, options), 4);
+
+    // reopen() rewinds to the first line in both modes.
+    for (bool memoryMapped: {false, true}) {
+        auto scanner = makeIterator<CsvFileScanner>("fileScanner_filter_test.txt", "fileScanner_filter_test.csv",
+            filterExpr, projections, CsvScanOptions{.memoryMapped = memoryMapped});
+        scanner->open();
+        auto first = scanner->processNext();
+        scanner->processNext();
+        scanner->reopen();
+        EXPECT_TRUE(scanner->processNext().value()[0] == first.value()[0]);
+    }
+}
+
+TEST(CsvFileScannerTests, MemoryMappedFailTest)
+{
+    const CsvScanOptions options{.memoryMapped = true};
+    EXPECT_THROW(makeIterator<CsvFileScanner>("metadata.txt", "Danta.csv", kAlwaysTrue, options), NonExistentFile);
+
+    auto scanner = makeIterator<CsvFileScanner>("metadata_basic_test.txt", "empty_file.csv", kAlwaysTrue, options);
+    scanner->open();
+    EXPECT_FALSE(scanner->hasNext());
+    EXPECT_TRUE(scanner->processNext() == std::nullopt);
+}
+
+TEST(CsvFileScannerTests, ConvertFieldsTest)
+{
+    const Metadata metadata{{"a", tiInt}, {"s", tiString}, {"b", tiDouble}};
+    vector<any> r(metadata.size());
+
+    vector<string_view> fields{"1", "a long string beyond small string optimization", "x"};
+    EXPECT_TRUE(convertFields(metadata, fields, {0, 1}, r));
+    EXPECT_EQ(any_cast<int>(r[0]), 1);
+    EXPECT_FALSE(r[2].has_value());
+    const auto data = any_cast<string>(&r[1])->data();
+
+    // The string is overwritten in place.
+    fields = {"2", "shorter string", "x"};
+    EXPECT_TRUE(convertFields(metadata, fields, {0, 1}, r));
+    EXPECT_EQ(any_cast<string>(r[1]), "shorter string");
+    EXPECT_EQ(any_cast<string>(&r[1])->data(), data);
+
+    EXPECT_FALSE(convertFields(metadata, fields, {2}, r));
+}
+
+TEST(CsvFileScannerTests, FindConvertedColumnsTest)
+{
+    const Metadata metadata{{"a", tiInt}, {"b", tiDouble}, {"c", tiString}, {"d", tiInt}};
+
+    // c > 1 And a > 1
+    const Expression filterExpr {
+        .opCode = OpCode::And,
+        .leafOrChildren = vector<Expression>{
+            {OpCode::Gt, vector<Expression>{{OpCode::Ref, any("c"s)}, {OpCode::Const, any(1)}}},
+            {OpCode::Gt, vector<Expression>{{OpCode::Ref, any("a"s)}, {OpCode::Const, any(1)}}},
+        }
+    };
+    const vector<Expression> projections {
+        {OpCode::Ref, any("d"s)},
+        {OpCode::Add, vector<Expression>{{OpCode::Ref, any("a"s)}, {OpCode::Ref, any("b"s)}}},
+    };
+
+    vector<size_t> filterColumns;
+    vector<size_t> projectedColumns;
+    findConvertedColumns(filterExpr, projections, metadata, filterColumns, projectedColumns);
+    EXPECT_EQ(filterColumns, (vector<size_t>{0, 2}));
+    EXPECT_EQ(projectedColumns, (vector<size_t>{1, 3}));
+
+    findConvertedColumns(kAlwaysTrue, projections, metadata, filterColumns, projectedColumns);
+    EXPECT_TRUE(filterColumns.empty());
+    EXPECT_EQ(projectedColumns, (vector<size_t>{0, 1, 3}));
+}
+
+class CsvFileScannerConversionTests : public ::testing::Test {
+protected:
+    void SetUp() override
+    {
+        ofstream mfs(metadataFileName);
+        mfs << "a/int, b/double, c/string\n";
+
+        // Lines filtered out by a > 1 have invalid fields of b, and are more than the error
+        // lines a scanner takes before throwing WrongMetadata.
+        ofstream dfs(dataFileName);
+        for (int i = 0; i < 40; ++i) {
+            dfs << "1, not a number, x\n";
+        }
+        dfs << "2, not a number, y\n"
+            << "3, 1.5\n"
+            << "4, 2.5, z\n";
+    }
+
+    void TearDown() override
+    {
+        filesystem::remove(metadataFileName);
+        filesystem::remove(dataFileName);
+    }
+
+    const string metadataFileName = (filesystem::temp_directory_path() / "falcon_conversion_test.txt").string();
+    const string dataFileName = (filesystem::temp_directory_path() / "falcon_conversion_test.csv").string();
+    // a > 1
+    const Expression filterExpr {
+        .opCode = OpCode::Gt,
+        .leafOrChildren = vector<Expression>{
+            {.opCode = OpCode::Ref, .leafOrChildren = std::any("a"s)},
+            {.opCode = OpCode::Const, .leafOrChildren = std::any(1)},
+        }
+    };
+};
+
+TEST_F(CsvFileScannerConversionTests, LateConversionTest)
+{
+    // Fields are converted only if the filter or projections refer to them, and fields only
+    // projections refer to are converted after the line passes the filter. Lines with a wrong
+    // number of fields are skipped regardless.
+    const vector<pair<vector<string>, vector<vector<any>>>> cases{
+        {{"c"}, {{"y"s}, {"z"s}}},
+        {{"c", "b"}, {{"z"s, 2.5}}},
+        {{"a", "b", "c"}, {{4, 2.5, "z"s}}},
+    };
+
+    for (const auto& [columns, expectedFields]: cases) {
+        vector<Expression> projections;
+        for (const auto& column: columns) {
+            projections.push_back({.opCode = OpCode::Ref, .leafOrChildren = std::any(column)});
+        }
+
+        for (bool memoryMapped: {false, true}) {
+            const CsvScanOptions options{.memoryMapped = memoryMapped};
+            verifyIteratorOutput(expectedFields,
+                makeIterator<CsvFileScanner>(metadataFileName, dataFileName, filterExpr, projections, options));
+            verifyIteratorBatchOutput(expectedFields,
+                makeIterator<CsvFileScanner>(metadataFileName, dataFileName, filterExpr, projections, options), 2);
+        }
+    }
+
+    // Without projections, every column is output.
+    verifyIteratorOutput({{4, 2.5, "z"s}}, makeIterator<CsvFileScanner>(metadataFileName, dataFileName, filterExpr));
+
+    // Converting b to filter lines makes most lines error lines.
+    const Expression filterOnB {
+        .opCode = OpCode::Gt,
+        .leafOrChildren = vector<Expression>{
+            {.opCode = OpCode::Ref, .leafOrChildren = std::any("b"s)},
+            {.opCode = OpCode::Const, .leafOrChildren = std::any(1.0)},
+        }
+    };
+    const auto rows = readAllRows(makeIterator<CsvFileScanner>(metadataFileName, dataFileName, filterOnB));
+    ASSERT_EQ(rows.size(), 1);
+    EXPECT_TRUE(rows[0][0] == "WrongMetadata"s);
+}
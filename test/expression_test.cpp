@@ -1120,3 +1120,112 @@ TEST(ExpressionTests, CondExpressionTest)
     data = {15};
     EXPECT_EQ(any_cast<int>(expr(metadata, data)), 10);
 }
+
+TEST(ExpressionTests, CompileTest)
+{
+    Metadata metadata{{"a", tiInt}, {"b", tiString}, {"c", tiDouble}, {"d", tiBool}};
+    vector<vector<any>> rows{
+        {1, "X"s, 0.5, true},
+        {11, "X"s, 1.5, false},
+        {20, "Y"s, -2.0, true},
+        {-3, ""s, 0.0, false},
+    };
+
+    auto ref = [](const char* name) {
+        return Expression{OpCode::Ref, any(string(name))};
+    };
+    auto constant = [](any v) {
+        return Expression{OpCode::Const, std::move(v)};
+    };
+    auto node = [](OpCode opCode, vector<Expression> children) {
+        return Expression{opCode, std::move(children)};
+    };
+
+    vector<Expression> exprs{
+        constant(any(7)),
+        ref("b"),
+        // a > 10 && b == "X"
+        node(OpCode::And, {
+            node(OpCode::Gt, {ref("a"), constant(any(10))}),
+            node(OpCode::Eq, {ref("b"), constant(any("X"s))}),
+        }),
+        // a < 0 || !d
+        node(OpCode::Or, {
+            node(OpCode::Lt, {ref("a"), constant(any(0))}),
+            node(OpCode::Not, {ref("d")}),
+        }),
+        // d ? a * 2 - 1 : a % 4 + a / 2
+        node(OpCode::Cond, {
+            ref("d"),
+            node(OpCode::Sub, {node(OpCode::Mult, {ref("a"), constant(any(2))}), constant(any(1))}),
+            node(OpCode::Add, {
+                node(OpCode::Mod, {ref("a"), constant(any(4))}),
+                node(OpCode::Div, {ref("a"), constant(any(2))}),
+            }),
+        }),
+        // (double) a + c >= 2.0 == (a != 1)
+        node(OpCode::Eq, {
+            node(OpCode::Gte, {
+                node(OpCode::Add, {node(OpCode::Conv, {ref("a"), constant(any("double"s))}), ref("c")}),
+                constant(any(2.0)),
+            }),
+            node(OpCode::Neq, {ref("a"), constant(any(1))}),
+        }),
+        // (string) a, with a type name that is not a constant
+        node(OpCode::Conv, {ref("a"), node(OpCode::Add, {constant(any("str"s)), constant(any("ing"s))})}),
+    };
+
+    for (const auto& expr: exprs) {
+        auto compiled = expr.compile(metadata);
+        for (const auto& row: rows) {
+            EXPECT_TRUE(compiled.eval(row) == expr.eval(metadata, row));
+            EXPECT_TRUE(compiled(row) == expr(metadata, row));
+        }
+    }
+
+    auto compiled = compile(exprs, metadata);
+    ASSERT_EQ(compiled.size(), exprs.size());
+    EXPECT_EQ(any_cast<bool>(compiled[2].eval(rows[1])), true);
+    EXPECT_EQ(any_cast<bool>(compiled[2].eval(rows[2])), false);
+    EXPECT_EQ(any_cast<string>(compiled[6].eval(rows[3])), "-3"s);
+}
+
+TEST(ExpressionTests, CompileErrorTest)
+{
+    Metadata metadata{{"a", tiInt}, {"d", tiBool}};
+    vector<any> row{1, false};
+
+    // Errors are thrown only when the erroneous part is evaluated.
+    Expression unknownName{OpCode::Ref, any("x"s)};
+    auto compiled = unknownName.compile(metadata);
+    EXPECT_THROW(compiled.eval(row), UnknownName);
+
+    Expression nameExpected{OpCode::Ref, any(1)};
+    EXPECT_THROW(nameExpected.compile(metadata).eval(row), NameExpected);
+
+    Expression unsupportedConst{OpCode::Const, any(1L)};
+    EXPECT_THROW(unsupportedConst.compile(metadata).eval(row), UnsupportedOperation);
+
+    // d && x: x is not evaluated
+    Expression shortCircuit{OpCode::And, vector<Expression>{{OpCode::Ref, any("d"s)}, unknownName}};
+    EXPECT_FALSE(any_cast<bool>(shortCircuit.compile(metadata).eval(row)));
+
+    // a && d: a is not bool
+    Expression notBool{OpCode::And, vector<Expression>{{OpCode::Ref, any("a"s)}, {OpCode::Ref, any("d"s)}}};
+    EXPECT_THROW(notBool.compile(metadata).eval(row), UnsupportedOperation);
+
+    // a + d
+    Expression typeMismatch{OpCode::Add, vector<Expression>{{OpCode::Ref, any("a"s)}, {OpCode::Ref, any("d"s)}}};
+    EXPECT_THROW(typeMismatch.compile(metadata).eval(row), UnsupportedOperation);
+
+    // Conversion with a type name that is not a string
+    Expression badConv{OpCode::Conv, vector<Expression>{{OpCode::Ref, any("a"s)}, {OpCode::Ref, any("a"s)}}};
+    EXPECT_THROW(badConv.compile(metadata).eval(row), UnsupportedOperation);
+
+    // A compiled expression can be evaluated again after an error.
+    Expression cond{OpCode::Cond, vector<Expression>{{OpCode::Ref, any("d"s)}, unknownName, {OpCode::Ref, any("a"s)}}};
+    auto compiledCond = cond.compile(metadata);
+    EXPECT_EQ(any_cast<int>(compiledCond.eval(row)), 1);
+    EXPECT_THROW(compiledCond.eval(vector<any>{2, true}), UnknownName);
+    EXPECT_EQ(any_cast<int>(compiledCond.eval(row)), 1);
+}
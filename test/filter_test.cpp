@@ -11,6 +11,7 @@
 #include "filter.h"
 #include "iterator.h"
 #include "mock_scanner.h"
+#include "util.h"
 
 using namespace std;
 using namespace codein;
@@ -133,3 +134,77 @@ TEST_F(FilterTests, InvalidFilterTest)
 
     EXPECT_THROW(makeIterator<Filter>(move(mockScanner), filterExpr), InvalidFilter);
 }
+
+TEST_F(FilterTests, BatchTest)
+{
+    // c != "Alex Smith"
+    Expression filterExpr{
+        .opCode = OpCode::Neq,
+        .leafOrChildren = vector<Expression>{
+            {.opCode = OpCode::Ref, .leafOrChildren = std::any("c"s)},
+            {.opCode = OpCode::Const, .leafOrChildren = std::any("Alex Smith"s)},
+        }
+    };
+
+    vector<vector<any>> expectedFields{
+        {1, 1.1f, "John Smith"s},
+        {3, 3.3f, "Alex Swanson"s},
+    };
+
+    auto filter = makeIterator<Filter>(makeIterator<MockScanner>(metadata, lines), filterExpr);
+    verifyIteratorBatchOutput(expectedFields, filter, 2);
+
+    // Batches where every row is filtered out are skipped.
+    filterExpr.second().leaf() = std::any("John Smith"s);
+    expectedFields = {
+        {2, 2.2f, "Alex Smith"s},
+        {3, 3.3f, "Alex Swanson"s},
+    };
+
+    filter = makeIterator<Filter>(makeIterator<MockScanner>(metadata, lines), filterExpr);
+    verifyIteratorBatchOutput(expectedFields, filter, 1);
+}
+
+TEST_F(FilterTests, KernelBatchTest)
+{
+    // Enough rows to cover full vectors and the scalar tail of typed comparisons.
+    lines.clear();
+    for (int i = 0; i < 101; ++i) {
+        lines.emplace_back(to_string(i) + "," + to_string(i) + ".5,name" + to_string(i % 4));
+    }
+
+    // a > 20 && b < 70.0 || c == "name1"
+    Expression filterExpr{
+        .opCode = OpCode::Or,
+        .leafOrChildren = vector<Expression>{
+            {OpCode::And, vector<Expression>{
+                {OpCode::Gt, vector<Expression>{
+                    {OpCode::Ref, std::any("a"s)},
+                    {OpCode::Const, std::any(20)},
+                }},
+                {OpCode::Lt, vector<Expression>{
+                    {OpCode::Ref, std::any("b"s)},
+                    {OpCode::Const, std::any(70.0f)},
+                }},
+            }},
+            {OpCode::Eq, vector<Expression>{
+                {OpCode::Ref, std::any("c"s)},
+                {OpCode::Const, std::any("name1"s)},
+            }},
+        }
+    };
+
+    vector<vector<any>> expectedFields;
+    auto scanner = makeIterator<MockScanner>(metadata, lines);
+    scanner->open();
+    while (auto row = scanner->processNext()) {
+        if (any_cast<bool>(filterExpr.eval(metadata, *row))) {
+            expectedFields.emplace_back(std::move(*row));
+        }
+    }
+
+    for (size_t batchSize: {1, 8, 33, 200}) {
+        auto filter = makeIterator<Filter>(makeIterator<MockScanner>(metadata, lines), filterExpr);
+        verifyIteratorBatchOutput(expectedFields, filter, batchSize);
+    }
+}
@@ -0,0 +1,126 @@
+/**
+ * Copyright (C) 2021-present Codein Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify it under the terms of
+ * BSD-3-Clause License which can be found at the root directory of this repository.
+ */
+
+#include <any>
+#include <gtest/gtest.h>
+#include <limits>
+#include <string>
+#include <vector>
+
+#include "any_visitor.h"
+#include "group_hash_table.h"
+#include "metadata.h"
+
+using namespace std;
+using namespace codein;
+
+TEST(GroupHashTableTests, BasicTest)
+{
+    GroupHashTable table(Metadata{{"a", tiInt}, {"b", tiInt}}, 1);
+
+    auto [g12, inserted12] = table.findOrInsert({1, 2});
+    auto [g21, inserted21] = table.findOrInsert({2, 1});
+    EXPECT_TRUE(inserted12);
+    EXPECT_TRUE(inserted21);
+    EXPECT_NE(g12, g21);
+
+    auto [g, inserted] = table.findOrInsert({1, 2});
+    EXPECT_FALSE(inserted);
+    EXPECT_EQ(g, g12);
+    EXPECT_EQ(table.size(), 2);
+
+    EXPECT_FALSE(table.values(g12)->has_value());
+    *table.values(g12) = 10u;
+    EXPECT_EQ(any_cast<unsigned>(*table.values(table.findOrInsert({1, 2}).first)), 10u);
+
+    vector<any> key;
+    table.appendKey(g21, key);
+    ASSERT_EQ(key.size(), 2);
+    EXPECT_EQ(any_cast<int>(key[0]), 2);
+    EXPECT_EQ(any_cast<int>(key[1]), 1);
+
+    table.clear();
+    EXPECT_EQ(table.size(), 0);
+    EXPECT_TRUE(table.findOrInsert({1, 2}).second);
+}
+
+TEST(GroupHashTableTests, TypesTest)
+{
+    GroupHashTable table(
+        Metadata{{"b", tiBool}, {"u", tiUint}, {"f", tiFloat}, {"d", tiDouble}, {"s", tiString}, {"i", tiInt}}, 2);
+
+    const vector<vector<any>> keys{
+        {true, 1u, 1.5f, 2.5, "abc"s, -1},
+        {false, 1u, 1.5f, 2.5, "abc"s, -1},
+        {true, 1u, 1.5f, 2.5, "abd"s, -1},
+        {true, 1u, 1.5f, 2.5, ""s, -1},
+        {true, 1u, 1.5f, 2.5, any(), -1},
+        {any(), any(), any(), any(), any(), any()},
+        {true, 1u, 0.0f, 0.0, "abc"s, 0},
+    };
+
+    for (size_t i = 0; i < keys.size(); ++i) {
+        auto [group, inserted] = table.findOrInsert(keys[i]);
+        EXPECT_TRUE(inserted) << i;
+        EXPECT_EQ(group, i);
+    }
+
+    for (size_t i = 0; i < keys.size(); ++i) {
+        auto [group, inserted] = table.findOrInsert(keys[i]);
+        EXPECT_FALSE(inserted) << i;
+        EXPECT_EQ(group, i);
+
+        vector<any> key;
+        table.appendKey(group, key);
+        ASSERT_EQ(key.size(), keys[i].size());
+        for (size_t k = 0; k < key.size(); ++k) {
+            EXPECT_EQ(key[k].has_value(), keys[i][k].has_value()) << i << ", " << k;
+            if (key[k].has_value()) {
+                EXPECT_TRUE(key[k] == keys[i][k]) << i << ", " << k;
+            }
+        }
+    }
+
+    // -0.0 is the same group as 0.0.
+    EXPECT_FALSE(table.findOrInsert({true, 1u, -0.0f, -0.0, "abc"s, 0}).second);
+    EXPECT_TRUE(GroupHashTable::sameKey(keys.back(), {true, 1u, -0.0f, -0.0, "abc"s, 0}));
+
+    // Every NaN is the same group, whatever its sign and payload.
+    const auto nanf = numeric_limits<float>::quiet_NaN();
+    const auto nan = numeric_limits<double>::quiet_NaN();
+    const vector<any> nanKey{true, 1u, nanf, nan, "abc"s, 0};
+    const vector<any> otherNanKey{true, 1u, -nanf, numeric_limits<double>::signaling_NaN(), "abc"s, 0};
+    EXPECT_TRUE(table.findOrInsert(nanKey).second);
+    EXPECT_FALSE(table.findOrInsert(otherNanKey).second);
+    EXPECT_TRUE(GroupHashTable::sameKey(nanKey, otherNanKey));
+    EXPECT_FALSE(GroupHashTable::sameKey(nanKey, keys.back()));
+    EXPECT_FALSE(GroupHashTable::sameKey(keys[4], keys[3]));
+    EXPECT_TRUE(GroupHashTable::sameKey(keys[5], keys[5]));
+
+    // Values must have the types of key columns.
+    EXPECT_THROW(table.findOrInsert({true, 1, 1.5f, 2.5, "abc"s, -1}), UnsupportedOperation);
+}
+
+TEST(GroupHashTableTests, GrowTest)
+{
+    GroupHashTable table(Metadata{{"a", tiInt}, {"s", tiString}}, 1);
+
+    const int n = 100000;
+    for (int i = 0; i < n; ++i) {
+        auto [group, inserted] = table.findOrInsert({i, to_string(i % 10)});
+        ASSERT_TRUE(inserted);
+        *table.values(group) = i;
+    }
+    EXPECT_EQ(table.size(), n);
+
+    for (int i = 0; i < n; ++i) {
+        auto [group, inserted] = table.findOrInsert({i, to_string(i % 10)});
+        ASSERT_FALSE(inserted);
+        EXPECT_EQ(any_cast<int>(*table.values(group)), i);
+    }
+    EXPECT_TRUE(table.findOrInsert({1, "2"s}).second);
+}
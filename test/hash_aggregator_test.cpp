@@ -8,6 +8,7 @@
 #include <algorithm>
 #include <any>
 #include <gtest/gtest.h>
+#include <map>
 #include <memory>
 #include <numeric>
 #include <unordered_map>
@@ -17,6 +18,8 @@
 #include "iterator.h"
 #include "mock_scanner.h"
 #include "projector.h"
+#include "spill_file.h"
+#include "util.h"
 
 using namespace std;
 using namespace codein;
@@ -561,3 +564,357 @@ TEST_F(HashAggregatorTests, AverageTest)
 
     EXPECT_EQ(n, expectedNumData);
 }
+
+TEST_F(HashAggregatorTests, BatchTest)
+{
+    Metadata groupValMetadata{
+        {"count", tiUint}
+    };
+    auto groupKeyCols = vector<string>{"a", "b"};
+
+    // count(*) aggregation
+    vector<AggregationExpression> aggExprs{
+        AggregationExpression{
+            .initExpr = {
+                .opCode = OpCode::Const,
+                .leafOrChildren = std::any(1u),
+            },
+            .contExpr = {
+                .opCode = OpCode::Add,
+                .leafOrChildren = vector<Expression>{
+                    {.opCode = OpCode::Ref, .leafOrChildren = std::any("count"s)},
+                    {.opCode = OpCode::Const, .leafOrChildren = std::any(1u)},
+                }
+            }
+        },
+    };
+
+    auto mockScanner = makeIterator<MockScanner>(metadata, lines);
+    auto hashAggregator = makeIterator<HashAggregator>(
+        move(mockScanner), groupKeyCols, groupValMetadata, aggExprs);
+
+    hashAggregator->open();
+    size_t n = 0;
+    const size_t expectedNumData = 7;
+    while (hashAggregator->hasNext()) {
+        auto batch = hashAggregator->processNextBatch(3);
+        if (!batch) {
+            break;
+        }
+
+        EXPECT_LE(batch->numRows(), 3);
+        const auto& as = batch->column(0).values<int>();
+        const auto& bs = batch->column(1).values<string>();
+        const auto& counts = batch->column(2).values<unsigned>();
+        for (size_t i = 0; i < batch->numRows(); ++i) {
+            EXPECT_EQ(counts[i], expectedDataMap.count(make_pair(as[i], bs[i])));
+            ++n;
+        }
+    }
+
+    EXPECT_EQ(n, expectedNumData);
+    EXPECT_TRUE(hashAggregator->processNextBatch() == std::nullopt);
+}
+
+namespace {
+
+// Groups of (a, b) with a in [0, 500) and b in 4 strings. Every group has 5 rows.
+vector<string> makeManyGroupLines()
+{
+    vector<string> lines;
+    for (int k = 0; k < 5; ++k) {
+        for (int i = 0; i < 2000; ++i) {
+            lines.emplace_back(to_string(i / 4) + ",s" + to_string(i % 4) + "," + to_string(k + i));
+        }
+    }
+
+    return lines;
+}
+
+// count(*) and sum(c) grouped by a and b, returned as a map.
+map<pair<int, string>, pair<unsigned, double>> aggregateCountAndSum(
+    const Metadata& metadata, const vector<string>& lines, const HashAggregatorOptions& options)
+{
+    Metadata groupValMetadata{
+        {"count", tiUint},
+        {"sumc", tiDouble},
+    };
+    vector<AggregationExpression> aggExprs{
+        AggregationExpression{
+            .initExpr = {OpCode::Const, std::any(1u)},
+            .contExpr = {OpCode::Add, vector<Expression>{
+                {OpCode::Ref, std::any("count"s)},
+                {OpCode::Const, std::any(1u)},
+            }},
+            .mergeExpr = {OpCode::Add, vector<Expression>{
+                {OpCode::Ref, std::any("count"s)},
+                {OpCode::Ref, std::any("partial.count"s)},
+            }},
+        },
+        AggregationExpression{
+            .initExpr = {OpCode::Ref, std::any("c"s)},
+            .contExpr = {OpCode::Add, vector<Expression>{
+                {OpCode::Ref, std::any("sumc"s)},
+                {OpCode::Ref, std::any("c"s)},
+            }},
+            .mergeExpr = {OpCode::Add, vector<Expression>{
+                {OpCode::Ref, std::any("sumc"s)},
+                {OpCode::Ref, std::any("partial.sumc"s)},
+            }},
+        },
+    };
+
+    auto hashAggregator = makeIterator<HashAggregator>(makeIterator<MockScanner>(metadata, lines),
+        vector<string>{"a", "b"}, groupValMetadata, aggExprs, options);
+
+    map<pair<int, string>, pair<unsigned, double>> groups;
+    hashAggregator->open();
+    while (auto batch = hashAggregator->processNextBatch(100)) {
+        for (size_t i = 0; i < batch->numRows(); ++i) {
+            auto row = batch->row(i);
+            auto key = make_pair(any_cast<int>(row[0]), any_cast<string>(row[1]));
+            EXPECT_FALSE(groups.contains(key));
+            groups[key] = make_pair(any_cast<unsigned>(row[2]), any_cast<double>(row[3]));
+        }
+    }
+    EXPECT_FALSE(hashAggregator->hasNext());
+
+    return groups;
+}
+
+}
+
+TEST_F(HashAggregatorTests, SpillTest)
+{
+    const auto manyLines = makeManyGroupLines();
+
+    auto expected = aggregateCountAndSum(metadata, manyLines, {});
+    EXPECT_EQ(expected.size(), 2000);
+    for (const auto& [key, val]: expected) {
+        EXPECT_EQ(val.first, 5u);
+    }
+
+    // A budget of 16 KB holds less than 400 groups, so spilled partitions are spilled again.
+    EXPECT_EQ(aggregateCountAndSum(metadata, manyLines, {.memoryBudget = 16 * 1024, .numSpillPartitions = 4}), expected);
+    EXPECT_EQ(aggregateCountAndSum(metadata, manyLines, {.memoryBudget = 1, .spillDirectory = "."}), expected);
+}
+
+TEST_F(HashAggregatorTests, ParallelTest)
+{
+    const auto manyLines = makeManyGroupLines();
+    const auto expected = aggregateCountAndSum(metadata, manyLines, {});
+
+    for (size_t numThreads: {0, 2, 4, 13}) {
+        EXPECT_EQ(aggregateCountAndSum(metadata, manyLines, {.numThreads = numThreads}), expected) << numThreads;
+    }
+
+    // The first batch of the child has all lines.
+    auto groups = aggregateCountAndSum(metadata, lines, {.numThreads = 4});
+    EXPECT_EQ(groups.size(), 7);
+    for (const auto& [key, val]: groups) {
+        EXPECT_EQ(val.first, expectedDataMap.count(key));
+    }
+
+    // Merge expressions are required.
+    vector<AggregationExpression> aggExprs{
+        AggregationExpression{
+            .initExpr = {OpCode::Const, std::any(1u)},
+            .contExpr = {OpCode::Add, vector<Expression>{
+                {OpCode::Ref, std::any("count"s)},
+                {OpCode::Const, std::any(1u)},
+            }},
+        },
+    };
+    EXPECT_THROW(makeIterator<HashAggregator>(makeIterator<MockScanner>(metadata, lines),
+        vector<string>{"a", "b"}, Metadata{{"count", tiUint}}, aggExprs, HashAggregatorOptions{.numThreads = 2}),
+        MissingMergeExpression);
+}
+
+TEST_F(HashAggregatorTests, ClusteredInputTest)
+{
+    // Groups are output in the order of input, and the aggregation is the same as hashing.
+    const auto manyLines = makeManyGroupLines();
+    vector<string> clusteredLines(manyLines);
+    stable_sort(clusteredLines.begin(), clusteredLines.end(), [](const auto& lhs, const auto& rhs) {
+        return lhs.substr(0, lhs.rfind(',')) < rhs.substr(0, rhs.rfind(','));
+    });
+    EXPECT_EQ(aggregateCountAndSum(metadata, clusteredLines, {.clusteredInput = true}),
+        aggregateCountAndSum(metadata, manyLines, {}));
+
+    Metadata groupValMetadata{
+        {"count", tiUint}
+    };
+    vector<AggregationExpression> aggExprs{
+        AggregationExpression{
+            .initExpr = {OpCode::Const, std::any(1u)},
+            .contExpr = {OpCode::Add, vector<Expression>{
+                {OpCode::Ref, std::any("count"s)},
+                {OpCode::Const, std::any(1u)},
+            }},
+        },
+    };
+
+    vector<vector<any>> expectedFields{
+        {1, "A"s, 4u},
+        {1, "B"s, 2u},
+        {2, "C"s, 3u},
+        {2, "A"s, 1u},
+        {3, "C"s, 2u},
+        {3, "E"s, 1u},
+        {3, "D"s, 1u},
+    };
+
+    auto hashAggregator = makeIterator<HashAggregator>(makeIterator<MockScanner>(metadata, lines),
+        vector<string>{"a", "b"}, groupValMetadata, aggExprs, HashAggregatorOptions{.clusteredInput = true});
+    verifyIteratorOutput(expectedFields, hashAggregator);
+
+    hashAggregator = makeIterator<HashAggregator>(makeIterator<MockScanner>(metadata, lines),
+        vector<string>{"a", "b"}, groupValMetadata, aggExprs, HashAggregatorOptions{.clusteredInput = true});
+    verifyIteratorBatchOutput(expectedFields, hashAggregator, 3);
+
+    // Input without rows has no groups.
+    hashAggregator = makeIterator<HashAggregator>(makeIterator<MockScanner>(metadata, vector<string>{}),
+        vector<string>{"a", "b"}, groupValMetadata, aggExprs, HashAggregatorOptions{.clusteredInput = true});
+    hashAggregator->open();
+    EXPECT_FALSE(hashAggregator->hasNext());
+    EXPECT_FALSE(hashAggregator->processNext());
+}
+
+TEST_F(HashAggregatorTests, NaNKeyTest)
+{
+    // NaN keys are one group whether the input is clustered or hashed.
+    Metadata nanMetadata{{"k", tiDouble}, {"v", tiInt}};
+    const vector<string> nanLines{"1, 1", "nan, 2", "nan, 3", "-nan, 4", ", 5"};
+
+    for (const auto& options: {
+        HashAggregatorOptions{},
+        HashAggregatorOptions{.clusteredInput = true},
+    }) {
+        auto hashAggregator = makeIterator<HashAggregator>(makeIterator<MockScanner>(nanMetadata, nanLines),
+            vector<string>{"k"}, vector<AggregateSpec>{{AggregateFunction::Count, "", "count"}}, options);
+
+        map<string, unsigned> counts;
+        hashAggregator->open();
+        while (auto row = hashAggregator->processNext()) {
+            const auto key = (*row)[0].has_value() ? to_string(any_cast<double>((*row)[0])) : "null"s;
+            EXPECT_FALSE(counts.contains(key));
+            counts[key] = any_cast<unsigned>((*row)[1]);
+        }
+        EXPECT_EQ(counts, (map<string, unsigned>{{"1.000000", 1}, {"nan", 3}, {"null", 1}}));
+    }
+}
+
+TEST_F(HashAggregatorTests, NativeAggregateTest)
+{
+    const vector<AggregateSpec> aggregates{
+        {AggregateFunction::Count, "", "count"},
+        {AggregateFunction::Sum, "c", "sumc"},
+        {AggregateFunction::Min, "c", "minc"},
+        {AggregateFunction::Max, "c", "maxc"},
+        {AggregateFunction::Avg, "c", "avgc"},
+        {AggregateFunction::ApproxQuantile, "c", "p100c", 1.0},
+    };
+
+    for (const auto& options: {
+        HashAggregatorOptions{},
+        HashAggregatorOptions{.memoryBudget = 1},
+        HashAggregatorOptions{.numThreads = 3},
+    }) {
+        auto hashAggregator = makeIterator<HashAggregator>(makeIterator<MockScanner>(metadata, lines),
+            vector<string>{"a", "b"}, aggregates, options);
+
+        Metadata expectedOutputMetadata{
+            {"a", tiInt},
+            {"b", tiString},
+            {"count", tiUint},
+            {"sumc", tiDouble},
+            {"minc", tiDouble},
+            {"maxc", tiDouble},
+            {"avgc", tiDouble},
+            {"p100c", tiDouble},
+        };
+        EXPECT_TRUE(hashAggregator->getMetadata() == expectedOutputMetadata);
+
+        hashAggregator->open();
+        size_t n = 0;
+        while (auto optData = hashAggregator->processNext()) {
+            auto groupKey = make_pair(any_cast<int>((*optData)[0]), any_cast<string>((*optData)[1]));
+            auto range = expectedDataMap.equal_range(groupKey);
+            vector<double> values;
+            for (auto it = range.first; it != range.second; ++it) {
+                values.push_back(it->second);
+            }
+            double sum = accumulate(values.begin(), values.end(), 0.0);
+
+            EXPECT_EQ(any_cast<unsigned>((*optData)[2]), values.size());
+            EXPECT_DOUBLE_EQ(any_cast<double>((*optData)[3]), sum);
+            EXPECT_EQ(any_cast<double>((*optData)[4]), *min_element(values.begin(), values.end()));
+            EXPECT_EQ(any_cast<double>((*optData)[5]), *max_element(values.begin(), values.end()));
+            EXPECT_DOUBLE_EQ(any_cast<double>((*optData)[6]), sum / values.size());
+            EXPECT_EQ(any_cast<double>((*optData)[7]), *max_element(values.begin(), values.end()));
+            ++n;
+        }
+        EXPECT_EQ(n, 7);
+    }
+
+    // Clustered input
+    vector<vector<any>> expectedFields{
+        {1, "A"s, 4u},
+        {1, "B"s, 2u},
+        {2, "C"s, 3u},
+        {2, "A"s, 1u},
+        {3, "C"s, 2u},
+        {3, "E"s, 1u},
+        {3, "D"s, 1u},
+    };
+    auto hashAggregator = makeIterator<HashAggregator>(makeIterator<MockScanner>(metadata, lines),
+        vector<string>{"a", "b"}, vector<AggregateSpec>{{AggregateFunction::Count, "c", "count"}},
+        HashAggregatorOptions{.clusteredInput = true});
+    verifyIteratorOutput(expectedFields, hashAggregator);
+}
+
+TEST_F(HashAggregatorTests, SketchSpillTest)
+{
+    auto aggregate = [](const vector<string>& lines, const vector<AggregateSpec>& aggregates,
+                         const HashAggregatorOptions& options) {
+        auto hashAggregator = makeIterator<HashAggregator>(makeIterator<MockScanner>(metadata, lines),
+            vector<string>{"a", "b"}, aggregates, options);
+
+        map<pair<int, string>, vector<unsigned>> groups;
+        hashAggregator->open();
+        while (auto row = hashAggregator->processNext()) {
+            auto& vals = groups[make_pair(any_cast<int>((*row)[0]), any_cast<string>((*row)[1]))];
+            for (size_t i = 2; i < row->size(); ++i) {
+                vals.push_back(any_cast<unsigned>((*row)[i]));
+            }
+        }
+
+        return groups;
+    };
+
+    // The table of 7 groups fits in the budget, but not their sketches, which are spilled
+    // into a directory that does not exist.
+    const HashAggregatorOptions options{.memoryBudget = 32 * 1024, .spillDirectory = "no_such_directory"};
+    EXPECT_EQ(aggregate(lines, {{AggregateFunction::Count, "", "count"}}, options).size(), 7);
+    EXPECT_THROW(aggregate(lines, {{AggregateFunction::ApproxCountDistinct, "c", "distinct"}}, options),
+        SpillFailure);
+
+    // So are the t-digests of 8 groups of 500 values, and the row of a new group following them.
+    vector<string> longGroupLines;
+    for (int i = 0; i < 4000; ++i) {
+        longGroupLines.emplace_back(to_string(i % 2) + ",s" + to_string(i % 8) + "," + to_string(i));
+    }
+    longGroupLines.emplace_back("2,s0,0");
+    EXPECT_EQ(aggregate(longGroupLines, {{AggregateFunction::Count, "", "count"}}, options).size(), 9);
+    EXPECT_THROW(aggregate(longGroupLines, {{AggregateFunction::ApproxQuantile, "c", "p99", 0.99}}, options),
+        SpillFailure);
+
+    const vector<AggregateSpec> aggregates{
+        {AggregateFunction::Count, "", "count"},
+        {AggregateFunction::ApproxCountDistinct, "c", "distinct"},
+    };
+    const auto manyLines = makeManyGroupLines();
+    const auto expected = aggregate(manyLines, aggregates, {});
+    EXPECT_EQ(expected.size(), 2000);
+    EXPECT_EQ(aggregate(manyLines, aggregates, {.memoryBudget = 256 * 1024}), expected);
+}
@@ -0,0 +1,207 @@
+/**
+ * Copyright (C) 2021-present Codein Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify it under the terms of
+ * BSD-3-Clause License which can be found at the root directory of this repository.
+ */
+
+#include <algorithm>
+#include <any>
+#include <gtest/gtest.h>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "any_visitor.h"
+#include "hash_joiner.h"
+#include "iterator.h"
+#include "metadata.h"
+#include "mock_scanner.h"
+#include "util.h"
+
+using namespace std;
+using namespace codein;
+
+class HashJoinerTests : public ::testing::Test {
+protected:
+    unique_ptr<Iterator> makeJoiner(JoinType joinType)
+    {
+        return makeIterator<HashJoiner>(makeIterator<MockScanner>(customerMetadata, customerLines),
+            makeIterator<MockScanner>(orderMetadata, orderLines), vector<string>{"id"}, vector<string>{"customer"},
+            joinType);
+    }
+
+    Metadata customerMetadata{{"id", tiInt}, {"name", tiString}};
+    vector<string> customerLines{
+        "1, alice",
+        "2, bob",
+        "1, alice2",
+        ", nobody",
+        "4, dave",
+    };
+
+    Metadata orderMetadata{{"order", tiUint}, {"customer", tiInt}, {"name", tiString}};
+    vector<string> orderLines{
+        "100, 2, book",
+        "101, 1, pen",
+        "102, 3, cup",
+        "103, , box",
+        "104, 2, ink",
+    };
+};
+
+TEST_F(HashJoinerTests, InnerTest)
+{
+    vector<vector<any>> expectedFields{
+        {100u, 2, "book"s, 2, "bob"s},
+        {101u, 1, "pen"s, 1, "alice"s},
+        {101u, 1, "pen"s, 1, "alice2"s},
+        {104u, 2, "ink"s, 2, "bob"s},
+    };
+
+    auto joiner = makeJoiner(JoinType::Inner);
+    Metadata expectedMetadata{
+        {"order", tiUint}, {"customer", tiInt}, {"name", tiString}, {"id", tiInt}, {"build.name", tiString}};
+    EXPECT_TRUE(joiner->getMetadata() == expectedMetadata);
+    EXPECT_FALSE(joiner->hasNext());
+    verifyIteratorOutput(expectedFields, joiner);
+
+    joiner = makeJoiner(JoinType::Inner);
+    verifyIteratorBatchOutput(expectedFields, joiner, 3);
+}
+
+TEST_F(HashJoinerTests, LeftOuterTest)
+{
+    vector<vector<any>> expectedFields{
+        {100u, 2, "book"s, 2, "bob"s},
+        {101u, 1, "pen"s, 1, "alice"s},
+        {101u, 1, "pen"s, 1, "alice2"s},
+        {102u, 3, "cup"s, any(), any()},
+        {103u, any(), "box"s, any(), any()},
+        {104u, 2, "ink"s, 2, "bob"s},
+    };
+
+    auto joiner = makeJoiner(JoinType::LeftOuter);
+    verifyIteratorOutput(expectedFields, joiner);
+
+    // Reopening joins again.
+    verifyIteratorOutput(expectedFields, joiner);
+}
+
+TEST_F(HashJoinerTests, SemiAntiTest)
+{
+    auto joiner = makeJoiner(JoinType::Semi);
+    EXPECT_TRUE(joiner->getMetadata() == orderMetadata);
+    verifyIteratorOutput({
+        {100u, 2, "book"s},
+        {101u, 1, "pen"s},
+        {104u, 2, "ink"s},
+    }, joiner);
+
+    joiner = makeJoiner(JoinType::Anti);
+    EXPECT_TRUE(joiner->getMetadata() == orderMetadata);
+    verifyIteratorOutput({
+        {102u, 3, "cup"s},
+        {103u, any(), "box"s},
+    }, joiner);
+}
+
+TEST_F(HashJoinerTests, MultiKeyTest)
+{
+    Metadata metadata{{"a", tiInt}, {"b", tiString}, {"v", tiDouble}};
+    vector<string> buildLines{"1, x, 0.5", "1, y, 1.5", "2, x, 2.5"};
+    vector<string> probeLines{"1, y, 10.0", "2, y, 20.0", "2, x, 30.0"};
+
+    auto joiner = makeIterator<HashJoiner>(makeIterator<MockScanner>(metadata, buildLines),
+        makeIterator<MockScanner>(metadata, probeLines), vector<string>{"a", "b"});
+    verifyIteratorOutput({
+        {1, "y"s, 10.0, 1, "y"s, 1.5},
+        {2, "x"s, 30.0, 2, "x"s, 2.5},
+    }, joiner);
+}
+
+namespace {
+
+string formatValue(const any& value)
+{
+    if (const auto i = any_cast<int>(&value); i != nullptr) {
+        return to_string(*i);
+    }
+    else if (const auto s = any_cast<string>(&value); s != nullptr) {
+        return *s;
+    }
+
+    return value.has_value() ? "?" : "null";
+}
+
+// Output rows of iterator formatted as strings, sorted to compare them regardless of order.
+vector<string> sortedOutput(Iterator& iterator)
+{
+    vector<string> rows;
+    iterator.open();
+    while (auto row = iterator.processNext()) {
+        string s;
+        for (const auto& value: *row) {
+            s += formatValue(value);
+            s += ",";
+        }
+        rows.push_back(std::move(s));
+    }
+    sort(rows.begin(), rows.end());
+
+    return rows;
+}
+
+}
+
+TEST_F(HashJoinerTests, SpillTest)
+{
+    Metadata buildMetadata{{"k", tiInt}, {"s", tiString}};
+    Metadata probeMetadata{{"k", tiInt}, {"seq", tiInt}};
+
+    mt19937 gen(3);
+    uniform_int_distribution<int> dist(0, 400);
+    vector<string> buildLines;
+    vector<string> probeLines;
+    for (int i = 0; i < 4000; ++i) {
+        buildLines.push_back(to_string(dist(gen)) + ", build" + to_string(i));
+    }
+    buildLines.push_back(", null");
+    for (int i = 0; i < 6000; ++i) {
+        // Keys above 400 have no match.
+        probeLines.push_back(to_string(dist(gen) + 100) + "," + to_string(i));
+    }
+    probeLines.push_back("," + to_string(6000));
+
+    for (auto joinType: {JoinType::Inner, JoinType::LeftOuter, JoinType::Semi, JoinType::Anti}) {
+        auto inMemory = makeIterator<HashJoiner>(makeIterator<MockScanner>(buildMetadata, buildLines),
+            makeIterator<MockScanner>(probeMetadata, probeLines), vector<string>{"k"}, joinType);
+        const auto expected = sortedOutput(*inMemory);
+        EXPECT_FALSE(expected.empty());
+
+        for (const auto& options: {
+            HashJoinerOptions{.memoryBudget = 64 * 1024},
+            HashJoinerOptions{.memoryBudget = 1, .numSpillPartitions = 4},
+        }) {
+            auto joiner = makeIterator<HashJoiner>(makeIterator<MockScanner>(buildMetadata, buildLines),
+                makeIterator<MockScanner>(probeMetadata, probeLines), vector<string>{"k"}, joinType, options);
+            EXPECT_EQ(sortedOutput(*joiner), expected);
+
+            // Reopening joins again.
+            EXPECT_EQ(sortedOutput(*joiner), expected);
+        }
+    }
+}
+
+TEST_F(HashJoinerTests, FailTest)
+{
+    auto build = makeIterator<MockScanner>(customerMetadata, customerLines);
+    auto probe = makeIterator<MockScanner>(orderMetadata, orderLines);
+    EXPECT_THROW(makeIterator<HashJoiner>(std::move(build), std::move(probe), vector<string>{"id"},
+        vector<string>{"order"}), UnsupportedOperation);
+
+    build = makeIterator<MockScanner>(customerMetadata, customerLines);
+    probe = makeIterator<MockScanner>(orderMetadata, orderLines);
+    EXPECT_THROW(makeIterator<HashJoiner>(std::move(build), std::move(probe), vector<string>{"id"}), UnknownName);
+}
@@ -0,0 +1,65 @@
+/**
+ * Copyright (C) 2021-present Codein Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify it under the terms of
+ * BSD-3-Clause License which can be found at the root directory of this repository.
+ */
+
+#include <any>
+#include <cmath>
+#include <gtest/gtest.h>
+#include <string>
+
+#include "hyper_log_log.h"
+
+using namespace std;
+using namespace codein;
+
+TEST(HyperLogLogTests, EstimateTest)
+{
+    HyperLogLog sketch;
+    EXPECT_EQ(sketch.precision(), HyperLogLog::kDefaultPrecision);
+    EXPECT_EQ(sketch.estimate(), 0.0);
+
+    // Small cardinalities are almost exact.
+    for (int i = 0; i < 100; ++i) {
+        sketch.add(any("user"s + to_string(i)));
+        sketch.add(any("user"s + to_string(i)));
+    }
+    EXPECT_NEAR(sketch.estimate(), 100, 1);
+
+    for (int n: {10000, 200000}) {
+        HyperLogLog strings;
+        HyperLogLog ints;
+        for (int i = 0; i < n; ++i) {
+            strings.add(any("user"s + to_string(i)));
+            ints.add(any(i));
+            ints.add(any(i));
+        }
+        EXPECT_LT(abs(strings.estimate() - n) / n, 0.02) << n;
+        EXPECT_LT(abs(ints.estimate() - n) / n, 0.02) << n;
+    }
+}
+
+TEST(HyperLogLogTests, MergeTest)
+{
+    HyperLogLog lhs;
+    HyperLogLog rhs;
+    HyperLogLog all;
+    for (int i = 0; i < 50000; ++i) {
+        (i % 3 == 0 ? lhs : rhs).add(any(i));
+        all.add(any(i));
+    }
+    // Overlapping values
+    for (int i = 0; i < 10000; ++i) {
+        lhs.add(any(i));
+    }
+
+    lhs.merge(rhs);
+    EXPECT_EQ(lhs.estimate(), all.estimate());
+    EXPECT_LT(abs(lhs.estimate() - 50000) / 50000, 0.02);
+
+    // Precision is clamped.
+    EXPECT_EQ(HyperLogLog(1).precision(), HyperLogLog::kMinPrecision);
+    EXPECT_EQ(HyperLogLog(30).precision(), HyperLogLog::kMaxPrecision);
+}
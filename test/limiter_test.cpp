@@ -74,3 +74,28 @@ TEST (LimiterTests, GreaterLimitThanChild)
     EXPECT_FALSE(limiter->hasNext());
     verifyIteratorOutput(expectedFields, limiter);
 }
+
+TEST (LimiterTests, BatchTest)
+{
+    Metadata metadata {
+        {"a", tiString}, {"b", tiUint}
+    };
+
+    vector<string> lines {
+        "string1, 1",
+        "string2, 2",
+        "string3, 3",
+        "string4, 4",
+        "string5, 5",
+    };
+
+    vector<vector<any>> expectedFields {
+        {"string1"s, 1u},
+        {"string2"s, 2u},
+        {"string3"s, 3u},
+    };
+
+    auto child = makeIterator<MockScanner>(metadata, lines);
+    auto limiter = makeIterator<Limiter>(std::move(child), 3);
+    verifyIteratorBatchOutput(expectedFields, limiter, 2);
+}
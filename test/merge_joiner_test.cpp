@@ -0,0 +1,177 @@
+/**
+ * Copyright (C) 2021-present Codein Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify it under the terms of
+ * BSD-3-Clause License which can be found at the root directory of this repository.
+ */
+
+#include <any>
+#include <gtest/gtest.h>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "any_visitor.h"
+#include "hash_joiner.h"
+#include "iterator.h"
+#include "merge_joiner.h"
+#include "metadata.h"
+#include "mock_scanner.h"
+#include "sorter.h"
+#include "util.h"
+
+using namespace std;
+using namespace codein;
+
+TEST(MergeJoinerTests, BasicTest)
+{
+    Metadata leftMetadata{{"ts", tiInt}, {"event", tiString}};
+    Metadata rightMetadata{{"ts", tiInt}, {"price", tiDouble}};
+
+    vector<string> leftLines{
+        ", lost",
+        "1, open",
+        "3, click",
+        "3, scroll",
+        "4, close",
+        "6, exit",
+    };
+    vector<string> rightLines{
+        ", 0.0",
+        "2, 2.0",
+        "3, 3.0",
+        "3, 3.5",
+        "5, 5.0",
+        "6, 6.0",
+        "7, 7.0",
+    };
+
+    auto makeJoiner = [&](JoinType joinType) {
+        return makeIterator<MergeJoiner>(makeIterator<MockScanner>(leftMetadata, leftLines),
+            makeIterator<MockScanner>(rightMetadata, rightLines), vector<string>{"ts"}, joinType);
+    };
+
+    auto joiner = makeJoiner(JoinType::Inner);
+    Metadata expectedMetadata{{"ts", tiInt}, {"event", tiString}, {"build.ts", tiInt}, {"price", tiDouble}};
+    EXPECT_TRUE(joiner->getMetadata() == expectedMetadata);
+    EXPECT_FALSE(joiner->hasNext());
+    vector<vector<any>> expectedFields{
+        {3, "click"s, 3, 3.0},
+        {3, "click"s, 3, 3.5},
+        {3, "scroll"s, 3, 3.0},
+        {3, "scroll"s, 3, 3.5},
+        {6, "exit"s, 6, 6.0},
+    };
+    verifyIteratorOutput(expectedFields, joiner);
+    verifyIteratorBatchOutput(expectedFields, joiner, 2);
+
+    verifyIteratorOutput({
+        {any(), "lost"s, any(), any()},
+        {1, "open"s, any(), any()},
+        {3, "click"s, 3, 3.0},
+        {3, "click"s, 3, 3.5},
+        {3, "scroll"s, 3, 3.0},
+        {3, "scroll"s, 3, 3.5},
+        {4, "close"s, any(), any()},
+        {6, "exit"s, 6, 6.0},
+    }, makeJoiner(JoinType::LeftOuter));
+
+    verifyIteratorOutput({
+        {3, "click"s},
+        {3, "scroll"s},
+        {6, "exit"s},
+    }, makeJoiner(JoinType::Semi));
+
+    verifyIteratorOutput({
+        {any(), "lost"s},
+        {1, "open"s},
+        {4, "close"s},
+    }, makeJoiner(JoinType::Anti));
+}
+
+TEST(MergeJoinerTests, SameAsHashJoinTest)
+{
+    Metadata leftMetadata{{"a", tiInt}, {"b", tiString}, {"seq", tiInt}};
+    Metadata rightMetadata{{"x", tiInt}, {"y", tiString}, {"v", tiInt}};
+
+    mt19937 gen(9);
+    uniform_int_distribution<int> dist(0, 50);
+    vector<string> leftLines;
+    vector<string> rightLines;
+    for (int i = 0; i < 3000; ++i) {
+        leftLines.push_back(to_string(dist(gen)) + ", k" + to_string(dist(gen) % 3) + "," + to_string(i));
+        rightLines.push_back(to_string(dist(gen) + 10) + ", k" + to_string(dist(gen) % 4) + "," + to_string(i));
+    }
+
+    const vector<SortKey> leftKeys{{"a"}, {"b"}};
+    const vector<SortKey> rightKeys{{"x"}, {"y"}};
+    for (auto joinType: {JoinType::Inner, JoinType::LeftOuter, JoinType::Semi, JoinType::Anti}) {
+        auto hashJoiner = makeIterator<HashJoiner>(
+            makeIterator<Sorter>(makeIterator<MockScanner>(rightMetadata, rightLines), rightKeys),
+            makeIterator<Sorter>(makeIterator<MockScanner>(leftMetadata, leftLines), leftKeys),
+            vector<string>{"x", "y"}, vector<string>{"a", "b"}, joinType);
+        hashJoiner->open();
+        vector<vector<any>> expectedFields;
+        while (auto row = hashJoiner->processNext()) {
+            expectedFields.push_back(std::move(*row));
+        }
+        EXPECT_FALSE(expectedFields.empty());
+
+        auto mergeJoiner = makeIterator<MergeJoiner>(
+            makeIterator<Sorter>(makeIterator<MockScanner>(leftMetadata, leftLines), leftKeys),
+            makeIterator<Sorter>(makeIterator<MockScanner>(rightMetadata, rightLines), rightKeys),
+            vector<string>{"a", "b"}, vector<string>{"x", "y"}, joinType);
+        EXPECT_TRUE(mergeJoiner->getMetadata() == hashJoiner->getMetadata());
+        verifyIteratorOutput(expectedFields, mergeJoiner);
+    }
+}
+
+TEST(MergeJoinerTests, UnsortedTest)
+{
+    Metadata metadata{{"k", tiInt}};
+    vector<string> sortedLines{"1", "2", "3"};
+    vector<string> unsortedLines{"1", "3", "2"};
+
+    auto joiner = makeIterator<MergeJoiner>(makeIterator<MockScanner>(metadata, unsortedLines),
+        makeIterator<MockScanner>(metadata, sortedLines), vector<string>{"k"});
+    EXPECT_THROW(joiner->open(), UnsortedInput);
+
+    joiner = makeIterator<MergeJoiner>(makeIterator<MockScanner>(metadata, sortedLines),
+        makeIterator<MockScanner>(metadata, unsortedLines), vector<string>{"k"});
+    EXPECT_THROW(joiner->open(), UnsortedInput);
+
+    Metadata other{{"k", tiString}};
+    EXPECT_THROW(makeIterator<MergeJoiner>(makeIterator<MockScanner>(metadata, sortedLines),
+        makeIterator<MockScanner>(other, sortedLines), vector<string>{"k"}), UnsupportedOperation);
+}
+
+TEST(MergeJoinerTests, NaNTest)
+{
+    Metadata leftMetadata{{"k", tiDouble}, {"seq", tiInt}};
+    Metadata rightMetadata{{"k", tiDouble}, {"v", tiInt}};
+    vector<string> leftLines{"1, 1", "3, 3", "nan, 2", "nan, 4"};
+    vector<string> rightLines{"1, 10", "2, 20", "3, 30", "nan, 40", "nan, 50"};
+
+    auto makeJoiner = [&](const vector<string>& lines, JoinType joinType) {
+        return makeIterator<MergeJoiner>(makeIterator<MockScanner>(leftMetadata, lines),
+            makeIterator<MockScanner>(rightMetadata, rightLines), vector<string>{"k"}, joinType);
+    };
+
+    // NaN sorts after any other number, and equals no value like null.
+    verifyIteratorOutput({
+        {1.0, 1, 1.0, 10},
+        {3.0, 3, 3.0, 30},
+    }, makeJoiner(leftLines, JoinType::Inner));
+
+    auto joiner = makeJoiner(leftLines, JoinType::Anti);
+    joiner->open();
+    vector<int> seq;
+    while (auto row = joiner->processNext()) {
+        seq.push_back(any_cast<int>((*row)[1]));
+    }
+    EXPECT_EQ(seq, (vector<int>{2, 4}));
+
+    joiner = makeJoiner({"1, 1", "nan, 2", "3, 3"}, JoinType::Inner);
+    EXPECT_THROW(joiner->open(), UnsortedInput);
+}
@@ -0,0 +1,284 @@
+/**
+ * Copyright (C) 2021-present Codein Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify it under the terms of
+ * BSD-3-Clause License which can be found at the root directory of this repository.
+ */
+
+#include <algorithm>
+#include <any>
+#include <filesystem>
+#include <fstream>
+#include <gtest/gtest.h>
+#include <string>
+#include <vector>
+
+#include "any_visitor.h"
+#include "csv_file_scanner.h"
+#include "parallel_csv_file_scanner.h"
+#include "util.h"
+
+using namespace std;
+using namespace codein;
+
+namespace {
+
+constexpr int kNumLines = 20000;
+
+// Writes lines of "id, name, value" where every 7th line is invalid.
+void writeTestFiles()
+{
+    ofstream mfs("parallel_scan.txt");
+    mfs << "id/int, name/string, value/double\n";
+
+    ofstream dfs("parallel_scan.csv");
+    for (int i = 0; i < kNumLines; ++i) {
+        if (i % 7 == 3) {
+            dfs << "invalid line " << i << "\n";
+        }
+        else {
+            dfs << i << ", name" << i << ", " << i * 0.5 << "\n";
+        }
+    }
+}
+
+vector<vector<any>> readAll(const unique_ptr<Iterator>& scanner)
+{
+    vector<vector<any>> rows;
+    scanner->open();
+    while (scanner->hasNext()) {
+        auto row = scanner->processNext();
+        if (!row) {
+            break;
+        }
+        rows.emplace_back(std::move(row.value()));
+    }
+
+    return rows;
+}
+
+void expectSameRows(const vector<vector<any>>& actual, const vector<vector<any>>& expected)
+{
+    ASSERT_EQ(actual.size(), expected.size());
+    for (size_t i = 0; i < expected.size(); ++i) {
+        ASSERT_EQ(actual[i].size(), expected[i].size()) << i;
+        for (size_t k = 0; k < expected[i].size(); ++k) {
+            EXPECT_TRUE(actual[i][k] == expected[i][k]) << i << ", " << k;
+        }
+    }
+}
+
+}
+
+class ParallelCsvFileScannerTests : public ::testing::Test {
+protected:
+    static void SetUpTestSuite()
+    {
+        writeTestFiles();
+    }
+};
+
+TEST_F(ParallelCsvFileScannerTests, OrderedTest)
+{
+    auto expected = readAll(makeIterator<CsvFileScanner>("parallel_scan.txt", "parallel_scan.csv"));
+    EXPECT_EQ(expected.size(), kNumLines - (kNumLines + 3) / 7);
+
+    for (size_t numThreads: {1, 2, 7, 32}) {
+        auto scanner = makeIterator<ParallelCsvFileScanner>("parallel_scan.txt", "parallel_scan.csv", kAlwaysTrue,
+            ParallelCsvScanOptions{.numThreads = numThreads, .batchSize = 100});
+        EXPECT_TRUE(scanner->getMetadata() == makeIterator<CsvFileScanner>("parallel_scan.txt", "parallel_scan.csv")->getMetadata());
+        expectSameRows(readAll(scanner), expected);
+        EXPECT_FALSE(scanner->hasNext());
+
+        scanner->reopen();
+        expectSameRows(readAll(scanner), expected);
+    }
+}
+
+TEST_F(ParallelCsvFileScannerTests, UnorderedTest)
+{
+    auto scanner = makeIterator<ParallelCsvFileScanner>("parallel_scan.txt", "parallel_scan.csv", kAlwaysTrue,
+        ParallelCsvScanOptions{.numThreads = 8, .ordered = false, .batchSize = 64, .queueCapacity = 1});
+    auto rows = readAll(scanner);
+
+    vector<int> ids;
+    for (const auto& row: rows) {
+        ids.push_back(any_cast<int>(row[0]));
+    }
+    sort(ids.begin(), ids.end());
+
+    vector<int> expectedIds;
+    for (int i = 0; i < kNumLines; ++i) {
+        if (i % 7 != 3) {
+            expectedIds.push_back(i);
+        }
+    }
+    EXPECT_EQ(ids, expectedIds);
+}
+
+TEST_F(ParallelCsvFileScannerTests, FilterProjectionTest)
+{
+    // id % 1000 == 0
+    Expression filterExpr {
+        .opCode = OpCode::Eq,
+        .leafOrChildren = vector<Expression>{
+            {OpCode::Mod, vector<Expression>{
+                {OpCode::Ref, any("id"s)},
+                {OpCode::Const, any(1000)},
+            }},
+            {OpCode::Const, any(0)},
+        }
+    };
+    vector<Expression> projections {
+        {OpCode::Ref, any("name"s)},
+        {OpCode::Add, vector<Expression>{
+            {OpCode::Ref, any("value"s)},
+            {OpCode::Const, any(1.0)},
+        }},
+    };
+
+    vector<vector<any>> expected;
+    for (int i = 0; i < kNumLines; i += 1000) {
+        if (i % 7 != 3) {
+            expected.push_back({"name"s + to_string(i), i * 0.5 + 1.0});
+        }
+    }
+
+    auto scanner = makeIterator<ParallelCsvFileScanner>("parallel_scan.txt", "parallel_scan.csv", filterExpr, projections,
+        ParallelCsvScanOptions{.numThreads = 4});
+    verifyIteratorOutput(expected, scanner);
+
+    scanner = makeIterator<ParallelCsvFileScanner>("parallel_scan.txt", "parallel_scan.csv", filterExpr, projections,
+        ParallelCsvScanOptions{.numThreads = 4, .batchSize = 3});
+    verifyIteratorBatchOutput(expected, scanner, 2);
+}
+
+TEST_F(ParallelCsvFileScannerTests, BatchTest)
+{
+    auto expected = readAll(makeIterator<CsvFileScanner>("parallel_scan.txt", "parallel_scan.csv"));
+    auto scanner = makeIterator<ParallelCsvFileScanner>("parallel_scan.txt", "parallel_scan.csv", kAlwaysTrue,
+        ParallelCsvScanOptions{.numThreads = 3, .batchSize = 500});
+
+    vector<vector<any>> rows;
+    while (auto batch = scanner->processNextBatch(300)) {
+        EXPECT_LE(batch->numRows(), 300);
+        for (size_t i = 0; i < batch->numRows(); ++i) {
+            rows.emplace_back(batch->row(i));
+        }
+    }
+    expectSameRows(rows, expected);
+}
+
+TEST_F(ParallelCsvFileScannerTests, SmallFilesTest)
+{
+    const vector<pair<string, string>> files{
+        {"metadata.txt", "data.csv"},
+        {"metadata1.txt", "data1.csv"},
+        {"metadata2.txt", "data2.csv"},
+        {"fileScanner_filter_test.txt", "fileScanner_filter_test.csv"},
+        {"different_fields2.txt", "different_fields2.csv"},
+    };
+
+    for (const auto& [metadataFileName, dataFileName]: files) {
+        auto expected = readAll(makeIterator<CsvFileScanner>(metadataFileName, dataFileName));
+        auto actual = readAll(makeIterator<ParallelCsvFileScanner>(metadataFileName, dataFileName, kAlwaysTrue,
+            ParallelCsvScanOptions{.numThreads = 16}));
+        expectSameRows(actual, expected);
+    }
+}
+
+TEST_F(ParallelCsvFileScannerTests, FailTest)
+{
+    EXPECT_THROW(makeIterator<ParallelCsvFileScanner>("metadata.txt", "Danta.csv"), NonExistentFile);
+    EXPECT_THROW(makeIterator<ParallelCsvFileScanner>("hello.txt", "data.csv"), NonExistentFile);
+
+    // Exceptions thrown by workers are rethrown to the consumer.
+    Expression unknownName{OpCode::Ref, any("unknown"s)};
+    auto scanner = makeIterator<ParallelCsvFileScanner>("parallel_scan.txt", "parallel_scan.csv", unknownName,
+        ParallelCsvScanOptions{.numThreads = 4});
+    EXPECT_THROW(scanner->processNext(), UnknownName);
+    EXPECT_FALSE(scanner->processNext().has_value());
+
+    // Every line of parallel_scan.csv is invalid for this metadata.
+    {
+        ofstream mfs("parallel_scan_wrong.txt");
+        mfs << "id/int, name/int, value/double\n";
+    }
+    scanner = makeIterator<ParallelCsvFileScanner>("parallel_scan_wrong.txt", "parallel_scan.csv", kAlwaysTrue,
+        ParallelCsvScanOptions{.numThreads = 4});
+    EXPECT_THROW(scanner->processNext(), WrongMetadata);
+}
+
+class ParallelCsvFileScannerConversionTests : public ::testing::Test {
+protected:
+    void SetUp() override
+    {
+        ofstream mfs(metadataFileName);
+        mfs << "a/int, b/double, c/string\n";
+
+        // Lines filtered out by a > 1 have invalid fields of b, and are more than the error
+        // lines a range takes before throwing WrongMetadata.
+        ofstream dfs(dataFileName);
+        for (int i = 0; i < 40; ++i) {
+            dfs << "1, not a number, x\n";
+        }
+        dfs << "2, not a number, y\n"
+            << "3, 1.5\n"
+            << "4, 2.5, z\n";
+    }
+
+    void TearDown() override
+    {
+        filesystem::remove(metadataFileName);
+        filesystem::remove(dataFileName);
+    }
+
+    const string metadataFileName = (filesystem::temp_directory_path() / "falcon_parallel_conversion_test.txt").string();
+    const string dataFileName = (filesystem::temp_directory_path() / "falcon_parallel_conversion_test.csv").string();
+    // a > 1
+    const Expression filterExpr {
+        .opCode = OpCode::Gt,
+        .leafOrChildren = vector<Expression>{
+            {OpCode::Ref, any("a"s)},
+            {OpCode::Const, any(1)},
+        }
+    };
+};
+
+TEST_F(ParallelCsvFileScannerConversionTests, LateConversionTest)
+{
+    // Fields are converted only if the filter or projections refer to them, and fields only
+    // projections refer to are converted after the line passes the filter.
+    const vector<pair<vector<string>, vector<vector<any>>>> cases{
+        {{"c"}, {{"y"s}, {"z"s}}},
+        {{"c", "b"}, {{"z"s, 2.5}}},
+        {{"a", "b", "c"}, {{4, 2.5, "z"s}}},
+    };
+
+    // A single thread scans every line in one range.
+    for (size_t numThreads: {1, 4}) {
+        for (const auto& [columns, expectedFields]: cases) {
+            vector<Expression> projections;
+            for (const auto& column: columns) {
+                projections.push_back({OpCode::Ref, any(column)});
+            }
+
+            verifyIteratorOutput(expectedFields, makeIterator<ParallelCsvFileScanner>(metadataFileName, dataFileName,
+                filterExpr, projections, ParallelCsvScanOptions{.numThreads = numThreads}));
+            verifyIteratorBatchOutput(expectedFields, makeIterator<ParallelCsvFileScanner>(metadataFileName,
+                dataFileName, filterExpr, projections, ParallelCsvScanOptions{.numThreads = numThreads, .batchSize = 1}), 2);
+        }
+    }
+
+    // Converting b to filter lines makes most lines error lines.
+    const Expression filterOnB {
+        .opCode = OpCode::Gt,
+        .leafOrChildren = vector<Expression>{
+            {OpCode::Ref, any("b"s)},
+            {OpCode::Const, any(1.0)},
+        }
+    };
+    auto scanner = makeIterator<ParallelCsvFileScanner>(metadataFileName, dataFileName, filterOnB,
+        ParallelCsvScanOptions{.numThreads = 1});
+    EXPECT_THROW(readAll(scanner), WrongMetadata);
+}
@@ -0,0 +1,181 @@
+/**
+ * Copyright (C) 2021-present Codein Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify it under the terms of
+ * BSD-3-Clause License which can be found at the root directory of this repository.
+ */
+
+#include <any>
+#include <filesystem>
+#include <gtest/gtest.h>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "any_visitor.h"
+#include "columnar_file.h"
+#include "columnar_file_scanner.h"
+#include "csv_file_scanner.h"
+#include "expression.h"
+#include "filter.h"
+#include "limiter.h"
+#include "predicate_pushdown.h"
+#include "projector.h"
+#include "sequencer.h"
+#include "util.h"
+
+using namespace std;
+using namespace codein;
+
+namespace {
+
+const string kMetadataFileName = "fileScanner_filter_test.txt";
+const string kDataFileName = "fileScanner_filter_test.csv";
+
+vector<vector<any>> readAll(const unique_ptr<Iterator>& plan)
+{
+    vector<vector<any>> rows;
+    plan->open();
+    while (plan->hasNext()) {
+        auto row = plan->processNext();
+        if (!row) {
+            break;
+        }
+        rows.emplace_back(std::move(row.value()));
+    }
+
+    return rows;
+}
+
+// a == 1u
+const Expression kAEqualsOne{
+    .opCode = OpCode::Eq,
+    .leafOrChildren = vector<Expression>{
+        {.opCode = OpCode::Ref, .leafOrChildren = any("a"s)},
+        {.opCode = OpCode::Const, .leafOrChildren = any(1u)},
+    }
+};
+
+}
+
+TEST(PredicatePushdownTests, ProjectorTest)
+{
+    vector<Expression> projections{
+        {.opCode = OpCode::Ref, .leafOrChildren = any("d"s)},
+        {
+            .opCode = OpCode::Add,
+            .leafOrChildren = vector<Expression>{
+                {.opCode = OpCode::Ref, .leafOrChildren = any("b"s)},
+                {.opCode = OpCode::Ref, .leafOrChildren = any("c"s)},
+            }
+        },
+    };
+    const Metadata metadata{{"name", tiString}, {"bc", tiInt}};
+
+    // bc > 12
+    Expression filterExpr{
+        .opCode = OpCode::Gt,
+        .leafOrChildren = vector<Expression>{
+            {.opCode = OpCode::Ref, .leafOrChildren = any("bc"s)},
+            {.opCode = OpCode::Const, .leafOrChildren = any(12)},
+        }
+    };
+
+    auto plan = PredicatePushdown::apply(makeIterator<Filter>(
+        makeIterator<Projector>(makeIterator<CsvFileScanner>(kMetadataFileName, kDataFileName), projections, metadata),
+        filterExpr));
+    EXPECT_NE(dynamic_cast<Projector*>(plan.get()), nullptr);
+    EXPECT_TRUE(plan->getMetadata() == metadata);
+
+    const vector<vector<any>> expected{
+        {"Paldo"s, 16},
+        {"Paldo"s, 17},
+        {"Nongshim"s, 44},
+        {"OTTOGI"s, 15},
+        {"Samyang"s, 16},
+    };
+    verifyIteratorOutput(expected, plan);
+    plan->reopen();
+    verifyIteratorBatchOutput(expected, plan, 2);
+
+    // Filters on filters are pushed down together.
+    plan = PredicatePushdown::apply(makeIterator<Filter>(
+        makeIterator<Filter>(
+            makeIterator<Projector>(
+                makeIterator<CsvFileScanner>(kMetadataFileName, kDataFileName), projections, metadata),
+            filterExpr),
+        Expression{
+            .opCode = OpCode::Eq,
+            .leafOrChildren = vector<Expression>{
+                {.opCode = OpCode::Ref, .leafOrChildren = any("name"s)},
+                {.opCode = OpCode::Const, .leafOrChildren = any("Paldo"s)},
+            }
+        }));
+    EXPECT_NE(dynamic_cast<Projector*>(plan.get()), nullptr);
+    verifyIteratorOutput({{"Paldo"s, 16}, {"Paldo"s, 17}}, plan);
+}
+
+TEST(PredicatePushdownTests, SequencerTest)
+{
+    auto makePlan = []() {
+        vector<unique_ptr<Iterator>> children;
+        children.push_back(makeIterator<CsvFileScanner>(kMetadataFileName, kDataFileName));
+        children.push_back(makeIterator<Limiter>(makeIterator<CsvFileScanner>(kMetadataFileName, kDataFileName), 5));
+        return makeIterator<Filter>(makeIterator<Sequencer>(std::move(children)), kAEqualsOne);
+    };
+
+    const auto expected = readAll(makePlan());
+    EXPECT_EQ(expected.size(), 7);
+
+    auto plan = PredicatePushdown::apply(makePlan());
+    EXPECT_NE(dynamic_cast<Sequencer*>(plan.get()), nullptr);
+    verifyIteratorOutput(expected, plan);
+}
+
+TEST(PredicatePushdownTests, ColumnarFileScannerTest)
+{
+    const string fileName = (filesystem::temp_directory_path() / "falcon_pushdown_test.col").string();
+    auto csv = makeIterator<CsvFileScanner>(kMetadataFileName, kDataFileName);
+    writeColumnarFile(*csv, fileName);
+
+    auto makePlan = [&fileName]() {
+        return makeIterator<Filter>(makeIterator<ColumnarFileScanner>(fileName, vector<string>{"a", "d"}), kAEqualsOne);
+    };
+
+    const auto expected = readAll(makePlan());
+    EXPECT_EQ(expected.size(), 5);
+
+    auto plan = PredicatePushdown::apply(makePlan());
+    EXPECT_NE(dynamic_cast<ColumnarFileScanner*>(plan.get()), nullptr);
+    verifyIteratorOutput(expected, plan);
+
+    filesystem::remove(fileName);
+}
+
+TEST(PredicatePushdownTests, NotPushedTest)
+{
+    // Filters are not pushed below Limiter.
+    auto makePlan = []() {
+        return makeIterator<Filter>(
+            makeIterator<Limiter>(makeIterator<CsvFileScanner>(kMetadataFileName, kDataFileName), 5), kAEqualsOne);
+    };
+
+    const auto expected = readAll(makePlan());
+    EXPECT_EQ(expected.size(), 2);
+
+    auto plan = PredicatePushdown::apply(makePlan());
+    EXPECT_NE(dynamic_cast<Filter*>(plan.get()), nullptr);
+    verifyIteratorOutput(expected, plan);
+
+    // A filter referring to an unknown column stays to throw.
+    Expression unknownExpr{
+        .opCode = OpCode::Eq,
+        .leafOrChildren = vector<Expression>{
+            {.opCode = OpCode::Ref, .leafOrChildren = any("x"s)},
+            {.opCode = OpCode::Const, .leafOrChildren = any(1u)},
+        }
+    };
+    plan = PredicatePushdown::apply(
+        makeIterator<Filter>(makeIterator<CsvFileScanner>(kMetadataFileName, kDataFileName), unknownExpr));
+    EXPECT_NE(dynamic_cast<Filter*>(plan.get()), nullptr);
+}
@@ -15,8 +15,10 @@
 #include "csv_file_scanner.h"
 #include "expression.h"
 #include "metadata.h"
+#include "mock_scanner.h"
 #include "projector.h"
 #include "to_any_converter.h"
+#include "util.h"
 
 using namespace std;
 using namespace codein;
@@ -178,3 +180,40 @@ TEST_F(ProjectorTests, ProjExprTest)
         EXPECT_TRUE(val[i] == expected[i]);
     }
 }
+
+TEST_F(ProjectorTests, BatchTest)
+{
+    vector<Expression> projections{
+        // c * 2
+        {
+            .opCode = OpCode::Mult,
+            .leafOrChildren = vector<Expression>{
+                {.opCode = OpCode::Ref, .leafOrChildren = any("c"s)},
+                {.opCode = OpCode::Const, .leafOrChildren = any(2)},
+            }
+        },
+        {.opCode = OpCode::Ref, .leafOrChildren = any("e"s)},
+    };
+
+    Metadata expectedMetadata{
+        {"c2", tiInt},
+        {"e", tiString},
+    };
+
+    vector<string> mockLines{
+        "1.1, 1.5, 1, 1, one",
+        "2.2, 2.5, 2, 2, two",
+        "3.3, 3.5, 3, 3, three",
+    };
+
+    vector<vector<any>> expectedFields{
+        {2, "one"s},
+        {4, "two"s},
+        {6, "three"s},
+    };
+
+    auto mockScanner = makeIterator<MockScanner>(metadata, mockLines);
+    auto projector = makeIterator<Projector>(std::move(mockScanner), projections, expectedMetadata);
+    ASSERT_TRUE(projector->getMetadata() == expectedMetadata);
+    verifyIteratorBatchOutput(expectedFields, projector, 2);
+}
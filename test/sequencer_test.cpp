@@ -221,3 +221,24 @@ TEST (SequencerTests, DifferentMetadatTest)
 
     EXPECT_THROW(makeIterator<Sequencer>(std::move(children)), DiscrepantOutputData);
 }
+
+TEST(SequencerTests, BatchTest) 
+{
+    vector<unique_ptr<Iterator>> children;
+    Metadata metadata {
+        {"a", tiInt}, {"b", tiString}
+    };
+
+    children.emplace_back(makeIterator<MockScanner>(metadata, vector<string>{"1, one", "2, two", "3, three"}));
+    children.emplace_back(makeIterator<MockScanner>(metadata, vector<string>{}));
+    children.emplace_back(makeIterator<MockScanner>(metadata, vector<string>{"4, four"}));
+
+    vector<vector<any>> expectedFields {
+        {1, "one"s},
+        {2, "two"s},
+        {3, "three"s},
+        {4, "four"s},
+    };
+
+    verifyIteratorBatchOutput(expectedFields, makeIterator<Sequencer>(std::move(children)), 2);
+}
@@ -0,0 +1,157 @@
+/**
+ * Copyright (C) 2021-present Codein Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify it under the terms of
+ * BSD-3-Clause License which can be found at the root directory of this repository.
+ */
+
+#include <algorithm>
+#include <any>
+#include <gtest/gtest.h>
+#include <memory>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "any_visitor.h"
+#include "iterator.h"
+#include "metadata.h"
+#include "mock_scanner.h"
+#include "sorter.h"
+#include "util.h"
+
+using namespace std;
+using namespace codein;
+
+namespace {
+
+Metadata makeMetadata()
+{
+    return {{"a", tiInt}, {"b", tiString}, {"c", tiDouble}};
+}
+
+vector<string> makeLines()
+{
+    return {
+        "2, x, 1.5",
+        "1, y, 2.5",
+        ", z, 0.5",
+        "2, y, 3.5",
+        "1, x, 4.5",
+        "3, x, ",
+        "2, x, 5.5",
+    };
+}
+
+}
+
+TEST(SorterTests, BasicTest)
+{
+    // Nulls come first in ascending order, and ties keep the input order.
+    vector<vector<any>> expectedFields{
+        {any(), "z"s, 0.5},
+        {1, "y"s, 2.5},
+        {1, "x"s, 4.5},
+        {2, "x"s, 1.5},
+        {2, "y"s, 3.5},
+        {2, "x"s, 5.5},
+        {3, "x"s, any()},
+    };
+
+    auto sorter = makeIterator<Sorter>(makeIterator<MockScanner>(makeMetadata(), makeLines()), vector<SortKey>{{"a"}});
+    EXPECT_FALSE(sorter->hasNext());
+    EXPECT_TRUE(sorter->getMetadata() == makeMetadata());
+    verifyIteratorOutput(expectedFields, sorter);
+}
+
+TEST(SorterTests, MultiKeyTest)
+{
+    vector<vector<any>> expectedFields{
+        {3, "x"s, any()},
+        {2, "x"s, 5.5},
+        {2, "x"s, 1.5},
+        {2, "y"s, 3.5},
+        {1, "x"s, 4.5},
+        {1, "y"s, 2.5},
+        {any(), "z"s, 0.5},
+    };
+
+    const vector<SortKey> keys{{"a", true}, {"b"}, {"c", true}};
+    auto sorter = makeIterator<Sorter>(makeIterator<MockScanner>(makeMetadata(), makeLines()), keys);
+    verifyIteratorOutput(expectedFields, sorter);
+
+    sorter = makeIterator<Sorter>(makeIterator<MockScanner>(makeMetadata(), makeLines()), keys);
+    verifyIteratorBatchOutput(expectedFields, sorter, 3);
+}
+
+TEST(SorterTests, SpillTest)
+{
+    Metadata metadata{{"k", tiInt}, {"s", tiString}, {"seq", tiInt}};
+
+    mt19937 gen(11);
+    uniform_int_distribution<int> dist(0, 999);
+    vector<string> lines;
+    vector<vector<any>> expectedFields;
+    for (int i = 0; i < 20000; ++i) {
+        const int k = dist(gen);
+        const auto s = "value" + to_string(k % 7);
+        lines.push_back(to_string(k) + "," + s + "," + to_string(i));
+        expectedFields.push_back({k, s, i});
+    }
+
+    // Descending by s, ascending by k, and in input order for ties.
+    stable_sort(expectedFields.begin(), expectedFields.end(), [](const auto& lhs, const auto& rhs) {
+        const auto& ls = any_cast<const string&>(lhs[1]);
+        const auto& rs = any_cast<const string&>(rhs[1]);
+        return ls != rs ? rs < ls : any_cast<int>(lhs[0]) < any_cast<int>(rhs[0]);
+    });
+
+    const vector<SortKey> keys{{"s", true}, {"k"}};
+    for (const auto& options: {
+        SorterOptions{},
+        SorterOptions{.memoryBudget = 64 * 1024},
+        SorterOptions{.memoryBudget = 16 * 1024, .maxMergeFanIn = 3},
+    }) {
+        auto sorter = makeIterator<Sorter>(makeIterator<MockScanner>(metadata, lines), keys, options);
+        verifyIteratorBatchOutput(expectedFields, sorter, 1000);
+
+        // Reopening sorts again.
+        sorter->reopen();
+        size_t n = 0;
+        while (auto row = sorter->processNext()) {
+            EXPECT_EQ(any_cast<int>((*row)[2]), any_cast<int>(expectedFields[n][2]));
+            ++n;
+        }
+        EXPECT_EQ(n, expectedFields.size());
+    }
+}
+
+TEST(SorterTests, NaNTest)
+{
+    Metadata metadata{{"k", tiDouble}, {"seq", tiInt}};
+    const vector<string> lines{"3, 0", "nan, 1", "1, 2", "2, 3", ", 4", "0, 5", "nan, 6"};
+
+    // NaN comes after any other number, and NaN rows stay together in the input order.
+    for (const auto& [descending, expectedSeq]: {
+        pair{false, vector<int>{4, 5, 2, 3, 0, 1, 6}},
+        pair{true, vector<int>{1, 6, 0, 3, 2, 5, 4}},
+    }) {
+        for (const auto& options: {SorterOptions{}, SorterOptions{.memoryBudget = 1}}) {
+            auto sorter = makeIterator<Sorter>(
+                makeIterator<MockScanner>(metadata, lines), vector<SortKey>{{"k", descending}}, options);
+            sorter->open();
+            vector<int> seq;
+            while (auto row = sorter->processNext()) {
+                seq.push_back(any_cast<int>((*row)[1]));
+            }
+            EXPECT_EQ(seq, expectedSeq);
+        }
+    }
+}
+
+TEST(SorterTests, FailTest)
+{
+    auto child = makeIterator<MockScanner>(makeMetadata(), makeLines());
+    EXPECT_THROW(makeIterator<Sorter>(std::move(child), vector<SortKey>{{"x"}}), UnknownName);
+}
@@ -0,0 +1,66 @@
+/**
+ * Copyright (C) 2021-present Codein Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify it under the terms of
+ * BSD-3-Clause License which can be found at the root directory of this repository.
+ */
+
+#include <any>
+#include <gtest/gtest.h>
+#include <string>
+#include <vector>
+
+#include "any_visitor.h"
+#include "spill_file.h"
+
+using namespace std;
+using namespace codein;
+
+TEST(SpillFileTests, BasicTest)
+{
+    const vector<vector<any>> rows{
+        {true, -1, 2u, 1.5f, 2.5, "abc"s},
+        {any(), ""s, string(10000, 'x')},
+        {},
+        {string(200000, 'y'), 3},
+        {false},
+    };
+
+    // The buffer is allocated only while writing or reading.
+    SpillFile file;
+    EXPECT_EQ(file.memoryUsage(), 0);
+    for (const auto& row: rows) {
+        file.write(row);
+    }
+    EXPECT_EQ(file.numRows(), rows.size());
+    EXPECT_GT(file.memoryUsage(), 0);
+
+    // Rows can be read more than once.
+    for (int pass = 0; pass < 2; ++pass) {
+        file.rewind();
+        EXPECT_EQ(file.memoryUsage(), 0);
+
+        vector<any> row;
+        for (const auto& expected: rows) {
+            ASSERT_TRUE(file.read(row));
+            EXPECT_GT(file.memoryUsage(), 0);
+            ASSERT_EQ(row.size(), expected.size());
+            for (size_t i = 0; i < row.size(); ++i) {
+                EXPECT_EQ(row[i].type(), expected[i].type()) << i;
+                if (expected[i].has_value()) {
+                    EXPECT_TRUE(row[i] == expected[i]) << i;
+                }
+            }
+        }
+        EXPECT_FALSE(file.read(row));
+        EXPECT_EQ(file.memoryUsage(), 0);
+    }
+}
+
+TEST(SpillFileTests, FailTest)
+{
+    EXPECT_THROW(SpillFile("/nonexistent/directory"), SpillFailure);
+
+    SpillFile file(".");
+    EXPECT_THROW(file.write({vector<int>{1}}), UnsupportedOperation);
+}
@@ -0,0 +1,125 @@
+/**
+ * Copyright (C) 2021-present Codein Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify it under the terms of
+ * BSD-3-Clause License which can be found at the root directory of this repository.
+ */
+
+#include <gtest/gtest.h>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "csv_file_scanner.h"
+#include "structural_scanner.h"
+
+using namespace std;
+using namespace codein;
+
+namespace {
+
+vector<string> splitNaive(string_view data)
+{
+    vector<string> fields;
+    string field;
+    for (char c: data) {
+        if (c == ',') {
+            fields.push_back(field);
+            field.clear();
+        }
+        else {
+            field += c;
+        }
+    }
+    fields.push_back(field);
+
+    for (auto& f: fields) {
+        f.erase(0, f.find_first_not_of(" \t") == string::npos ? f.size() : f.find_first_not_of(" \t"));
+        f.erase(f.find_last_not_of(" \t") + 1);
+    }
+
+    return fields;
+}
+
+string randomData(mt19937& gen, size_t size)
+{
+    static const string alphabet = "ab ,\t\n1";
+    uniform_int_distribution<size_t> dist(0, alphabet.size() - 1);
+    string data;
+    for (size_t i = 0; i < size; ++i) {
+        data += alphabet[dist(gen)];
+    }
+
+    return data;
+}
+
+}
+
+TEST(StructuralScannerTests, FindStructuralsTest)
+{
+    mt19937 gen(7);
+    for (int n = 0; n < 100; ++n) {
+        auto data = randomData(gen, kStructuralBlockSize);
+
+        uint64_t commas = 0;
+        uint64_t newlines = 0;
+        for (size_t i = 0; i < data.size(); ++i) {
+            commas |= uint64_t{data[i] == ','} << i;
+            newlines |= uint64_t{data[i] == '\n'} << i;
+        }
+
+        for (auto level: {SimdLevel::Scalar, SimdLevel::Sse2, SimdLevel::Avx2}) {
+            if (level > supportedSimdLevel()) {
+                continue;
+            }
+            auto masks = findStructurals(data.data(), level);
+            EXPECT_EQ(masks.commas, commas);
+            EXPECT_EQ(masks.newlines, newlines);
+        }
+
+        auto masks = findStructurals(data.data());
+        EXPECT_EQ(masks.commas, commas);
+        EXPECT_EQ(masks.newlines, newlines);
+    }
+}
+
+TEST(StructuralScannerTests, SplitFieldsTest)
+{
+    vector<string_view> fields;
+
+    EXPECT_EQ(splitFields("", fields, false), 0);
+    EXPECT_EQ(fields, vector<string_view>({""}));
+
+    EXPECT_EQ(splitFields(" a ,\tb,,c ", fields, false), 10);
+    EXPECT_EQ(fields, vector<string_view>({"a", "b", "", "c"}));
+
+    EXPECT_EQ(splitFields("a, b\nc,d", fields, true), 4);
+    EXPECT_EQ(fields, vector<string_view>({"a", "b"}));
+
+    EXPECT_EQ(splitFields("\na", fields, true), 0);
+    EXPECT_EQ(fields, vector<string_view>({""}));
+
+    // Fields spanning block boundaries
+    string longLine = string(100, 'x') + "," + string(30, ' ') + "y" + string(40, ' ') + ",z";
+    string data = longLine + "\nw";
+    EXPECT_EQ(splitFields(data, fields, true), longLine.size());
+    EXPECT_EQ(vector<string>(fields.begin(), fields.end()), vector<string>({string(100, 'x'), "y", "z"}));
+}
+
+TEST(StructuralScannerTests, RandomSplitFieldsTest)
+{
+    mt19937 gen(11);
+    vector<string_view> fields;
+    for (size_t size: {1, 17, 63, 64, 65, 128, 200, 1000}) {
+        auto data = randomData(gen, size);
+
+        parseLine(data, fields);
+        EXPECT_EQ(vector<string>(fields.begin(), fields.end()), splitNaive(data));
+
+        auto lineEnd = data.find('\n');
+        auto lineSize = lineEnd == string::npos ? data.size() : lineEnd;
+        EXPECT_EQ(splitFields(data, fields, true), lineSize);
+        EXPECT_EQ(vector<string>(fields.begin(), fields.end()), splitNaive(string_view(data).substr(0, lineSize)));
+    }
+}
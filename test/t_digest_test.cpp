@@ -0,0 +1,83 @@
+/**
+ * Copyright (C) 2021-present Codein Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify it under the terms of
+ * BSD-3-Clause License which can be found at the root directory of this repository.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <gtest/gtest.h>
+#include <random>
+#include <vector>
+
+#include "t_digest.h"
+
+using namespace std;
+using namespace codein;
+
+TEST(TDigestTests, QuantileTest)
+{
+    TDigest digest;
+    EXPECT_TRUE(isnan(digest.quantile(0.5)));
+    EXPECT_EQ(digest.memoryUsage(), sizeof(TDigest));
+
+    digest.add(3.0);
+    EXPECT_EQ(digest.quantile(0.5), 3.0);
+
+    mt19937 gen(7);
+    exponential_distribution<double> dist(0.01);
+    vector<double> values;
+    for (int i = 0; i < 100000; ++i) {
+        values.push_back(dist(gen));
+    }
+
+    TDigest latencies;
+    for (auto v: values) {
+        latencies.add(v);
+    }
+    EXPECT_EQ(latencies.totalWeight(), values.size());
+    EXPECT_LE(latencies.numCentroids(), 200);
+    // Centroids and buffered values are bounded by the compression.
+    EXPECT_LT(latencies.memoryUsage(), 16 * 1024);
+
+    sort(values.begin(), values.end());
+    EXPECT_EQ(latencies.quantile(0), values.front());
+    EXPECT_EQ(latencies.quantile(1), values.back());
+
+    // Errors are measured in ranks, which are smaller near the tails.
+    auto rankError = [&](double q) {
+        const auto estimate = latencies.quantile(q);
+        const auto rank = lower_bound(values.begin(), values.end(), estimate) - values.begin();
+        return abs(double(rank) / values.size() - q);
+    };
+    EXPECT_LT(rankError(0.5), 0.01);
+    EXPECT_LT(rankError(0.95), 0.005);
+    EXPECT_LT(rankError(0.99), 0.002);
+    EXPECT_LT(rankError(0.999), 0.0005);
+}
+
+TEST(TDigestTests, MergeTest)
+{
+    TDigest all;
+    vector<TDigest> parts(4);
+    for (int i = 0; i < 40000; ++i) {
+        parts[i % parts.size()].add(i);
+        all.add(i);
+    }
+
+    TDigest merged;
+    merged.merge(TDigest());
+    for (const auto& part: parts) {
+        merged.merge(part);
+    }
+    EXPECT_EQ(merged.totalWeight(), all.totalWeight());
+    EXPECT_LE(merged.numCentroids(), 200);
+
+    for (double q: {0.01, 0.5, 0.9, 0.99}) {
+        EXPECT_NEAR(merged.quantile(q), q * 40000, 40000 * 0.005) << q;
+        EXPECT_NEAR(merged.quantile(q), all.quantile(q), 40000 * 0.005) << q;
+    }
+    EXPECT_EQ(merged.quantile(0), 0);
+    EXPECT_EQ(merged.quantile(1), 39999);
+}
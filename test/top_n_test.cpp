@@ -0,0 +1,113 @@
+/**
+ * Copyright (C) 2021-present Codein Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify it under the terms of
+ * BSD-3-Clause License which can be found at the root directory of this repository.
+ */
+
+#include <any>
+#include <gtest/gtest.h>
+#include <memory>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "any_visitor.h"
+#include "iterator.h"
+#include "limiter.h"
+#include "metadata.h"
+#include "mock_scanner.h"
+#include "sorter.h"
+#include "top_n.h"
+#include "util.h"
+
+using namespace std;
+using namespace codein;
+
+TEST(TopNTests, BasicTest)
+{
+    Metadata metadata{{"name", tiString}, {"revenue", tiDouble}};
+
+    vector<string> lines{
+        "a, 10.5",
+        "b, 7.0",
+        "c, ",
+        "d, 30.0",
+        "e, 10.5",
+        "f, 2.0",
+    };
+
+    vector<vector<any>> expectedFields{
+        {"d"s, 30.0},
+        {"a"s, 10.5},
+        {"e"s, 10.5},
+    };
+
+    const vector<SortKey> keys{{"revenue", true}};
+    auto topN = makeIterator<TopN>(makeIterator<MockScanner>(metadata, lines), keys, 3);
+    EXPECT_FALSE(topN->hasNext());
+    EXPECT_TRUE(topN->getMetadata() == metadata);
+    verifyIteratorOutput(expectedFields, topN);
+
+    topN = makeIterator<TopN>(makeIterator<MockScanner>(metadata, lines), keys, 3);
+    verifyIteratorBatchOutput(expectedFields, topN, 2);
+
+    // Fewer rows than the limit
+    expectedFields.push_back({"b"s, 7.0});
+    expectedFields.push_back({"f"s, 2.0});
+    expectedFields.push_back({"c"s, any()});
+    topN = makeIterator<TopN>(makeIterator<MockScanner>(metadata, lines), keys, 100);
+    verifyIteratorOutput(expectedFields, topN);
+
+    topN = makeIterator<TopN>(makeIterator<MockScanner>(metadata, lines), keys, 0);
+    verifyIteratorOutput({}, topN);
+}
+
+TEST(TopNTests, SameAsSortAndLimitTest)
+{
+    Metadata metadata{{"k", tiInt}, {"seq", tiInt}};
+
+    mt19937 gen(5);
+    uniform_int_distribution<int> dist(0, 300);
+    vector<string> lines;
+    for (int i = 0; i < 5000; ++i) {
+        lines.push_back(to_string(dist(gen)) + "," + to_string(i));
+    }
+
+    for (const auto& keys: {vector<SortKey>{{"k"}}, vector<SortKey>{{"k", true}}}) {
+        for (size_t limit: {1, 10, 100, 1000}) {
+            auto expected = makeIterator<Limiter>(
+                makeIterator<Sorter>(makeIterator<MockScanner>(metadata, lines), keys), limit);
+            expected->open();
+            vector<vector<any>> expectedFields;
+            while (auto row = expected->processNext()) {
+                expectedFields.push_back(std::move(*row));
+            }
+
+            auto topN = makeIterator<TopN>(makeIterator<MockScanner>(metadata, lines), keys, limit);
+            verifyIteratorOutput(expectedFields, topN);
+        }
+    }
+}
+
+TEST(TopNTests, NaNTest)
+{
+    Metadata metadata{{"k", tiDouble}, {"seq", tiInt}};
+    const vector<string> lines{"3, 0", "nan, 1", "1, 2", "2, 3", ", 4", "0, 5", "nan, 6"};
+
+    // NaN is the largest number.
+    for (const auto& [descending, expectedSeq]: {
+        pair{false, vector<int>{4, 5, 2, 3}},
+        pair{true, vector<int>{1, 6, 0, 3}},
+    }) {
+        auto topN = makeIterator<TopN>(
+            makeIterator<MockScanner>(metadata, lines), vector<SortKey>{{"k", descending}}, 4);
+        topN->open();
+        vector<int> seq;
+        while (auto row = topN->processNext()) {
+            seq.push_back(any_cast<int>((*row)[1]));
+        }
+        EXPECT_EQ(seq, expectedSeq);
+    }
+}
@@ -0,0 +1,172 @@
+/**
+ * Copyright (C) 2021-present Codein Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify it under the terms of
+ * BSD-3-Clause License which can be found at the root directory of this repository.
+ */
+
+#include <any>
+#include <cstdint>
+#include <gtest/gtest.h>
+#include <string>
+#include <vector>
+
+#include "any_visitor.h"
+#include "batch.h"
+#include "expression.h"
+#include "metadata.h"
+#include "typed_kernel.h"
+
+using namespace std;
+using namespace codein;
+
+namespace {
+
+Expression ref(const char* name)
+{
+    return Expression{OpCode::Ref, any(string(name))};
+}
+
+Expression constant(any v)
+{
+    return Expression{OpCode::Const, std::move(v)};
+}
+
+Expression node(OpCode opCode, vector<Expression> children)
+{
+    return Expression{opCode, std::move(children)};
+}
+
+Metadata makeMetadata()
+{
+    return {{"i", tiInt}, {"u", tiUint}, {"f", tiFloat}, {"d", tiDouble}, {"s", tiString}, {"b", tiBool}};
+}
+
+Batch makeBatch(const Metadata& metadata)
+{
+    Batch batch(metadata);
+    for (int k = 0; k < 50; ++k) {
+        batch.appendRow({k - 20, unsigned(k * 3 % 17), float(k) / 4, double(k % 7) - 2.5, "s"s + to_string(k % 5), k % 3 == 0});
+    }
+
+    return batch;
+}
+
+}
+
+TEST(TypedKernelTests, PredicateKernelTest)
+{
+    const auto metadata = makeMetadata();
+    const vector<Expression> exprs{
+        node(OpCode::Gt, {ref("i"), constant(any(10))}),
+        node(OpCode::Lte, {constant(any(5u)), ref("u")}),
+        node(OpCode::Eq, {ref("s"), constant(any("s3"s))}),
+        node(OpCode::Neq, {ref("f"), constant(any(2.5f))}),
+        node(OpCode::Lt, {ref("d"), ref("d")}),
+        node(OpCode::Gte, {ref("d"), constant(any(0.5))}),
+        ref("b"),
+        constant(any(true)),
+        node(OpCode::Not, {node(OpCode::Gt, {ref("i"), constant(any(0))})}),
+        // i > 10 && s == "s1" || !b
+        node(OpCode::Or, {
+            node(OpCode::And, {
+                node(OpCode::Gt, {ref("i"), constant(any(10))}),
+                node(OpCode::Eq, {ref("s"), constant(any("s1"s))}),
+            }),
+            node(OpCode::Not, {ref("b")}),
+        }),
+    };
+
+    auto batch = makeBatch(metadata);
+    vector<uint8_t> mask;
+    for (const auto& expr: exprs) {
+        auto kernel = makePredicateKernel(expr, metadata);
+        ASSERT_TRUE(kernel);
+        ASSERT_TRUE(kernel->eval(batch, mask));
+        ASSERT_EQ(mask.size(), batch.numRows());
+        for (size_t r = 0; r < batch.numRows(); ++r) {
+            EXPECT_EQ(mask[r], any_cast<bool>(expr.eval(metadata, batch.row(r)))) << r;
+        }
+    }
+}
+
+TEST(TypedKernelTests, ColumnKernelTest)
+{
+    const auto metadata = makeMetadata();
+    const vector<Expression> exprs{
+        ref("s"),
+        node(OpCode::Add, {ref("i"), constant(any(10))}),
+        node(OpCode::Sub, {constant(any(100u)), ref("u")}),
+        node(OpCode::Mult, {ref("f"), ref("f")}),
+        node(OpCode::Div, {ref("d"), constant(any(2.0))}),
+        node(OpCode::Mod, {ref("u"), constant(any(4u))}),
+    };
+
+    auto batch = makeBatch(metadata);
+    for (const auto& expr: exprs) {
+        auto kernel = makeColumnKernel(expr, metadata);
+        ASSERT_TRUE(kernel);
+
+        Column column;
+        ASSERT_TRUE(kernel->eval(batch, column));
+        ASSERT_EQ(column.size(), batch.numRows());
+        for (size_t r = 0; r < batch.numRows(); ++r) {
+            EXPECT_TRUE(column.at(r) == expr.eval(metadata, batch.row(r))) << r;
+        }
+    }
+}
+
+TEST(TypedKernelTests, NoKernelTest)
+{
+    const auto metadata = makeMetadata();
+
+    // Shapes without kernels
+    EXPECT_FALSE(makePredicateKernel(node(OpCode::Gt, {ref("i"), constant(any(10u))}), metadata));
+    EXPECT_FALSE(makePredicateKernel(node(OpCode::Gt, {ref("i"), ref("u")}), metadata));
+    EXPECT_FALSE(makePredicateKernel(node(OpCode::Gt, {constant(any(1)), constant(any(10))}), metadata));
+    EXPECT_FALSE(makePredicateKernel(node(OpCode::Gt, {ref("x"), constant(any(10))}), metadata));
+    EXPECT_FALSE(makePredicateKernel(ref("i"), metadata));
+    EXPECT_FALSE(makePredicateKernel(node(OpCode::And, {ref("b"), ref("i")}), metadata));
+    EXPECT_FALSE(makeColumnKernel(node(OpCode::Mod, {ref("d"), constant(any(2.0))}), metadata));
+    EXPECT_FALSE(makeColumnKernel(node(OpCode::Add, {ref("s"), ref("s")}), metadata));
+    EXPECT_FALSE(makeColumnKernel(node(OpCode::Add, {ref("i"), node(OpCode::Add, {ref("i"), ref("i")})}), metadata));
+    EXPECT_FALSE(makeColumnKernel(constant(any(1)), metadata));
+
+    // Kernels don't apply to batches whose columns have unexpected types or nulls.
+    auto kernel = makePredicateKernel(node(OpCode::Gt, {ref("i"), constant(any(10))}), metadata);
+    vector<uint8_t> mask;
+
+    Batch untyped(metadata.size());
+    untyped.appendRow({1.0, 1u, 1.0f, 1.0, "a"s, true});
+    EXPECT_FALSE(kernel->eval(untyped, mask));
+
+    Batch withNull(metadata);
+    withNull.appendRow({any(), 1u, 1.0f, 1.0, "a"s, true});
+    EXPECT_FALSE(kernel->eval(withNull, mask));
+}
+
+TEST(TypedKernelTests, SelectionVectorTest)
+{
+    SelectionVector sel{7};
+    toSelectionVector({}, sel);
+    EXPECT_TRUE(sel.empty());
+
+    for (size_t n: {1, 7, 8, 9, 31, 64, 77}) {
+        vector<uint8_t> mask(n);
+        SelectionVector expected;
+        for (size_t i = 0; i < n; ++i) {
+            mask[i] = (i % 3 == 1) || (i >= 16 && i < 24);
+            if (mask[i]) {
+                expected.push_back(i);
+            }
+        }
+
+        toSelectionVector(mask, sel);
+        EXPECT_EQ(sel, expected) << n;
+    }
+
+    toSelectionVector(vector<uint8_t>(20, 1), sel);
+    EXPECT_EQ(sel.size(), 20);
+    toSelectionVector(vector<uint8_t>(20, 0), sel);
+    EXPECT_TRUE(sel.empty());
+}
@@ -54,3 +54,48 @@ void verifyIteratorOutput (
     EXPECT_TRUE(iterator->processNext() == std::nullopt);
     EXPECT_EQ(i, kExpectedPassLines);
 }
+
+/**
+ * @brief Compares actual data that an iterator outputs through processNextBatch() to expected data.
+ * 
+ * @param expectedFields: expected fields of data if iterator operates as intended.
+ * @param iterator: unique_ptr of iterator that will be tested.
+ * @param batchSize: maximum number of rows to request at once.
+ */
+void verifyIteratorBatchOutput(
+    const vector<vector<any>>& expectedFields, const unique_ptr<Iterator>& iterator, size_t batchSize)
+{
+    iterator->open();
+    const size_t kExpectedPassLines = expectedFields.size();
+    size_t i = 0;
+
+    while (iterator->hasNext()) {
+        auto batch = iterator->processNextBatch(batchSize);
+
+        if (batch == std::nullopt) {
+            break;
+        }
+
+        EXPECT_GT(batch->numRows(), 0);
+        EXPECT_LE(batch->numRows(), batchSize);
+
+        for (size_t r = 0; r < batch->numRows(); ++r) {
+            ASSERT_LT(i, kExpectedPassLines);
+            auto val = batch->row(r);
+            for (size_t k = 0; k < expectedFields[i].size(); ++k) {
+                const auto& actualType = val[k].type();
+                const auto& expectedType = expectedFields[i][k].type();
+                EXPECT_TRUE(actualType == expectedType)
+                    << "actual type = " << actualType.name() << ", "
+                    << "expected type = " << expectedType.name();
+                EXPECT_TRUE(val[k] == expectedFields[i][k]);
+            }
+
+            ++i;
+        }
+    }
+
+    EXPECT_FALSE(iterator->hasNext());
+    EXPECT_TRUE(iterator->processNextBatch(batchSize) == std::nullopt);
+    EXPECT_EQ(i, kExpectedPassLines);
+}
@@ -15,3 +15,7 @@
 
 void verifyIteratorOutput(
     const std::vector<std::vector<std::any>>& expectedFields, const std::unique_ptr<codein::Iterator>& iterator);
+
+void verifyIteratorBatchOutput(
+    const std::vector<std::vector<std::any>>& expectedFields, const std::unique_ptr<codein::Iterator>& iterator,
+    std::size_t batchSize);
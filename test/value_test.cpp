@@ -0,0 +1,77 @@
+/**
+ * Copyright (C) 2021-present Codein Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify it under the terms of
+ * BSD-3-Clause License which can be found at the root directory of this repository.
+ */
+
+#include <any>
+#include <gtest/gtest.h>
+#include <string>
+
+#include "any_visitor.h"
+#include "to_any_converter.h"
+#include "value.h"
+
+using namespace std;
+using namespace codein;
+
+TEST(ValueTests, ConversionTest)
+{
+    EXPECT_TRUE(Value().isNull());
+    EXPECT_EQ(Value().type(), tiVoid);
+    EXPECT_EQ(Value(true).type(), tiBool);
+    EXPECT_EQ(Value(1).type(), tiInt);
+    EXPECT_EQ(Value(1u).type(), tiUint);
+    EXPECT_EQ(Value(1.0f).type(), tiFloat);
+    EXPECT_EQ(Value(1.0).type(), tiDouble);
+    EXPECT_EQ(Value("a"s).type(), tiString);
+
+    EXPECT_EQ(toValue(any(3)).get<int>(), 3);
+    EXPECT_EQ(toValue(any("abc"s)).get<string>(), "abc"s);
+    EXPECT_TRUE(toValue(any()).isNull());
+    EXPECT_THROW(toValue(any(3L)), UnsupportedOperation);
+
+    EXPECT_EQ(any_cast<unsigned>(toAny(Value(3u))), 3u);
+    EXPECT_EQ(any_cast<string>(toAny(Value("abc"s))), "abc"s);
+    EXPECT_FALSE(toAny(Value()).has_value());
+
+    EXPECT_EQ(convertToValue(tiInt, "-12").get<int>(), -12);
+    EXPECT_EQ(convertToValue(tiDouble, "1.5").get<double>(), 1.5);
+    EXPECT_EQ(convertToValue(tiString, "x").get<string>(), "x"s);
+    EXPECT_TRUE(convertToValue(tiUint, "abc").isNull());
+
+    EXPECT_EQ(convertValue(Value(3), tiDouble).get<double>(), 3.0);
+    EXPECT_EQ(convertValue(Value(true), tiString).get<string>(), "1"s);
+    EXPECT_THROW(convertValue(Value("1"s), tiInt), UnsupportedOperation);
+    EXPECT_THROW(convertValue(Value(1), tiInt), UnsupportedOperation);
+}
+
+TEST(ValueTests, OperatorTest)
+{
+    EXPECT_TRUE(Value(1) == Value(1));
+    EXPECT_TRUE(Value() == Value());
+    EXPECT_TRUE(Value("a"s) < Value("b"s));
+    EXPECT_TRUE(Value(false) < Value(true));
+    EXPECT_TRUE(Value(2.0) >= Value(2.0));
+    EXPECT_FALSE(Value(2u) > Value(3u));
+    EXPECT_THROW(Value(1) == Value(1u), UnsupportedOperation);
+    EXPECT_THROW(Value() < Value(), UnsupportedOperation);
+
+    EXPECT_EQ((Value(1) + Value(2)).get<int>(), 3);
+    EXPECT_EQ((Value("a"s) + Value("b"s)).get<string>(), "ab"s);
+    EXPECT_EQ((Value(5u) - Value(2u)).get<unsigned>(), 3u);
+    EXPECT_EQ((Value(1.5f) * Value(2.0f)).get<float>(), 3.0f);
+    EXPECT_EQ((Value(7.0) / Value(2.0)).get<double>(), 3.5);
+    EXPECT_EQ((Value(7) % Value(4)).get<int>(), 3);
+    EXPECT_THROW(Value(true) + Value(true), UnsupportedOperation);
+    EXPECT_THROW(Value("a"s) - Value("b"s), UnsupportedOperation);
+    EXPECT_THROW(Value(7.0) % Value(4.0), UnsupportedOperation);
+
+    EXPECT_TRUE(notValue(Value(false)));
+    EXPECT_THROW(notValue(Value(0)), UnsupportedOperation);
+
+    EXPECT_EQ(hashValue(Value("abc"s)), hashAny(any("abc"s)));
+    EXPECT_EQ(hashValue(Value(7)), hashAny(any(7)));
+    EXPECT_THROW(hashValue(Value()), UnsupportedOperation);
+}
@@ -0,0 +1,126 @@
+/**
+ * Copyright (C) 2021-present Codein Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify it under the terms of
+ * BSD-3-Clause License which can be found at the root directory of this repository.
+ */
+
+#include <any>
+#include <gtest/gtest.h>
+#include <string>
+#include <vector>
+
+#include "any_visitor.h"
+#include "columnar_file.h"
+#include "expression.h"
+#include "metadata.h"
+#include "zone_map.h"
+
+using namespace std;
+using namespace codein;
+
+namespace {
+
+Expression refExpr(const string& name)
+{
+    return Expression{.opCode = OpCode::Ref, .leafOrChildren = any(name)};
+}
+
+Expression constExpr(const any& value)
+{
+    return Expression{.opCode = OpCode::Const, .leafOrChildren = value};
+}
+
+Expression binary(OpCode opCode, Expression lhs, Expression rhs)
+{
+    return Expression{.opCode = opCode, .leafOrChildren = vector<Expression>{std::move(lhs), std::move(rhs)}};
+}
+
+Expression notExpr(Expression child)
+{
+    return Expression{.opCode = OpCode::Not, .leafOrChildren = vector<Expression>{std::move(child)}};
+}
+
+ColumnChunkInfo chunk(Value min, Value max)
+{
+    return ColumnChunkInfo{0, 0, ColumnEncoding::Plain, 0, std::move(min), std::move(max)};
+}
+
+}
+
+class ZoneMapTests : public ::testing::Test {
+protected:
+    bool mayMatch(const Expression& expr) const
+    {
+        return ZoneMap(expr, metadata).mayMatch(columns);
+    }
+
+    Metadata metadata{{"i", tiInt}, {"d", tiDouble}, {"s", tiString}, {"n", tiInt}};
+    // i in [10, 20], d in [0.5, 0.5], s in ["b", "d"], and n of nulls only.
+    vector<ColumnChunkInfo> columns{
+        chunk(10, 20), chunk(0.5, 0.5), chunk("b"s, "d"s), chunk(Value(), Value())};
+};
+
+TEST_F(ZoneMapTests, CompareTest)
+{
+    EXPECT_FALSE(mayMatch(binary(OpCode::Lt, refExpr("i"), constExpr(10))));
+    EXPECT_TRUE(mayMatch(binary(OpCode::Lte, refExpr("i"), constExpr(10))));
+    EXPECT_FALSE(mayMatch(binary(OpCode::Gt, refExpr("i"), constExpr(20))));
+    EXPECT_TRUE(mayMatch(binary(OpCode::Gte, refExpr("i"), constExpr(20))));
+    EXPECT_TRUE(mayMatch(binary(OpCode::Eq, refExpr("i"), constExpr(15))));
+    EXPECT_FALSE(mayMatch(binary(OpCode::Eq, refExpr("i"), constExpr(21))));
+    EXPECT_TRUE(mayMatch(binary(OpCode::Neq, refExpr("i"), constExpr(15))));
+
+    // Constants on the left.
+    EXPECT_FALSE(mayMatch(binary(OpCode::Gt, constExpr(10), refExpr("i"))));
+    EXPECT_TRUE(mayMatch(binary(OpCode::Lt, constExpr(19), refExpr("i"))));
+
+    EXPECT_FALSE(mayMatch(binary(OpCode::Gt, refExpr("s"), constExpr("d"s))));
+    EXPECT_TRUE(mayMatch(binary(OpCode::Gt, refExpr("s"), constExpr("c"s))));
+    EXPECT_FALSE(mayMatch(binary(OpCode::Lt, refExpr("d"), constExpr(0.5))));
+
+    // Nulls pass no comparison.
+    EXPECT_FALSE(mayMatch(binary(OpCode::Eq, refExpr("n"), constExpr(1))));
+    EXPECT_FALSE(mayMatch(binary(OpCode::Neq, refExpr("n"), constExpr(1))));
+}
+
+TEST_F(ZoneMapTests, LogicalTest)
+{
+    const auto lt10 = binary(OpCode::Lt, refExpr("i"), constExpr(10));
+    const auto gt15 = binary(OpCode::Gt, refExpr("i"), constExpr(15));
+
+    EXPECT_FALSE(mayMatch(binary(OpCode::And, gt15, lt10)));
+    EXPECT_TRUE(mayMatch(binary(OpCode::Or, gt15, lt10)));
+    EXPECT_FALSE(mayMatch(binary(OpCode::Or, lt10, binary(OpCode::Gt, refExpr("i"), constExpr(20)))));
+
+    // Not i < 10 is i >= 10, and Not (i < 10 Or i > 15) is i >= 10 And i <= 15.
+    EXPECT_TRUE(mayMatch(notExpr(lt10)));
+    EXPECT_FALSE(mayMatch(notExpr(binary(OpCode::Gte, refExpr("i"), constExpr(10)))));
+    EXPECT_TRUE(mayMatch(notExpr(binary(OpCode::Or, lt10, gt15))));
+    EXPECT_FALSE(mayMatch(notExpr(binary(OpCode::Or, lt10, notExpr(lt10)))));
+
+    EXPECT_FALSE(mayMatch(kAlwaysFalse));
+    EXPECT_TRUE(mayMatch(kAlwaysTrue));
+    EXPECT_FALSE(mayMatch(notExpr(kAlwaysTrue)));
+    EXPECT_FALSE(mayMatch(binary(OpCode::And, refExpr("b"), kAlwaysFalse)));
+}
+
+TEST_F(ZoneMapTests, UnknownTest)
+{
+    // Constants of another type, comparisons between columns, unknown columns and arithmetic
+    // are not analyzed.
+    EXPECT_TRUE(mayMatch(binary(OpCode::Lt, refExpr("i"), constExpr(5u))));
+    EXPECT_TRUE(mayMatch(binary(OpCode::Lt, refExpr("i"), refExpr("n"))));
+    EXPECT_TRUE(mayMatch(binary(OpCode::Lt, refExpr("x"), constExpr(5))));
+    EXPECT_TRUE(mayMatch(binary(OpCode::Lt, binary(OpCode::Add, refExpr("i"), constExpr(1)), constExpr(5))));
+
+    // NaN may pass Neq and negated comparisons on floating point columns.
+    EXPECT_TRUE(mayMatch(binary(OpCode::Neq, refExpr("d"), constExpr(0.5))));
+    EXPECT_TRUE(mayMatch(notExpr(binary(OpCode::Eq, refExpr("d"), constExpr(0.5)))));
+    EXPECT_FALSE(ZoneMap(binary(OpCode::Neq, refExpr("d"), constExpr(0.5)), metadata).canPrune());
+
+    EXPECT_TRUE(ZoneMap(binary(OpCode::Or, refExpr("b"), binary(OpCode::Lt, refExpr("i"), constExpr(5))), metadata)
+        .mayMatch(columns));
+    EXPECT_TRUE(ZoneMap(binary(OpCode::And, refExpr("b"), binary(OpCode::Lt, refExpr("i"), constExpr(5))), metadata)
+        .canPrune());
+}